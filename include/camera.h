@@ -10,6 +10,8 @@ class Camera
     void setZoom(float newZoom);
     glm::mat4 getViewMatrix() const;
     glm::mat4 getProjectionMatrix() const;
+    // World-space rectangle covered by the view
+    void getVisibleBounds(glm::vec2 &outMin, glm::vec2 &outMax) const;
 
     float &getZoom();
     glm::vec2 &getPos();
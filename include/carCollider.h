@@ -0,0 +1,107 @@
+#pragma once // carCollider.h
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class JobSystem;
+class VehicleSystem;
+
+// Car-vs-car contacts for a VehicleSystem, run once per tick after the cars moved.
+//  - every car is the same oriented box, swept over the tick's motion
+//  - broadphase: sweep and prune on x, one sorted list per band of y; the lists
+//    stay sorted from tick to tick, so an insertion sort only has to fix what moved
+//  - narrowphase: separating axes on the relative motion, so a pair that would
+//    pass through each other within one tick is still caught at its time of impact
+//  - solver: a few rounds of sequential impulses on equal masses, then the
+//    overlap that's left is pushed apart
+class CarCollider
+{
+  public:
+    struct Stats
+    {
+        size_t m_bodies = 0;
+        size_t m_moves = 0;    // insertion sort shifts, low while the order holds
+        size_t m_pairs = 0;    // boxes overlapping in the broadphase, each gets the SAT test
+        size_t m_contacts = 0; // pairs that touched
+        size_t m_swept = 0;    // new contacts, moved back to their time of impact
+        double m_ms = 0.0;
+    };
+
+    // The car's box in its own space, x along the heading
+    void setShape(const glm::vec2 &localMin, const glm::vec2 &localMax);
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled; }
+
+    // After 'vehicles' integrated a tick of 'dt', before the track walls; pushes touching cars apart and changes their velocities
+    void solve(VehicleSystem &vehicles, float dt, JobSystem *jobs = nullptr);
+    // Last solve()
+    const Stats &getStats() const { return m_stats; }
+
+    // 'count' wandering cars at a fixed density, returns the per-tick averages over 'ticks'
+    static Stats benchmark(size_t count, int ticks, JobSystem *jobs = nullptr);
+
+    // y bands share lists modulo this, far apart bands just never overlap in y
+    static constexpr int kBuckets = 64;
+    static constexpr float kBandHeight = 256.0f;
+    static constexpr int kIterations = 4;
+    static constexpr float kRestitution = 0.4f;
+    // overlap left alone, and the share of the rest removed per tick
+    static constexpr float kSlop = 0.5f;
+    static constexpr float kCorrection = 0.8f;
+    // bodies and pairs per job
+    static constexpr size_t kJobGrain = 4096;
+    static constexpr size_t kPairGrain = 1024;
+
+  private:
+    // x-sorted entry of one body in one bucket, a copy of its box so the sweep reads one array
+    struct Proxy
+    {
+        float m_minX, m_maxX, m_minY, m_maxY;
+        uint32_t m_body;
+    };
+
+    struct Pair
+    {
+        uint32_t m_a, m_b;
+    };
+
+    struct Contact
+    {
+        uint32_t m_a, m_b;
+        glm::vec2 m_normal; // from a to b
+        float m_depth;      // 0 at the time of impact
+        float m_time;       // of impact, as a fraction of the tick; 1 when still touching at the end
+        float m_target;     // separating speed the impulses aim for
+        float m_impulse;    // accumulated, never negative
+        bool m_hit;
+    };
+
+    void reset(size_t count);
+    void computeBoxes(const VehicleSystem &vehicles, float dt, size_t begin, size_t end);
+    void updateBucket(int bucket);
+    void testPair(const VehicleSystem &vehicles, float dt, const Pair &pair, Contact &contact) const;
+    void resolve(VehicleSystem &vehicles, float dt);
+    static int bandOf(float y);
+    static int bucketOf(int band) { return ((band % kBuckets) + kBuckets) % kBuckets; }
+    // true when the bands lo..hi include one that maps to 'bucket'
+    static bool touches(int lo, int hi, int bucket) { return ((bucket - lo) % kBuckets + kBuckets) % kBuckets <= hi - lo; }
+
+    glm::vec2 m_center = glm::vec2(0.0f), m_half = glm::vec2(60.0f, 30.0f);
+    bool m_enabled = true;
+    Stats m_stats;
+
+    // per body: the box at the end of the tick and its swept bounds
+    std::vector<float> m_axisX, m_axisY; // heading, cos and sin
+    std::vector<float> m_centerX, m_centerY;
+    std::vector<float> m_minX, m_maxX, m_minY, m_maxY;
+    std::vector<int> m_bandLo, m_bandHi, m_oldLo, m_oldHi;
+
+    std::vector<Proxy> m_buckets[kBuckets];
+    std::vector<uint32_t> m_added[kBuckets];
+    std::vector<Pair> m_bucketPairs[kBuckets];
+    size_t m_bucketMoves[kBuckets] = {};
+    std::vector<Pair> m_pairs;
+    std::vector<Contact> m_contacts;
+    std::vector<float> m_impactTime; // per body, earliest swept contact
+};
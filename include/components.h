@@ -0,0 +1,74 @@
+#pragma once // components.h
+#include "mesh.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Plain data stored in the World's chunks, see ecs.h. Systems that read and
+// write them live in gameSystems.h and SceneManager.
+
+// Local transform, relative to the parent if there is one. Not a component:
+// SceneManager keeps it in its TransformStore, the entity has a TransformNode.
+struct Transform2D
+{
+    glm::vec2 m_position = glm::vec2(0.0f);
+    float m_rotation = 0.0f; // degrees
+    glm::vec2 m_scale = glm::vec2(1.0f);
+};
+
+// World transform in the layout sprite instances use
+struct Affine2D
+{
+    glm::vec4 m_linear = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f); // xy = x axis, zw = y axis
+    glm::vec2 m_translation = glm::vec2(0.0f);
+};
+
+// The entity's node in SceneManager's TransformStore
+struct TransformNode
+{
+    uint32_t m_node = 0;
+};
+
+struct Sprite
+{
+    const Mesh *m_mesh = nullptr; // shared, has to outlive the entity
+    glm::vec4 m_uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    uint8_t m_layer = 0;  // RenderQueue::Layer, lower layers draw first
+    uint32_t m_order = 0; // creation order inside the layer, its depth there
+};
+
+struct Velocity
+{
+    glm::vec2 m_linear = glm::vec2(0.0f);
+    float m_angular = 0.0f; // degrees per second
+};
+
+// A car simulated in a VehicleSystem slot, with the last two ticks for interpolation
+struct Vehicle
+{
+    uint32_t m_slot = 0;
+    glm::vec2 m_prevPosition = glm::vec2(0.0f), m_position = glm::vec2(0.0f);
+    float m_prevRotation = 0.0f, m_rotation = 0.0f;
+};
+
+// Inputs pushed into the entity's VehicleSystem slot before each tick
+struct VehicleControl
+{
+    float m_steer = 0.0f;
+    float m_throttle = 0.0f;
+};
+
+// The camera eases towards the entity's transform
+struct CameraTarget
+{
+    float m_smoothing = 10.0f;
+};
+
+// World-space AABB of a sprite, owned by SceneManager
+struct Bounds
+{
+    glm::vec2 m_min = glm::vec2(0.0f), m_max = glm::vec2(0.0f);
+    glm::ivec2 m_cellMin = glm::ivec2(0), m_cellMax = glm::ivec2(0); // grid cells it is listed in
+    uint32_t m_visitStamp = 0;
+    bool m_large = false; // too big for the grid, tested on its own
+    bool m_moved = false; // left its cells, re-bucketed by updateBounds
+};
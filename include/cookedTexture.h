@@ -0,0 +1,83 @@
+#pragma once // cookedTexture.h
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Binary container written by asset_cooker: header, mip table, then the
+// pixel data of every level, each 16-byte aligned so it can be uploaded
+// straight out of a memory mapping.
+namespace Cooked
+{
+constexpr char kMagic[4] = {'C', 'T', 'E', 'X'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kMaxMips = 16;
+// cooked files sit next to their source, e.g. car_tex.png.ctex
+constexpr const char *kExtension = ".ctex";
+
+enum class Format : uint32_t
+{
+    RGBA8 = 0,
+    BC1 = 1, // DXT1, 4x4 blocks of 8 bytes, 1-bit alpha
+    BC3 = 2, // DXT5, 4x4 blocks of 16 bytes
+};
+
+enum Flags : uint32_t
+{
+    FlippedVertically = 1u << 0,
+};
+
+struct Header
+{
+    char m_magic[4];
+    uint32_t m_version;
+    Format m_format;
+    uint32_t m_flags;
+    uint32_t m_width;
+    uint32_t m_height;
+    uint32_t m_mipCount;
+    uint32_t m_reserved;
+};
+
+struct Mip
+{
+    uint32_t m_width;
+    uint32_t m_height;
+    uint64_t m_offset; // from the start of the file
+    uint64_t m_size;
+};
+
+bool isCompressed(Format format);
+// Bytes in one upload unit row: a pixel row for RGBA8, a row of 4x4 blocks otherwise
+size_t rowPitch(Format format, uint32_t width);
+// Pixel rows per upload unit row
+uint32_t rowsPerUnit(Format format);
+size_t levelSize(Format format, uint32_t width, uint32_t height);
+} // namespace Cooked
+
+// Read-only memory mapping of a cooked texture
+class CookedTextureFile
+{
+  public:
+    CookedTextureFile() = default;
+    ~CookedTextureFile();
+
+    CookedTextureFile(const CookedTextureFile &) = delete;
+    CookedTextureFile &operator=(const CookedTextureFile &) = delete;
+
+    // Maps and validates 'path', false if missing or malformed
+    bool open(const std::string &path);
+    void close();
+
+    const Cooked::Header &header() const { return *reinterpret_cast<const Cooked::Header *>(m_data); }
+    const Cooked::Mip &mip(uint32_t level) const;
+    const unsigned char *mipData(uint32_t level) const { return m_data + mip(level).m_offset; }
+    size_t size() const { return m_size; }
+
+  private:
+    const unsigned char *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#endif
+};
@@ -0,0 +1,232 @@
+#pragma once // ecs.h
+#include "frameArena.h"
+#include "jobSystem.h"
+#include "objectPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+struct Entity
+{
+    uint32_t m_index = 0; // record + 1, 0 is the null entity
+    uint32_t m_generation = 0;
+
+    explicit operator bool() const { return m_index != 0; }
+    bool operator==(const Entity &other) const { return m_index == other.m_index && m_generation == other.m_generation; }
+    bool operator!=(const Entity &other) const { return !(*this == other); }
+};
+
+// Entities with the same set of components share an archetype, whose
+// components live in 16 KB chunks: one array per component type, rows packed
+// at the front. Queries walk those arrays in order.
+//  - components must be trivially copyable, rows move between chunks with memcpy
+//  - destroying swaps the archetype's last row into the hole
+//  - no create / destroy / add / remove while a query is running
+class World
+{
+  public:
+    static constexpr size_t kChunkBytes = 16 * 1024;
+    static constexpr int kMaxComponents = 64;
+    using Mask = uint64_t;
+
+    struct Stats
+    {
+        size_t m_entities = 0;
+        size_t m_archetypes = 0;
+        size_t m_chunks = 0;
+    };
+
+    World() = default;
+    ~World();
+
+    World(const World &) = delete;
+    World &operator=(const World &) = delete;
+
+    template <typename... Cs> Entity create(const Cs &...components);
+    void destroy(Entity entity);
+    bool isAlive(Entity entity) const { return record(entity) != nullptr; }
+    void clear();
+
+    // nullptr when the entity is dead or lacks the component
+    template <typename C> C *get(Entity entity);
+    template <typename C> const C *get(Entity entity) const { return const_cast<World *>(this)->get<C>(entity); }
+    template <typename C> bool has(Entity entity) const;
+    // Moves the entity to the archetype with / without C
+    template <typename C> void add(Entity entity, const C &component);
+    template <typename C> void remove(Entity entity);
+
+    // f(Entity, Cs &...) for every entity that has all of Cs
+    template <typename... Cs, typename F> void each(F &&f);
+    // Same, with the chunks spread over the job system; f may only touch the entity it is given
+    template <typename... Cs, typename F> void parallelEach(JobSystem *jobs, F &&f);
+    template <typename... Cs> size_t count() const;
+
+    Stats getStats() const;
+
+    template <typename C> static int componentId();
+    template <typename... Cs> static Mask maskOf() { return (Mask(0) | ... | (Mask(1) << componentId<Cs>())); }
+
+  private:
+    struct Chunk
+    {
+        alignas(64) unsigned char m_data[kChunkBytes];
+        uint32_t m_count = 0;
+    };
+
+    struct Archetype
+    {
+        Mask m_mask = 0;
+        uint32_t m_capacity = 0;               // rows per chunk
+        uint32_t m_offsets[kMaxComponents] = {}; // array start in the chunk, by component id
+        std::vector<Chunk *> m_chunks;         // all full except the last
+    };
+
+    struct Record
+    {
+        Archetype *m_archetype = nullptr;
+        uint32_t m_chunk = 0;
+        uint32_t m_row = 0;
+        uint32_t m_generation = 1;
+    };
+
+    struct ComponentInfo
+    {
+        size_t m_size;
+        size_t m_align;
+    };
+
+    // chunks per parallelEach job
+    static constexpr size_t kChunkGrain = 8;
+
+    static int registerComponent(size_t size, size_t align);
+    static ComponentInfo *components();
+    static const ComponentInfo &componentInfo(int id) { return components()[id]; }
+
+    Archetype &archetype(Mask mask);
+    const Record *record(Entity entity) const;
+    Record *record(Entity entity) { return const_cast<Record *>(static_cast<const World *>(this)->record(entity)); }
+    Entity newEntity();
+    // appends a row for 'entity' and points its record at it
+    void allocateRow(Archetype &archetype, Entity entity);
+    // fills the hole with the archetype's last row
+    void removeRow(Archetype &archetype, uint32_t chunk, uint32_t row);
+    void move(Entity entity, Mask mask);
+
+    static unsigned char *column(const Archetype &archetype, Chunk &chunk, int id) { return chunk.m_data + archetype.m_offsets[id]; }
+    template <typename C> static C *array(const Archetype &archetype, Chunk &chunk) { return reinterpret_cast<C *>(column(archetype, chunk, componentId<C>())); }
+    static Entity *entities(Chunk &chunk) { return reinterpret_cast<Entity *>(chunk.m_data); }
+    template <typename... Cs, typename F> static void eachInChunk(const Archetype &archetype, Chunk &chunk, F &f);
+
+    std::vector<std::unique_ptr<Archetype>> m_archetypes;
+    std::vector<Record> m_records;
+    std::vector<uint32_t> m_freeRecords;
+    ObjectPool<Chunk, 16> m_chunkPool;
+    size_t m_entityCount = 0;
+};
+
+template <typename C> int World::componentId()
+{
+    static_assert(std::is_trivially_copyable<C>::value, "components are moved with memcpy");
+    static const int id = registerComponent(sizeof(C), alignof(C));
+    return id;
+}
+
+template <typename... Cs> Entity World::create(const Cs &...components)
+{
+    Entity entity = newEntity();
+    Archetype &target = archetype(maskOf<Cs...>());
+    allocateRow(target, entity);
+    const Record &where = m_records[entity.m_index - 1];
+    Chunk &chunk = *target.m_chunks[where.m_chunk];
+    (std::memcpy(array<Cs>(target, chunk) + where.m_row, &components, sizeof(Cs)), ...);
+    return entity;
+}
+
+template <typename C> C *World::get(Entity entity)
+{
+    Record *where = record(entity);
+    if (!where || !(where->m_archetype->m_mask & maskOf<C>())) return nullptr;
+    return array<C>(*where->m_archetype, *where->m_archetype->m_chunks[where->m_chunk]) + where->m_row;
+}
+
+template <typename C> bool World::has(Entity entity) const
+{
+    const Record *where = record(entity);
+    return where && (where->m_archetype->m_mask & maskOf<C>());
+}
+
+template <typename C> void World::add(Entity entity, const C &component)
+{
+    Record *where = record(entity);
+    if (!where) return;
+    if (!(where->m_archetype->m_mask & maskOf<C>())) move(entity, where->m_archetype->m_mask | maskOf<C>());
+    *get<C>(entity) = component;
+}
+
+template <typename C> void World::remove(Entity entity)
+{
+    Record *where = record(entity);
+    if (!where || !(where->m_archetype->m_mask & maskOf<C>())) return;
+    move(entity, where->m_archetype->m_mask & ~maskOf<C>());
+}
+
+template <typename... Cs, typename F> void World::eachInChunk(const Archetype &archetype, Chunk &chunk, F &f)
+{
+    Entity *rows = entities(chunk);
+    auto run = [&](Cs *...arrays)
+    {
+        for (uint32_t i = 0; i < chunk.m_count; i++)
+            f(rows[i], arrays[i]...);
+    };
+    run(array<Cs>(archetype, chunk)...);
+}
+
+template <typename... Cs, typename F> void World::each(F &&f)
+{
+    const Mask mask = maskOf<Cs...>();
+    for (auto &archetype : m_archetypes)
+    {
+        if ((archetype->m_mask & mask) != mask) continue;
+        for (Chunk *chunk : archetype->m_chunks)
+            eachInChunk<Cs...>(*archetype, *chunk, f);
+    }
+}
+
+template <typename... Cs, typename F> void World::parallelEach(JobSystem *jobs, F &&f)
+{
+    struct Work
+    {
+        const Archetype *m_archetype;
+        Chunk *m_chunk;
+    };
+    const Mask mask = maskOf<Cs...>();
+    FrameVector<Work> work;
+    work.reserve(getStats().m_chunks);
+    for (auto &archetype : m_archetypes)
+        if ((archetype->m_mask & mask) == mask)
+            for (Chunk *chunk : archetype->m_chunks)
+                work.push_back({archetype.get(), chunk});
+
+    auto runRange = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+            eachInChunk<Cs...>(*work[i].m_archetype, *work[i].m_chunk, f);
+    };
+    // a few chunks are not worth the handoff
+    if (!jobs || work.size() <= kChunkGrain) runRange(0, work.size());
+    else jobs->parallelFor(0, work.size(), kChunkGrain, runRange);
+}
+
+template <typename... Cs> size_t World::count() const
+{
+    const Mask mask = maskOf<Cs...>();
+    size_t total = 0;
+    for (auto &archetype : m_archetypes)
+        if ((archetype->m_mask & mask) == mask)
+            for (const Chunk *chunk : archetype->m_chunks)
+                total += chunk->m_count;
+    return total;
+}
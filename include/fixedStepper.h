@@ -0,0 +1,31 @@
+#pragma once // fixedStepper.h
+
+// Accumulates frame time and hands out a whole number of fixed simulation ticks.
+class FixedStepper
+{
+  public:
+    explicit FixedStepper(float tickRate = 120.0f, int maxCatchUpSteps = 8);
+
+    // Adds the frame's time, returns how many ticks to simulate now
+    int advance(float frameTime);
+
+    void setTickRate(float tickRate);
+    void setMaxCatchUpSteps(int steps) { m_maxCatchUpSteps = steps; }
+
+    float getTickRate() const { return m_tickRate; }
+    int getMaxCatchUpSteps() const { return m_maxCatchUpSteps; }
+    float getStep() const { return m_step; }
+    // How far render time is between the previous and the current tick, [0, 1)
+    float getAlpha() const { return m_accumulator / m_step; }
+    int getLastSteps() const { return m_lastSteps; }
+    // Simulation time thrown away because the catch-up cap was hit
+    double getDroppedTime() const { return m_droppedTime; }
+
+  private:
+    float m_tickRate;
+    float m_step;
+    float m_accumulator;
+    int m_maxCatchUpSteps;
+    int m_lastSteps;
+    double m_droppedTime;
+};
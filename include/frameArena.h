@@ -0,0 +1,73 @@
+#pragma once // frameArena.h
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator for data that lives one frame. Two buffers alternate: what
+// is allocated during frame N stays valid through frame N + 1 and is dropped
+// wholesale at the end of it. Nothing is freed on its own.
+//
+// Main thread only. When a frame outgrows its buffer the rest comes from the
+// heap and the buffer is resized to fit at its next reset, so steady-state
+// frames never touch the heap.
+class FrameArena
+{
+  public:
+    struct Stats
+    {
+        size_t m_bytes = 0;    // handed out during the frame, overflow included
+        size_t m_capacity = 0; // of one buffer
+        int m_allocations = 0;
+        int m_overflows = 0;             // went to the heap
+        uint64_t m_heapAllocations = 0;  // global operator new during the frame, see memoryStats.h
+    };
+
+    static FrameArena &get();
+
+    void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    template <typename T> T *allocate(size_t count) { return static_cast<T *>(allocate(count * sizeof(T), alignof(T))); }
+
+    // After the frame: the buffer used the frame before becomes current and is reset
+    void endFrame();
+    const Stats &getStats() const { return m_lastFrame; }
+
+  private:
+    struct Buffer
+    {
+        std::unique_ptr<uint8_t[]> m_memory;
+        size_t m_capacity = 0;
+        size_t m_used = 0;
+        size_t m_wanted = 0; // used plus overflow, the size for the next reset
+        std::vector<std::unique_ptr<uint8_t[]>> m_overflow;
+    };
+
+    static constexpr size_t kInitialCapacity = 256 * 1024;
+
+    FrameArena();
+    void reset(Buffer &buffer);
+
+    Buffer m_buffers[2];
+    int m_current = 0;
+    uint64_t m_frameStartHeap = 0;
+    Stats m_stats;
+    Stats m_lastFrame;
+};
+
+// std allocator over the frame arena; deallocate is a no-op
+template <typename T> struct FrameAllocator
+{
+    using value_type = T;
+
+    FrameAllocator() = default;
+    template <typename U> FrameAllocator(const FrameAllocator<U> &) {}
+
+    T *allocate(size_t count) { return FrameArena::get().allocate<T>(count); }
+    void deallocate(T *, size_t) {}
+
+    template <typename U> bool operator==(const FrameAllocator<U> &) const { return true; }
+    template <typename U> bool operator!=(const FrameAllocator<U> &) const { return false; }
+};
+
+// Reserve up front: a growing vector leaves its old storage behind in the arena
+template <typename T> using FrameVector = std::vector<T, FrameAllocator<T>>;
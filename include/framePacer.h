@@ -0,0 +1,91 @@
+#pragma once // framePacer.h
+#include <chrono>
+
+struct GLFWwindow;
+
+// Decides when a frame starts. Each frame the loop calls waitForInput()
+// right before polling input, beforeSwap() and afterSwap() around the swap.
+//  - VSync / AdaptiveVSync: the driver blocks in the swap, adaptive tears instead of halving the rate when a frame is late
+//  - Uncapped: no waiting at all, for benchmarks
+//  - Capped: a software limit, sleeps most of the wait and spins the rest
+//  - JustInTime: vsync, but input is sampled as late as the recent frames allow so it's fresher at the flip
+class FramePacer
+{
+  public:
+    enum Mode
+    {
+        VSync,
+        AdaptiveVSync,
+        Uncapped,
+        Capped,
+        JustInTime,
+        kModeCount
+    };
+
+    struct Stats
+    {
+        double m_frameMs = 0.0;    // swap to swap
+        double m_meanMs = 0.0;     // over the plotted frames
+        double m_stdDevMs = 0.0;   // over the plotted frames
+        double m_maxMs = 0.0;      // over the plotted frames
+        double m_waitMs = 0.0;     // slept and spun before the input
+        double m_workMs = 0.0;     // input to the swap call
+        double m_latencyMs = 0.0;  // input to the swap returning; the display's scanout comes on top
+        double m_meanLatencyMs = 0.0;
+        double m_oversleepMs = 0.0; // how late sleeps wake up lately, the spin covers it
+        int m_missed = 0;           // JustInTime frames that came in after their vblank
+    };
+
+    static constexpr int kPlotFrames = 240;
+
+    static const char *modeName(Mode mode);
+
+    // Null window for headless: no swap interval, only Uncapped and Capped make sense
+    void init(GLFWwindow *window, Mode mode);
+    void setMode(Mode mode);
+    Mode getMode() const { return m_mode; }
+    void setTargetFps(double fps);
+    double getTargetFps() const { return m_targetFps; }
+    double getRefreshHz() const { return m_refreshHz; }
+    // Without the swap_control_tear extension AdaptiveVSync is plain VSync
+    bool isAdaptiveSupported() const { return m_adaptiveSupported; }
+
+    void waitForInput();
+    void beforeSwap();
+    void afterSwap();
+
+    const Stats &getStats() const { return m_stats; }
+    // ring buffers, oldest at getPlotHead()
+    const float *getFramePlot() const { return m_framePlot; }
+    const float *getLatencyPlot() const { return m_latencyPlot; }
+    int getPlotHead() const { return m_plotHead; }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    static double msBetween(Clock::time_point from, Clock::time_point to) { return std::chrono::duration<double, std::milli>(to - from).count(); }
+    void applySwapInterval();
+    // sleeps while it's safely early, then spins to 'target'
+    void waitUntil(Clock::time_point target);
+
+    // leeway for the swap call itself and for scheduling noise
+    static constexpr double kJustInTimeMarginMs = 1.0;
+    // recent peaks fade so one hitch doesn't pin the estimates
+    static constexpr double kPeakDecay = 0.98;
+
+    GLFWwindow *m_window = nullptr;
+    Mode m_mode = VSync;
+    double m_targetFps = 120.0;
+    double m_refreshHz = 60.0;
+    bool m_adaptiveSupported = false;
+    bool m_started = false;
+
+    Clock::time_point m_nextFrame, m_inputTime, m_lastSwap;
+    double m_workPeakMs = 0.0;
+    Stats m_stats;
+
+    float m_framePlot[kPlotFrames] = {};
+    float m_latencyPlot[kPlotFrames] = {};
+    int m_plotHead = 0;
+    int m_plotCount = 0;
+};
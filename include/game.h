@@ -1,14 +1,43 @@
 #pragma once // game.h
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
+#include "carCollider.h"
+#include "ecs.h"
+#include "fixedStepper.h"
+#include "framePacer.h"
+#include "headlessContext.h"
+#include "inputLog.h"
+#include "inputState.h"
+#include "jobSystem.h"
 #include "player.h"
 #include "renderer.h"
+#include "tileWorld.h"
+#include "trackCollider.h"
+#include "vehicleSystem.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <chrono>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --headless: offscreen, scripted frames, timing report instead of a window
+struct HeadlessOptions
+{
+    int m_width = 800;
+    int m_height = 800;
+    int m_frames = 0; // 0: 600 scripted frames, or until the replay ends
+    int m_aiCars = 0;
+    std::vector<int> m_dumpFrames; // written as frame_NNNNN.png
+    std::string m_dumpDir = ".";
+    std::string m_tracePath; // Chrome trace of every measured frame
+    int m_fpsCap = 0;        // 0: as fast as it goes
+    bool m_carCollisions = true;
+};
 
 class Game
 {
@@ -16,13 +45,31 @@ class Game
     Game();
     ~Game();
     int run();
+    int runHeadless(const HeadlessOptions &options);
+    // Either path may be empty; both set re-records a replay
+    void setInputLog(const std::string &recordPath, const std::string &replayPath);
 
   private:
     void init();
+    void initHeadless(const HeadlessOptions &options);
     void gameLoop();
+    // one frame of simulation: fixed ticks, then interpolated sprites and camera
+    void update(const InputState &input, float deltaTime);
     void shutDown();
     void setupScene();
+    // Swaps the track at runtime, the old tiles are dropped and the new ones streamed in
+    void loadTrack(const std::string &path);
+    void unloadTrack();
+    // AI cars in VehicleSystem slots 1..count, each drawn by its own entity
+    void spawnAI(size_t count);
+    void destroyAI();
+    void startInputLog();
+    void reportReplay() const;
+    void trackStreaming();
+    // Smoke and skid marks from the player's slip, sparks where it scrapes the track's edge
+    void updateEffects(float deltaTime);
     GLFWwindow *m_window;
+    HeadlessContext m_headless;
     struct WindowSettings
     {
         int m_width;
@@ -31,7 +78,38 @@ class Game
     } m_windowSettings;
 
     Renderer m_renderer;
-    Texture *m_brickTex;
-    Texture *m_raceTrackTex;
+    AtlasRegion m_brickRegion;
+    std::string m_trackPath;
+    TileWorld m_trackTiles;
     Player m_player;
+    std::vector<Entity> m_aiEntities;
+    FixedStepper m_stepper;
+    FramePacer m_pacer;
+    JobSystem m_jobs;
+    VehicleSystem m_vehicles;
+    CarCollider m_cars;
+    TrackCollider m_track;
+    InputRecorder m_recorder;
+    InputReplay m_replay;
+    std::string m_recordPath;
+    std::string m_replayPath;
+    bool m_showControlPanel;
+    bool m_panelKeyWasDown;
+    int m_aiCount;
+    double m_benchmarkResults[4]; // per kernel, then the best kernel on the job system
+    CarCollider::Stats m_collisionResults[4]; // 1k, 5k, 10k and 50k cars
+
+    // where the rear wheels were last frame, skid marks run from there
+    glm::vec2 m_lastWheels[2];
+    bool m_wheelsPlaced;
+    // fractions of a particle left over from earlier frames
+    float m_smokeCarry;
+    float m_sparkCarry;
+
+    // startup / streaming measurements
+    std::chrono::steady_clock::time_point m_startTime;
+    double m_firstFrameMs;
+    double m_streamHitchMs;
+    bool m_wasStreaming;
+    std::vector<std::shared_ptr<Texture>> m_stressTextures;
 };
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once // gameSystems.h
+#include "camera.h"
+#include "ecs.h"
+
+class JobSystem;
+class TransformStore;
+class VehicleSystem;
+
+// Per-tick and per-frame passes over the World. VehicleSystem stays the
+// physics kernel; these move data between its SoA slots and the entities.
+namespace GameSystems
+{
+// Before VehicleSystem::update: VehicleControl into each car's slot
+void pushControls(World &world, VehicleSystem &vehicles);
+// After VehicleSystem::update: the tick's results into Vehicle and Velocity
+void pullState(World &world, const VehicleSystem &vehicles, JobSystem *jobs = nullptr);
+// Once per frame: cars placed between their last two ticks
+void interpolate(World &world, TransformStore &transforms, float alpha, JobSystem *jobs = nullptr);
+// Eases the camera towards the CameraTarget entity
+void followCamera(World &world, const TransformStore &transforms, Camera &camera, float frameTime);
+} // namespace GameSystems
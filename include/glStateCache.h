@@ -0,0 +1,99 @@
+#pragma once // glStateCache.h
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+// Shadow copy of the GL state the renderer touches. Binds, blend changes and
+// uniform uploads go through here and are dropped when they would not change
+// anything. Objects are never unbound just to be tidy, so:
+//  - code that changes GL state behind the cache's back (ImGui) is followed by invalidate()
+//  - GL_ELEMENT_ARRAY_BUFFER belongs to the bound VAO, only bind it right after binding its VAO
+class GLStateCache
+{
+  public:
+    enum Kind
+    {
+        Program,
+        ActiveTexture,
+        Texture,
+        VertexArray,
+        Buffer,
+        Blend,
+        Uniform,
+        UniformBlock,
+        kKindCount,
+    };
+
+    struct Counters
+    {
+        int m_issued[kKindCount] = {};
+        int m_skipped[kKindCount] = {};
+    };
+
+    static GLStateCache &get();
+    static const char *kindName(Kind kind);
+
+    void useProgram(GLuint program);
+    void bindTexture(GLuint texture, GLuint unit = 0);
+    void bindVertexArray(GLuint vao);
+    // GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER or GL_PIXEL_UNPACK_BUFFER
+    void bindBuffer(GLenum target, GLuint buffer);
+    // Also binds the generic target, like GL does
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void setBlend(bool enabled, GLenum src = GL_SRC_ALPHA, GLenum dst = GL_ONE_MINUS_SRC_ALPHA);
+
+    // Uniforms of the program bound through useProgram
+    void uniform(GLint location, int value);
+    void uniform(GLint location, float value);
+    void uniform(GLint location, const glm::vec2 &value);
+    void uniform(GLint location, const glm::mat4 &value);
+    // Uploads only when the bytes differ from the last upload to 'buffer'
+    void bufferSubData(GLenum target, GLuint buffer, size_t offset, size_t size, const void *data);
+
+    // GL drops the bindings of deleted objects and hands their names out again
+    void textureDeleted(GLuint texture);
+    void bufferDeleted(GLuint buffer);
+    void vertexArrayDeleted(GLuint vao);
+    void programDeleted(GLuint program);
+
+    // Forgets the bindings, uniform values stay valid
+    void invalidate();
+    // Counters of the finished frame become visible
+    void endFrame();
+    const Counters &getCounters() const { return m_lastFrame; }
+
+  private:
+    static constexpr GLuint kUnknown = 0xFFFFFFFFu;
+    static constexpr GLuint kTextureUnits = 8;
+
+    struct UniformValue
+    {
+        uint32_t m_words[16];
+        int m_count;
+    };
+
+    GLStateCache();
+    // true when the call has to go to GL
+    bool changed(Kind kind, bool differs);
+    GLuint *bufferSlot(GLenum target);
+    bool uniformChanged(GLint location, const void *value, int words);
+
+    GLuint m_program;
+    GLuint m_activeUnit;
+    GLuint m_textures[kTextureUnits];
+    GLuint m_vao;
+    GLuint m_arrayBuffer;
+    GLuint m_uniformBuffer;
+    GLuint m_unpackBuffer;
+    int m_blendEnabled; // -1 unknown
+    GLenum m_blendSrc, m_blendDst;
+
+    std::unordered_map<uint64_t, UniformValue> m_uniforms; // program << 32 | location
+    std::unordered_map<GLuint, std::vector<uint8_t>> m_bufferContents;
+
+    Counters m_counters;
+    Counters m_lastFrame;
+};
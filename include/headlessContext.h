@@ -0,0 +1,37 @@
+#pragma once // headlessContext.h
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+
+// GL 3.3 core context without a window or display: a surfaceless EGL
+// context (llvmpipe on machines without a GPU) drawing into an FBO.
+// Only usable when the build found EGL (GAME_HAS_EGL).
+class HeadlessContext
+{
+  public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext &) = delete;
+    HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+    static bool available();
+
+    // Creates the context, makes it current and binds a width x height FBO
+    void init(int width, int height);
+    void cleanup();
+
+    // Re-binds the FBO and viewport, call before rendering a frame
+    void bind() const;
+    // RGBA8, bottom row first
+    void readPixels(std::vector<uint8_t> &out) const;
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+  private:
+    void *m_display; // EGLDisplay
+    void *m_context; // EGLContext
+    GLuint m_fbo, m_colorBuffer;
+    int m_width, m_height;
+};
@@ -0,0 +1,94 @@
+#pragma once // inputLog.h
+#include "inputState.h"
+#include "player.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Per-tick input log for deterministic replays. Buttons are stored as runs of
+// identical ticks, with a checksum of the player state every few ticks so a
+// replay can tell exactly where it stopped matching the recording.
+namespace InputLog
+{
+// the trace hotkey is a tool, not part of the simulation
+inline constexpr uint8_t kRecordedButtons = (uint8_t)~InputState::CaptureTrace;
+inline constexpr uint32_t kChecksumInterval = 60;
+// one byte per tick once loaded, a log claiming more is corrupt; about 38 hours at 120 Hz
+inline constexpr uint32_t kMaxTicks = 1u << 24;
+
+// Everything the simulation needs to start the same way
+struct Header
+{
+    float m_tickRate = 120.0f;
+    uint32_t m_checksumInterval = kChecksumInterval;
+    uint32_t m_path = 0; // VehicleSystem::Path
+    uint32_t m_aiCars = 0; // spawned before the first tick, they collide with the player
+    uint32_t m_carCollisions = 1;
+    uint32_t m_initialChecksum = 0;
+    PlayerConstData m_constData = {};
+};
+
+// FNV-1a over the bit patterns, any difference in any field shows up
+uint32_t checksum(const PlayerData &data);
+} // namespace InputLog
+
+class InputRecorder
+{
+  public:
+    ~InputRecorder();
+
+    void start(const std::string &path, const InputLog::Header &header);
+    // Once per tick, after the tick ran with 'input'
+    void record(const InputState &input, const PlayerData &state);
+    void stop();
+
+    bool isRecording() const { return m_file.is_open(); }
+    uint32_t getTicks() const { return m_ticks; }
+
+  private:
+    void flushRun();
+
+    std::ofstream m_file;
+    std::string m_path;
+    uint32_t m_checksumInterval = InputLog::kChecksumInterval;
+    uint32_t m_ticks = 0;
+    uint8_t m_runButtons = 0;
+    uint32_t m_runLength = 0;
+};
+
+class InputReplay
+{
+  public:
+    void load(const std::string &path);
+
+    const InputLog::Header &getHeader() const { return m_header; }
+    bool isPlaying() const { return m_tick < m_buttons.size(); }
+
+    // Input for the next tick
+    InputState next() const;
+    // After the tick ran, compares against the recorded checksum if there is one
+    void verify(const PlayerData &state);
+
+    uint32_t getTick() const { return m_tick; }
+    uint32_t getTickCount() const { return (uint32_t)m_buttons.size(); }
+    uint32_t getChecksumsMatched() const { return m_matched; }
+    bool hasDiverged() const { return m_divergedTick >= 0; }
+    // First checkpoint tick that did not match, -1 while in sync
+    int64_t getDivergedTick() const { return m_divergedTick; }
+
+  private:
+    struct Checkpoint
+    {
+        uint32_t m_tick; // ticks simulated when it was taken
+        uint32_t m_checksum;
+    };
+
+    InputLog::Header m_header;
+    std::vector<uint8_t> m_buttons; // one entry per tick
+    std::vector<Checkpoint> m_checkpoints;
+    size_t m_nextCheckpoint = 0;
+    uint32_t m_tick = 0;
+    uint32_t m_matched = 0;
+    int64_t m_divergedTick = -1;
+};
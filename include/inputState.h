@@ -0,0 +1,27 @@
+#pragma once // inputState.h
+#include <GLFW/glfw3.h>
+#include <cstdint>
+
+// The controls the game reacts to, sampled once per frame from the keyboard
+// or generated by a script, so the simulation never touches GLFW directly
+struct InputState
+{
+    enum Button : uint8_t
+    {
+        Throttle = 1 << 0,
+        Brake = 1 << 1,
+        SteerLeft = 1 << 2,
+        SteerRight = 1 << 3,
+        ZoomIn = 1 << 4,
+        ZoomOut = 1 << 5,
+        TogglePanel = 1 << 6,
+        CaptureTrace = 1 << 7,
+    };
+
+    uint8_t m_buttons = 0;
+
+    bool down(Button button) const { return (m_buttons & button) != 0; }
+    void set(Button button, bool pressed) { m_buttons = pressed ? (m_buttons | button) : (m_buttons & ~button); }
+
+    static InputState fromWindow(GLFWwindow *window);
+};
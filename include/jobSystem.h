@@ -0,0 +1,103 @@
+#pragma once // jobSystem.h
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of workers, each with its own deque. Owners push/pop at the back,
+// idle threads steal from the front of someone else's. Thread 0 is the main
+// thread, which keeps the GL context and helps out while it waits.
+//
+// Jobs are plain structs in fixed rings, so queueing one never allocates.
+class JobSystem
+{
+  public:
+    // Number of unfinished jobs, wait() on it to join
+    struct Counter
+    {
+        std::atomic<int> m_pending{0};
+    };
+
+    using JobFunction = void (*)(void *context, size_t begin, size_t end);
+
+    // 'context' must outlive the job, wait() on the counter before it goes
+    struct Job
+    {
+        JobFunction m_function = nullptr;
+        void *m_context = nullptr;
+        size_t m_begin = 0, m_end = 0;
+        Counter *m_counter = nullptr;
+    };
+
+    struct WorkerStats
+    {
+        float m_utilization = 0.0f; // busy fraction of the last frame
+        uint32_t m_jobs = 0;        // last frame
+        uint32_t m_steals = 0;      // last frame
+    };
+
+    JobSystem() = default;
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // 0 = one worker per core besides the main thread
+    void init(int workerCount = 0);
+    void shutdown();
+
+    // Runs inline when the calling thread's ring is full
+    void run(const Job &job);
+    // Runs other jobs until 'counter' drops to zero
+    void wait(Counter &counter);
+
+    // Splits [begin, end) into chunks of at most 'grain' and blocks until all ran
+    template <typename Fn> void parallelFor(size_t begin, size_t end, size_t grain, const Fn &fn)
+    {
+        parallelFor(begin, end, grain, [](void *context, size_t first, size_t last) { (*static_cast<const Fn *>(context))(first, last); }, const_cast<Fn *>(&fn));
+    }
+    void parallelFor(size_t begin, size_t end, size_t grain, JobFunction function, void *context);
+
+    // Closes the utilization window, call once per frame
+    void endFrame();
+
+    // Including the main thread
+    int getThreadCount() const { return (int)m_workers.size(); }
+    const WorkerStats &getStats(int thread) const { return m_workers[thread]->m_stats; }
+
+  private:
+    static constexpr uint32_t kRingSize = 4096; // power of two
+
+    struct Worker
+    {
+        std::mutex m_mutex;
+        Job m_jobs[kRingSize];
+        uint32_t m_front = 0, m_back = 0; // free running, masked on access
+        std::atomic<uint64_t> m_busyNs{0};
+        std::atomic<uint32_t> m_jobCount{0};
+        std::atomic<uint32_t> m_stealCount{0};
+        uint64_t m_lastBusyNs = 0;
+        uint32_t m_lastJobCount = 0, m_lastStealCount = 0;
+        WorkerStats m_stats;
+    };
+
+    void workerLoop(int index);
+    bool tryRunOne(int index);
+    void execute(int index, const Job &job);
+    bool pop(int index, Job &out);
+    bool steal(int thief, Job &out);
+    int currentIndex() const;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    std::atomic<bool> m_quit{false};
+    std::atomic<int> m_queued{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::chrono::steady_clock::time_point m_frameStart;
+};
@@ -0,0 +1,19 @@
+#pragma once // memoryStats.h
+#include <cstddef>
+#include <cstdint>
+
+// Counts global operator new calls, so a frame that should not touch the
+// heap can be checked. Only active when built with GAME_COUNT_ALLOCATIONS,
+// otherwise the counters stay at zero.
+namespace MemoryStats
+{
+struct Heap
+{
+    uint64_t m_allocations = 0;
+    uint64_t m_bytes = 0;
+};
+
+bool isCounting();
+// totals since startup, all threads
+Heap heap();
+} // namespace MemoryStats
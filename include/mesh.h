@@ -1,23 +1,37 @@
 #pragma once // mesh.h
+#include "meshPool.h"
 #include "texture.h"
+#include "textureAtlas.h"
 #include <glm/glm.hpp>
 #include <vector>
 
-struct Vertex
-{
-    glm::vec3 m_relPosition;
-    glm::vec2 m_texCoords; // uv
-};
-
+// A range of a MeshPool plus what it is drawn with. Owns the range, so it is
+// shared by pointer, never copied.
 class Mesh
 {
   public:
-    Mesh(const std::vector<Vertex> &verts, const std::vector<unsigned> &idx, Texture &texture);
+    Mesh(MeshPool &pool, const std::vector<Vertex> &verts, const std::vector<unsigned> &idx, Texture &texture);
+    // uvs are remapped into the region at draw time
+    Mesh(MeshPool &pool, const std::vector<Vertex> &verts, const std::vector<unsigned> &idx, const AtlasRegion &region);
     ~Mesh();
-    void Draw(GLuint shaderProgram) const;
+
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+
+    GLuint getVao() const { return m_pool.getVao(); }
+    const MeshPool::Range &getRange() const { return m_range; }
+    const Texture &getTexture() const { return m_texture; }
+    const glm::vec4 &getUVRect() const { return m_uvRect; }
+    // local-space AABB of the vertices
+    const glm::vec2 &getBoundsMin() const { return m_boundsMin; }
+    const glm::vec2 &getBoundsMax() const { return m_boundsMax; }
 
   private:
-    GLuint m_vao, m_vbo, m_ebo;
-    GLsizei m_indexCount;
+    void upload(const std::vector<Vertex> &verts, const std::vector<unsigned> &idx);
+
+    MeshPool &m_pool;
+    MeshPool::Range m_range;
     Texture &m_texture;
-};
\ No newline at end of file
+    glm::vec4 m_uvRect;
+    glm::vec2 m_boundsMin, m_boundsMax;
+};
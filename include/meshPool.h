@@ -0,0 +1,91 @@
+#pragma once // meshPool.h
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <map>
+#include <vector>
+
+struct Vertex
+{
+    glm::vec2 m_position;
+    glm::vec2 m_texCoords; // uv
+};
+
+// All static geometry in one vertex and one index buffer behind one VAO.
+// Meshes are ranges in those buffers, drawn with a base vertex so their
+// indices stay 16-bit. The buffers grow by copying into larger ones.
+class MeshPool
+{
+  public:
+    enum class Layout
+    {
+        Float,  // vec2 position, vec2 uv: 16 bytes
+        Packed, // vec2 position, uv as normalized 16-bit: 12 bytes, uvs must be in [0, 1]
+    };
+
+    struct Range
+    {
+        uint32_t m_firstVertex = 0;
+        uint32_t m_vertexCount = 0;
+        uint32_t m_firstIndex = 0;
+        uint32_t m_indexCount = 0;
+    };
+
+    struct Stats
+    {
+        int m_meshes = 0;
+        size_t m_vertexBytes = 0;
+        size_t m_vertexCapacity = 0; // bytes
+        size_t m_indexBytes = 0;
+        size_t m_indexCapacity = 0;
+        int m_grows = 0;
+    };
+
+    static constexpr GLenum kIndexType = GL_UNSIGNED_SHORT;
+    using Index = uint16_t;
+
+    explicit MeshPool(Layout layout = Layout::Packed);
+    ~MeshPool();
+
+    MeshPool(const MeshPool &) = delete;
+    MeshPool &operator=(const MeshPool &) = delete;
+
+    void init(size_t vertexCapacity = 1 << 14, size_t indexCapacity = 1 << 16);
+    void cleanup();
+
+    // Copies the geometry in, throws when it doesn't fit the layout
+    Range allocate(const std::vector<Vertex> &verts, const std::vector<unsigned> &idx);
+    void release(const Range &range);
+
+    GLuint getVao() const { return m_vao; }
+    Layout getLayout() const { return m_layout; }
+    size_t getVertexSize() const;
+    const Stats &getStats() const { return m_stats; }
+
+  private:
+    // first fit over free ranges sorted by offset, neighbours merge on release
+    class FreeList
+    {
+      public:
+        void reset(size_t capacity);
+        void grow(size_t capacity);
+        bool allocate(size_t count, size_t &offset);
+        void release(size_t offset, size_t count);
+        size_t getCapacity() const { return m_capacity; }
+
+      private:
+        std::map<size_t, size_t> m_free; // offset -> count
+        size_t m_capacity = 0;
+    };
+
+    void growBuffer(GLuint &buffer, size_t usedBytes, size_t newBytes);
+    void setupVao();
+
+    Layout m_layout;
+    GLuint m_vao = 0, m_vbo = 0, m_ebo = 0;
+    FreeList m_vertices;
+    FreeList m_indices;
+    std::vector<uint8_t> m_staging;
+    Stats m_stats;
+};
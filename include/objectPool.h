@@ -0,0 +1,104 @@
+#pragma once // objectPool.h
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Fixed-size slots in chunks of kChunkSize, so objects sit next to each other
+// instead of wherever the heap put them. Freed slots are reused before a new
+// chunk is allocated; addresses stay stable.
+template <typename T, size_t kChunkSize = 256> class ObjectPool
+{
+  public:
+    struct Stats
+    {
+        size_t m_live = 0;
+        size_t m_capacity = 0; // slots
+        size_t m_chunks = 0;
+    };
+
+    ObjectPool() = default;
+    ~ObjectPool() { clear(); }
+
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    template <typename... Args> T *create(Args &&...args)
+    {
+        if (!m_free)
+        {
+            // chain the new chunk backwards so slots are handed out in address order
+            m_chunks.emplace_back(new Chunk());
+            Chunk &chunk = *m_chunks.back();
+            for (size_t i = kChunkSize; i-- > 0;)
+            {
+                chunk.m_slots[i].m_next = m_free;
+                m_free = &chunk.m_slots[i];
+            }
+        }
+        Slot *slot = m_free;
+        Slot *next = slot->m_next;
+        T *object = new (slot->m_storage) T(std::forward<Args>(args)...);
+        m_free = next;
+        Chunk *chunk = chunkOf(slot);
+        chunk->m_live[slot - chunk->m_slots] = true;
+        m_live++;
+        return object;
+    }
+
+    void destroy(T *object)
+    {
+        if (!object) return;
+        Slot *slot = reinterpret_cast<Slot *>(object);
+        Chunk *chunk = chunkOf(slot);
+        object->~T();
+        chunk->m_live[slot - chunk->m_slots] = false;
+        slot->m_next = m_free;
+        m_free = slot;
+        m_live--;
+    }
+
+    // Live objects in memory order
+    template <typename F> void forEach(F &&f)
+    {
+        for (auto &chunk : m_chunks)
+            for (size_t i = 0; i < kChunkSize; i++)
+                if (chunk->m_live[i]) f(*reinterpret_cast<T *>(chunk->m_slots[i].m_storage));
+    }
+
+    void clear()
+    {
+        forEach([this](T &object) { destroy(&object); });
+        m_chunks.clear();
+        m_free = nullptr;
+    }
+
+    size_t size() const { return m_live; }
+    Stats getStats() const { return {m_live, m_chunks.size() * kChunkSize, m_chunks.size()}; }
+
+  private:
+    union Slot
+    {
+        Slot *m_next;
+        alignas(T) unsigned char m_storage[sizeof(T)];
+    };
+
+    struct Chunk
+    {
+        Slot m_slots[kChunkSize];
+        bool m_live[kChunkSize] = {};
+    };
+
+    Chunk *chunkOf(Slot *slot) const
+    {
+        // a handful of chunks, a linear search beats a lookup table
+        for (auto &chunk : m_chunks)
+            if (slot >= chunk->m_slots && slot < chunk->m_slots + kChunkSize) return chunk.get();
+        return nullptr;
+    }
+
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    Slot *m_free = nullptr;
+    size_t m_live = 0;
+};
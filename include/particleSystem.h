@@ -0,0 +1,87 @@
+#pragma once // particleSystem.h
+#include "resourceManager.h"
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Tire smoke and sparks. A fixed ring of kCapacity particles stored as one
+// array per field:
+//  - emit() writes at the head and moves it on, the oldest particle is the one
+//    that gets overwritten, so nothing is ever allocated after init()
+//  - update() runs over the whole ring with SSE, dead slots included, so the
+//    cost is the same however many were emitted
+//  - draw() uploads the drawn fields as they are and issues one instanced
+//    draw; the quad comes from gl_VertexID and dead particles collapse in the
+//    vertex shader
+class ParticleSystem
+{
+  public:
+    enum Kind
+    {
+        Smoke,
+        Spark,
+        kKindCount
+    };
+
+    struct Stats
+    {
+        size_t m_alive = 0;
+        size_t m_emitted = 0;  // between the last two update() calls
+        size_t m_recycled = 0; // of those, written over a particle that was still alive
+        double m_ms = 0.0;     // last update()
+    };
+
+    static constexpr size_t kCapacity = 4096;
+
+    ParticleSystem() = default;
+    ~ParticleSystem();
+
+    ParticleSystem(const ParticleSystem &) = delete;
+    ParticleSystem &operator=(const ParticleSystem &) = delete;
+
+    void init(ResourceManager &resources);
+    void cleanup();
+
+    // 'count' particles around 'position', moving with 'velocity' plus the kind's spread
+    void emit(Kind kind, const glm::vec2 &position, const glm::vec2 &velocity, int count = 1);
+    // Ages and moves every slot by 'dt'
+    void update(float dt);
+    // Camera block has to be current; leaves premultiplied blending on
+    void draw();
+    // Everything dies at once, e.g. when the track changes
+    void clear();
+
+    const Stats &getStats() const { return m_stats; }
+
+  private:
+    // drawn fields first, they go to the GPU in one upload
+    enum Field
+    {
+        PosX,
+        PosY,
+        VelX,
+        VelY,
+        Age,  // 0 at birth, 1 and over is dead
+        Size,
+        Type, // Kind as a float
+        kDrawnFields,
+        InvLife = kDrawnFields,
+        Drag,
+        kFieldCount
+    };
+
+    float *field(Field which) { return m_data.data() + which * kCapacity; }
+
+    ResourceManager *m_resources = nullptr;
+    ShaderHandle m_shader;
+    GLuint m_vao = 0;
+    GLuint m_vbo = 0;
+
+    std::vector<float> m_data; // kFieldCount arrays of kCapacity
+    size_t m_head = 0;
+    size_t m_emitted = 0, m_recycled = 0; // since the last update()
+    uint32_t m_random = 0x2545F491u;
+    Stats m_stats;
+};
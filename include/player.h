@@ -1,11 +1,12 @@
 #pragma once // player.h
-#include "camera.h"
+#include "ecs.h"
+#include "inputState.h"
 #include "renderer.h"
-#include "sceneObject.h"
-#include "texture.h"
-#include <GLFW/glfw3.h>
+#include "textureAtlas.h"
 #include <glm/glm.hpp>
 
+class VehicleSystem;
+
 struct PlayerConstData
 {
     float maxSpeed;
@@ -32,18 +33,27 @@ class Player
 {
   public:
     Player();
-    void update(float deltaTime);
-    void handleInput(GLFWwindow *window, float deltaTime);
-    void init(Renderer &renderer);
+    void handleInput(const InputState &input, float deltaTime);
+    void init(Renderer &renderer, VehicleSystem &vehicles);
+    // Destroys the entity and gives the mesh back
+    void cleanup(Renderer &renderer);
+    // Around VehicleSystem::update each tick: input into the entity's VehicleControl, then the result back
+    void applyControls();
+    void readState();
+
+    Entity getEntity() const { return m_entity; }
+    // AI cars are drawn with the same mesh
+    MeshHandle getCarMesh() const { return m_carMesh; }
 
     PlayerData m_data;
     PlayerConstData m_constData;
 
   private:
-    void updateCamera(float deltaTime);
-
-  private:
-    SceneObject *m_carSprite;
-    Texture *m_carTexture;
-    Camera *m_camera;
+    VehicleSystem *m_vehicles;
+    size_t m_slot;
+    // a car sprite with Vehicle, Velocity, VehicleControl and CameraTarget
+    Entity m_entity;
+    World *m_world;
+    MeshHandle m_carMesh;
+    AtlasRegion m_carRegion;
 };
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once // pngWriter.h
+#include <cstdint>
+#include <string>
+
+// Just enough PNG to dump frames for image diffs: 8-bit RGBA, stored
+// (uncompressed) deflate blocks, no external dependencies
+namespace Png
+{
+// 'rgba' is width * height * 4 bytes; GL readbacks start at the bottom row
+bool write(const std::string &path, int width, int height, const uint8_t *rgba, bool bottomUp = true);
+} // namespace Png
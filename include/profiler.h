@@ -0,0 +1,166 @@
+#pragma once // profiler.h
+#include <GL/glew.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Frame profiler. CPU scopes go into a lock-free ring per thread (one writer,
+// drained by the main thread once per frame); GPU scopes are GL_TIMESTAMP
+// query pairs read back a few frames later, so nothing ever waits on the GPU.
+//
+//   PROFILE_SCOPE("Simulation");     // any thread
+//   PROFILE_GPU_SCOPE("drawAll");    // GL thread, also records a CPU scope
+//
+// Names must be string literals, only the pointer is stored.
+class Profiler
+{
+  public:
+    struct Event
+    {
+        const char *m_name;
+        uint64_t m_start; // ns since the profiler started
+        uint64_t m_end;
+        uint16_t m_thread; // kGpuThread for GPU events
+        uint16_t m_depth;
+    };
+
+    struct Frame
+    {
+        uint64_t m_index = 0;
+        uint64_t m_start = 0;
+        uint64_t m_end = 0;
+        bool m_gpuResolved = false;
+        std::vector<Event> m_events;
+    };
+
+    static constexpr uint16_t kGpuThread = 0xFFFF;
+
+    class Scope
+    {
+      public:
+        explicit Scope(const char *name);
+        ~Scope();
+
+      private:
+        const char *m_name;
+        uint64_t m_start;
+    };
+
+    class GpuScope
+    {
+      public:
+        explicit GpuScope(const char *name);
+        ~GpuScope();
+
+      private:
+        Scope m_cpu;
+        int m_query; // -1 when not recording
+    };
+
+    static Profiler &get();
+
+    // GL thread, with a current context
+    void initGpu();
+    void cleanupGpu();
+
+    // Main thread, around everything that belongs to one frame
+    void beginFrame();
+    void endFrame();
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled; }
+    // Shown in the timeline and the trace
+    static void setThreadName(const std::string &name);
+
+    // Writes the next 'frames' complete frames to a Chrome trace_event JSON file
+    void captureTrace(int frames = kTraceFrames, const std::string &path = kTracePath);
+    bool isCapturing() const { return m_captureRemaining > 0; }
+    // Blocks until outstanding GPU results are in and finishes any capture early
+    void flush();
+
+    static constexpr int kTraceFrames = 120;
+    static constexpr const char *kTracePath = "profile_trace.json";
+
+    // Timeline of the latest frame with GPU data, frame time history
+    void drawPanel(bool *open);
+
+    static uint64_t now();
+
+  private:
+    static constexpr size_t kRingSize = 1 << 14; // events per thread
+    static constexpr size_t kFrameHistory = 8;
+    static constexpr int kGpuLatency = 3; // frames before queries are read back
+    static constexpr int kPlotFrames = 240;
+
+    struct ThreadBuffer
+    {
+        std::string m_name;
+        uint16_t m_index = 0;
+        std::unique_ptr<Event[]> m_events{new Event[kRingSize]};
+        std::atomic<uint64_t> m_head{0}; // written by the owning thread only
+        uint64_t m_tail = 0;             // read by the main thread only
+        uint16_t m_depth = 0;
+    };
+
+    struct GpuQuery
+    {
+        const char *m_name;
+        uint16_t m_depth;
+    };
+
+    struct GpuFrame
+    {
+        uint64_t m_frame = 0;
+        int64_t m_clockOffset = 0; // CPU ns minus GPU ns at frame start
+        std::vector<GLuint> m_pool; // begin/end pairs
+        std::vector<GpuQuery> m_queries;
+        bool m_pending = false;
+    };
+
+    Profiler();
+
+    static ThreadBuffer &threadBuffer();
+    void record(const char *name, uint64_t start, uint64_t end);
+    int beginGpuQuery(const char *name);
+    void endGpuQuery(int query);
+    void resolveGpu(GpuFrame &gpu);
+    void frameResolved(Frame &frame);
+    void writeTrace() const;
+
+    std::atomic<bool> m_enabled{true};
+    mutable std::mutex m_threadsMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+    uint64_t m_lostEvents = 0;
+
+    std::array<Frame, kFrameHistory> m_frames;
+    uint64_t m_frameIndex = 0;
+    bool m_inFrame = false;
+
+    bool m_gpuReady = false;
+    std::array<GpuFrame, kGpuLatency> m_gpuFrames;
+    uint16_t m_gpuDepth = 0;
+    uint64_t m_gpuDropped = 0;
+
+    // panel
+    Frame m_display;
+    bool m_frozen = false;
+    bool m_freezeOnHitch = false;
+    float m_hitchMs = 33.0f;
+    float m_frameMs[kPlotFrames] = {};
+    int m_plotHead = 0;
+
+    // trace capture
+    int m_captureRemaining = 0;
+    uint64_t m_captureFirst = 0;
+    std::string m_capturePath;
+    std::vector<Event> m_captureEvents;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) Profiler::GpuScope PROFILE_CONCAT(profileGpuScope, __LINE__)(name)
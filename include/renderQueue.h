@@ -0,0 +1,110 @@
+#pragma once // renderQueue.h
+#include "frameArena.h"
+#include "mesh.h"
+#include <GL/glew.h>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+// per-instance attributes, matches locations 2..4 in vertex.glsl
+struct SpriteInstance
+{
+    glm::vec4 m_linear; // world x axis in xy, y axis in zw, see Affine2D
+    glm::vec2 m_translation;
+    glm::vec4 m_uvRect; // xy = offset, zw = size
+};
+
+// Per-frame command buffer. Every submit becomes a 64-bit sort key plus the
+// index of its instance data; execute() radix-sorts the keys and walks them,
+// binding program, texture and mesh only when they change and merging runs of
+// equal state into one instanced draw.
+//
+//   key: layer 8 | program 8 | texture 16 | mesh 16 | depth 16
+//
+// Layers draw strictly in order. Inside a layer commands group by state, so
+// depth only orders sprites that share a program, texture and mesh.
+//
+// Commands and instances live in the frame arena, sized from the last frame;
+// execute() has to run every frame before the arena drops them.
+class RenderQueue
+{
+  public:
+    enum Layer : uint8_t
+    {
+        Background = 0, // low-detail stand-ins under streamed ground tiles
+        Ground = 1,
+        Decals = 2, // skid marks baked over the ground
+        Cars = 3,
+        Overlay = 4,
+        kLayerCount
+    };
+
+    struct Stats
+    {
+        int m_commands = 0;
+        int m_instances = 0;
+        int m_drawCalls = 0;
+        int m_materials = 0; // distinct program + texture pairs
+        int m_programBinds = 0;
+        int m_textureBinds = 0;
+        int m_meshBinds = 0;
+    };
+
+    RenderQueue() = default;
+    ~RenderQueue();
+
+    RenderQueue(const RenderQueue &) = delete;
+    RenderQueue &operator=(const RenderQueue &) = delete;
+
+    void init();
+    void cleanup();
+
+    // Program for the submits that follow
+    void setProgram(GLuint program);
+    void submit(const Mesh &mesh, const SpriteInstance &instance, uint8_t layer, uint16_t depth);
+    // Sorts, uploads all instances at once and draws; the queue is empty afterwards
+    void execute();
+
+    const Stats &getStats() const { return m_stats; }
+
+  private:
+    struct Command
+    {
+        uint64_t m_key;
+        uint32_t m_instance;
+    };
+
+    struct MeshEntry
+    {
+        GLuint m_vao;
+        MeshPool::Range m_range;
+    };
+
+    static constexpr int kLayerShift = 56;
+    static constexpr int kProgramShift = 48;
+    static constexpr int kTextureShift = 32;
+    static constexpr int kMeshShift = 16;
+    // everything above the depth, equal state means one draw
+    static constexpr uint64_t kStateMask = ~(uint64_t)0xFFFF;
+
+    // GL names map to small ids that stay stable, so the grouping inside a layer doesn't shuffle between frames
+    uint16_t textureId(GLuint texture);
+    uint16_t meshId(const Mesh &mesh);
+    void sortCommands();
+    void bindInstanceAttributes(size_t firstInstance) const;
+
+    GLuint m_instanceVbo = 0;
+    size_t m_capacity = 0; // in instances
+
+    uint8_t m_program = 0;
+    std::vector<GLuint> m_programs;
+    std::vector<GLuint> m_textures;
+    std::vector<MeshEntry> m_meshes;
+    std::unordered_map<GLuint, uint16_t> m_textureIds;
+    std::unordered_map<uint64_t, uint16_t> m_meshIds; // pool VAO << 32 | first index
+
+    FrameVector<Command> m_commands;
+    FrameVector<SpriteInstance> m_instances;
+    Stats m_stats;
+};
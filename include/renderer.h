@@ -1,12 +1,28 @@
 #pragma once // renderer.h
 #include "camera.h"
+#include "meshPool.h"
+#include "particleSystem.h"
+#include "renderQueue.h"
+#include "resourceManager.h"
 #include "sceneManager.h"
 #include "shader.h"
+#include "skidMarks.h"
+#include "textureAtlas.h"
+#include "textureStreamer.h"
+#include "uniformBuffer.h"
 #include <GLFW/glfw3.h>
 
 class Renderer
 {
   public:
+    // Program permutations of the sprite shader, all built at init so switching never compiles
+    enum DebugView
+    {
+        Normal,
+        Overdraw, // every sprite adds the same tint, hot spots are drawn many times over
+        kDebugViewCount,
+    };
+
     Renderer(int width, int height);
 
     // init GL contexts, shaders, camera, scene
@@ -17,11 +33,30 @@ class Renderer
 
     SceneManager &getScene();
     Camera &getCamera();
+    TextureAtlas &getAtlas();
+    MeshPool &getMeshPool();
+    ResourceManager &getResources();
+    TextureStreamer &getStreamer();
+    ParticleSystem &getParticles();
+    SkidMarks &getSkidMarks();
+    const RenderQueue::Stats &getStats() const;
+
+    void setDebugView(DebugView view) { m_debugView = view; }
+    DebugView getDebugView() const { return m_debugView; }
 
   private:
     int m_width, m_height;
     GLFWwindow *m_window;
-    Shader m_shader;
+    ShaderHandle m_shaders[kDebugViewCount];
+    DebugView m_debugView = Normal;
+    UniformBuffer m_cameraBuffer;
     Camera m_camera;
     SceneManager m_scene;
+    RenderQueue m_queue;
+    MeshPool m_meshPool;
+    TextureAtlas m_atlas;
+    TextureStreamer m_streamer;
+    ResourceManager m_resources;
+    ParticleSystem m_particles;
+    SkidMarks m_skidMarks;
 };
\ No newline at end of file
@@ -0,0 +1,167 @@
+#pragma once // resourceManager.h
+#include "mesh.h"
+#include "meshPool.h"
+#include "shader.h"
+#include "texture.h"
+#include "textureAtlas.h"
+#include "textureStreamer.h"
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Index plus generation: once the slot is freed and reused, old handles stop
+// resolving instead of pointing at someone else's resource
+template <typename T> struct Handle
+{
+    uint32_t m_index = 0; // slot + 1, 0 is the null handle
+    uint32_t m_generation = 0;
+
+    explicit operator bool() const { return m_index != 0; }
+    bool operator==(const Handle &other) const { return m_index == other.m_index && m_generation == other.m_generation; }
+    bool operator!=(const Handle &other) const { return !(*this == other); }
+};
+
+using TextureHandle = Handle<Texture>;
+using MeshHandle = Handle<Mesh>;
+using ShaderHandle = Handle<Shader>;
+
+// Owns textures, meshes and shaders behind generational handles.
+//  - loads are deduplicated by canonical path, then by content hash; files
+//    are only read and hashed when the path isn't known yet
+//  - every load / addRef needs a release; at zero references the resource
+//    stays cached as unused and is evicted least recently used first once
+//    its kind goes over budget
+//  - evicted GL objects are deleted only after a fence shows the GPU is done
+//    with the frames that could still use them
+class ResourceManager
+{
+  public:
+    struct Budget
+    {
+        size_t m_textureBytes = 256 * 1024 * 1024; // estimated, mips included
+        size_t m_meshBytes = 4 * 1024 * 1024;      // pool bytes
+        int m_unusedShaders = 8;
+    };
+
+    struct Stats
+    {
+        int m_textures = 0;
+        int m_meshes = 0;
+        int m_shaders = 0;
+        int m_unused = 0; // cached with no references
+        size_t m_textureBytes = 0;
+        size_t m_meshBytes = 0;
+        int m_loads = 0;
+        int m_pathHits = 0;
+        int m_contentHits = 0;
+        int m_evictions = 0;
+        int m_pendingDeletes = 0; // waiting on a fence
+    };
+
+    ResourceManager() = default;
+    ~ResourceManager();
+
+    ResourceManager(const ResourceManager &) = delete;
+    ResourceManager &operator=(const ResourceManager &) = delete;
+
+    void init(TextureStreamer &streamer, MeshPool &meshPool);
+    // Deletes everything right away, outstanding handles go stale
+    void cleanup();
+
+    // Streamed in the background, a placeholder until then
+    TextureHandle loadTexture(const std::string &path, bool flipVertically = true, GLint wrap = GL_REPEAT);
+    // Empty storage to render into, never shared
+    TextureHandle createTexture(int width, int height, GLint wrap = GL_CLAMP_TO_EDGE);
+    // GL thread: right away when the texture is already in (or failed), else once the streamer is done
+    // with it; forgotten if the last reference goes first
+    void whenReady(TextureHandle handle, TextureStreamer::ReadyCallback onReady);
+    // The mesh holds its own reference to the texture
+    MeshHandle createMesh(const std::vector<Vertex> &verts, const std::vector<unsigned> &idx, TextureHandle texture);
+    // Atlas pages live as long as the atlas, they are not counted
+    MeshHandle createMesh(const std::vector<Vertex> &verts, const std::vector<unsigned> &idx, const AtlasRegion &region);
+    // Throws when the program doesn't build
+    ShaderHandle loadShader(const std::string &vertPath, const std::string &fragPath, const std::vector<std::string> &defines = {});
+    // Several permutations in one go, built together (see Shader::buildPrograms)
+    std::vector<ShaderHandle> loadShaders(const std::vector<Shader::Variant> &variants);
+
+    void addRef(TextureHandle handle);
+    void addRef(MeshHandle handle);
+    void addRef(ShaderHandle handle);
+    void release(TextureHandle handle);
+    void release(MeshHandle handle);
+    void release(ShaderHandle handle);
+
+    // nullptr for null or stale handles
+    Texture *get(TextureHandle handle) const;
+    const Mesh *get(MeshHandle handle) const;
+    Shader *get(ShaderHandle handle) const;
+
+    // GL thread, after the frame's draws: evicts over budget, fences the evictions, deletes what the GPU is done with
+    void endFrame();
+
+    void setBudget(const Budget &budget) { m_budget = budget; }
+    const Budget &getBudget() const { return m_budget; }
+    const Stats &getStats() const { return m_stats; }
+
+  private:
+    template <typename T> struct Slot
+    {
+        std::shared_ptr<T> m_resource; // empty when the slot is free
+        uint32_t m_generation = 1;
+        int m_refs = 0;
+        size_t m_bytes = 0;
+        uint64_t m_contentHash = 0;
+        std::string m_key;             // path key, empty for meshes
+        TextureHandle m_texture;       // meshes only
+        std::list<uint32_t>::iterator m_lru; // valid while unused
+        // textures only, until the streamer reports back
+        bool m_loading = false;
+        bool m_failed = false;
+        std::vector<TextureStreamer::ReadyCallback> m_waiting;
+    };
+
+    template <typename T> struct Table
+    {
+        std::vector<Slot<T>> m_slots;
+        std::vector<uint32_t> m_free;
+        std::list<uint32_t> m_unused; // least recently used first
+        std::unordered_map<std::string, uint32_t> m_byPath;
+        std::unordered_map<uint64_t, uint32_t> m_byContent;
+        size_t m_bytes = 0;
+    };
+
+    // resources evicted in the same frame share a fence
+    struct Retired
+    {
+        std::vector<std::shared_ptr<void>> m_resources;
+        GLsync m_fence = nullptr;
+    };
+
+    template <typename T> Slot<T> *resolve(const Table<T> &table, Handle<T> handle) const;
+    template <typename T> Handle<T> insert(Table<T> &table, std::shared_ptr<T> resource, size_t bytes, uint64_t contentHash, const std::string &key);
+    template <typename T> Handle<T> reuse(Table<T> &table, uint32_t index);
+    template <typename T> void addRef(Table<T> &table, Handle<T> handle);
+    template <typename T> void release(Table<T> &table, Handle<T> handle);
+    template <typename T> void evict(Table<T> &table, uint32_t index);
+    template <typename T> void trim(Table<T> &table, size_t byteBudget, size_t countBudget);
+    MeshHandle createMesh(std::unique_ptr<Mesh> mesh, uint64_t contentHash, TextureHandle texture);
+    void textureReady(TextureHandle handle, bool loaded);
+    void updateTextureSizes();
+    void trimTextures();
+    void collectRetired();
+
+    TextureStreamer *m_streamer = nullptr;
+    MeshPool *m_meshPool = nullptr;
+    Table<Texture> m_textures;
+    Table<Mesh> m_meshes;
+    Table<Shader> m_shaders;
+    std::vector<std::shared_ptr<void>> m_evicted; // this frame, not fenced yet
+    std::list<Retired> m_retired;
+    Budget m_budget;
+    Stats m_stats;
+};
@@ -1,13 +1,87 @@
 #pragma once // sceneManager.h
-#include "sceneObject.h"
+#include "camera.h"
+#include "components.h"
+#include "ecs.h"
+#include "renderQueue.h"
+#include "transformStore.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <unordered_map>
 #include <vector>
 
+class JobSystem;
+
+// Owns the World and the sprites in it. Transforms live in a TransformStore,
+// so only what moved is recomputed. Sprite bounds sit in a uniform grid so
+// each frame only the cells under the camera are visited.
 class SceneManager
 {
   public:
-    void addObject(SceneObject *object);
-    void drawAll(GLuint shaderProgram) const;
+    struct Stats
+    {
+        int m_submitted = 0;
+        int m_culled = 0;
+        int m_cellsVisited = 0;
+    };
+
+    explicit SceneManager(float cellSize = 256.0f);
+
+    // An entity with TransformNode, Sprite and Bounds plus any extra components
+    template <typename... Cs> Entity createSprite(const Mesh &mesh, const Transform2D &transform, uint8_t layer, const Cs &...extra);
+    // Nothing to draw, just a parent for others
+    Entity createNode(const Transform2D &transform);
+    // Children stay, moved up to the root
+    void destroy(Entity entity);
+    // The child's transform becomes relative to the parent; a null parent detaches
+    void setParent(Entity child, Entity parent);
+    void setTransform(Entity entity, const Transform2D &transform);
+    Transform2D getTransform(Entity entity) const;
+    // Recomputes the world transforms that changed, then the bounds of those
+    // sprites, re-bucketing the ones that left their cells; once per frame
+    // after the systems moved things
+    void updateBounds(JobSystem *jobs = nullptr);
+    // Submits the sprites overlapping the camera view, the queue sorts them
+    void drawAll(RenderQueue &queue, const Camera &camera);
+
+    World &getWorld() { return m_world; }
+    TransformStore &getTransforms() { return m_transforms; }
+    const Stats &getStats() const { return m_stats; }
 
   private:
-    std::vector<SceneObject *> m_objects;
-};
\ No newline at end of file
+    Sprite makeSprite(const Mesh &mesh, uint8_t layer);
+    // renumbers the layer's live sprites from 0, keeping their order
+    void compactOrders(uint8_t layer);
+    void computeBounds(const Affine2D &world, const Sprite &sprite, Bounds &bounds) const;
+    void insert(Entity entity, Bounds &bounds);
+    void remove(Entity entity, const Bounds &bounds);
+    glm::ivec2 cellOf(const glm::vec2 &position) const;
+    static uint64_t cellKey(int x, int y) { return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y; }
+
+    // wider than this many cells on either axis and the sprite skips the grid
+    static constexpr int kMaxCellSpan = 8;
+    // moved sprites per bounds job
+    static constexpr size_t kBoundsGrain = 256;
+    // the depth field of the sort key
+    static constexpr uint32_t kMaxOrder = 0xFFFF;
+
+    float m_cellSize;
+    World m_world;
+    TransformStore m_transforms;
+    std::vector<Entity> m_large;
+    std::unordered_map<uint64_t, std::vector<Entity>> m_cells;
+    uint32_t m_stamp;
+    uint32_t m_nextOrder[RenderQueue::kLayerCount];
+    Stats m_stats;
+};
+
+template <typename... Cs> Entity SceneManager::createSprite(const Mesh &mesh, const Transform2D &transform, uint8_t layer, const Cs &...extra)
+{
+    Sprite sprite = makeSprite(mesh, layer);
+    Entity entity = m_world.create(TransformNode(), sprite, Bounds(), extra...);
+    uint32_t node = m_transforms.create(entity, transform);
+    m_world.get<TransformNode>(entity)->m_node = node;
+    Bounds &bounds = *m_world.get<Bounds>(entity);
+    computeBounds(m_transforms.getWorld(node), sprite, bounds);
+    insert(entity, bounds);
+    return entity;
+}
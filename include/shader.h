@@ -1,11 +1,17 @@
 #pragma once // shader.h
 #include <GL/glew.h>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <string>
+#include <vector>
 
 class Shader
 {
   public:
+    // Location of a uniform, resolved once after linking. -1 is ignored by GL.
+    using UniformHandle = GLint;
+    static constexpr UniformHandle kInvalidUniform = -1;
+
     Shader() = default;
     ~Shader();
 
@@ -16,23 +22,60 @@ class Shader
     Shader(Shader &&other) noexcept;
     Shader &operator=(Shader &&other) noexcept;
 
+    // One permutation of a program: the defines go in right after #version
+    struct Variant
+    {
+        std::string m_vertPath;
+        std::string m_fragPath;
+        std::vector<std::string> m_defines; // "NAME" or "NAME value"
+    };
+
     // Build from vertex & fragment shader paths
     static Shader buildShaderProgram(const char *vertPath, const char *fragPath);
+    // Builds several at once. Binaries come from ShaderCache, every miss is
+    // compiled and linked before any is waited on, so a driver with parallel
+    // shader compile works on all of them together. Throws on the first failure.
+    static std::vector<Shader> buildPrograms(const std::vector<Variant> &variants);
 
     void use() const;
     GLuint id() const;
 
-    // Uniform utilities
-    void setMat4(const std::string &name, const glm::mat4 &mat) const;
-    void setFloat(const std::string &name, float value) const;
-    void setVec2(const std::string &name, const glm::vec2 &vec) const;
-    void setInt(const std::string &name, int value) const;
+    // Look up reflected uniforms / blocks, no GL call involved
+    UniformHandle uniform(const char *name) const;
+    GLint uniformBlock(const char *name) const;
+
+    // Uniform utilities, for the program bound with use(); unchanged values are not re-sent
+    void setMat4(UniformHandle handle, const glm::mat4 &mat) const;
+    void setFloat(UniformHandle handle, float value) const;
+    void setVec2(UniformHandle handle, const glm::vec2 &vec) const;
+    void setInt(UniformHandle handle, int value) const;
 
   private:
+    // compile and link only start the work, checkProgram waits for it and throws with the logs
     static GLuint compileShader(GLenum type, const char *src);
     static std::string loadFile(const char *path);
-    static GLuint linkProgram(GLuint vertShader, GLuint fragShader);
+    static std::string injectDefines(const std::string &source, const std::vector<std::string> &defines);
+    static void linkProgram(GLuint program, GLuint vertShader, GLuint fragShader, bool retrievable);
+    static void checkProgram(GLuint program, GLuint vertShader, GLuint fragShader);
 
     explicit Shader(GLuint programID);
+    void release();
+
+    // Lists active uniforms and uniform blocks, binds shared blocks
+    void reflect();
+
+    struct Entry
+    {
+        uint32_t m_hash = 0;
+        GLint m_value = -1; // uniform location or block index
+        bool m_isBlock = false;
+        std::string m_name;
+    };
+    // open addressing, power of two size
+    void insertEntry(Entry entry);
+    const Entry *findEntry(const char *name, bool isBlock) const;
+    static uint32_t hashName(const char *name);
+
     GLuint m_id{0};
-};
\ No newline at end of file
+    std::vector<Entry> m_table;
+};
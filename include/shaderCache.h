@@ -0,0 +1,63 @@
+#pragma once // shaderCache.h
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+
+// Linked programs kept on disk as glGetProgramBinary blobs, one file per
+// program, so a warm start skips compiling and linking. The key covers the
+// sources with their defines and the driver's vendor, renderer and version
+// strings: a driver update misses instead of feeding it a stale binary.
+// A binary the driver rejects anyway is deleted and the program compiled.
+class ShaderCache
+{
+  public:
+    struct Stats
+    {
+        int m_programs = 0; // built since start
+        int m_hits = 0;     // loaded from a binary
+        int m_compiled = 0;
+        int m_rejected = 0; // binaries the driver refused
+        int m_written = 0;
+        double m_buildMs = 0.0; // wall time of every build, hits and compiles
+    };
+
+    static ShaderCache &get();
+
+    // GL thread, after glewInit. Without program binaries every program is compiled.
+    void init(const std::string &directory);
+
+    bool isEnabled() const { return m_enabled; }
+    // the driver links on its own threads, KHR/ARB_parallel_shader_compile
+    bool isParallel() const { return m_parallel; }
+
+    uint64_t key(const std::string &vertSource, const std::string &fragSource) const;
+    // false when there is no binary or the driver rejects it, 'program' is then still unlinked
+    bool load(uint64_t key, GLuint program);
+    // 'program' must be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    void store(uint64_t key, GLuint program);
+
+    void countBuild(int programs, int compiled, double ms);
+    const Stats &getStats() const { return m_stats; }
+
+  private:
+    struct BinaryHeader
+    {
+        char m_magic[4];
+        uint32_t m_version;
+        uint64_t m_key;
+        uint32_t m_format; // GLenum from glGetProgramBinary
+        uint32_t m_length;
+    };
+
+    static constexpr char kMagic[4] = {'P', 'B', 'I', 'N'};
+    static constexpr uint32_t kVersion = 1;
+
+    ShaderCache() = default;
+    std::string pathOf(uint64_t key) const;
+
+    std::string m_directory;
+    uint64_t m_driverHash = 0;
+    bool m_enabled = false;
+    bool m_parallel = false;
+    Stats m_stats;
+};
@@ -0,0 +1,82 @@
+#pragma once // skidMarks.h
+#include "ecs.h"
+#include "resourceManager.h"
+#include <GL/glew.h>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+class SceneManager;
+
+// Tire marks baked into one persistent texture laid over the track.
+//  - add() queues a stretch of rubber, flush() draws everything queued into
+//    the texture through an FBO in one instanced draw and forgets it
+//  - the texture is drawn as a single sprite in RenderQueue::Decals, so marks
+//    cost the same to draw and take the same memory however many were laid;
+//    texture and quad are ResourceManager handles, counted in its budgets
+//  - marks stack up where cars keep sliding, nothing ever fades
+class SkidMarks
+{
+  public:
+    struct Stats
+    {
+        size_t m_segments = 0; // baked in the last flush
+        size_t m_dropped = 0;  // since setArea, added past kMaxSegments in one frame
+        size_t m_bytes = 0;    // of the texture, fixed
+    };
+
+    // texels on each side, over whatever area the track covers
+    static constexpr int kResolution = 2048;
+    static constexpr size_t kMaxSegments = 1024;
+
+    SkidMarks() = default;
+    ~SkidMarks();
+
+    SkidMarks(const SkidMarks &) = delete;
+    SkidMarks &operator=(const SkidMarks &) = delete;
+
+    void init(ResourceManager &resources, SceneManager &scene);
+    void cleanup();
+
+    // Wipes the marks and lays the texture over [worldMin, worldMax]
+    void setArea(const glm::vec2 &worldMin, const glm::vec2 &worldMax);
+    // A mark from 'from' to 'to', 'strength' is its opacity for one pass
+    void add(const glm::vec2 &from, const glm::vec2 &to, float halfWidth, float strength);
+    // Before the scene is drawn; restores the framebuffer and viewport it found
+    void flush();
+
+    const Stats &getStats() const { return m_stats; }
+
+  private:
+    // per-instance attributes, matches skidVertex.glsl
+    struct Segment
+    {
+        glm::vec4 m_ends;  // from in xy, to in zw
+        glm::vec2 m_shape; // half width, strength
+    };
+
+    // binds the FBO with a viewport over the whole texture, restore() puts back what was bound
+    struct Target
+    {
+        GLint m_framebuffer = 0;
+        GLint m_viewport[4] = {};
+        void restore() const;
+    };
+    Target bindTarget() const;
+
+    ResourceManager *m_resources = nullptr;
+    SceneManager *m_scene = nullptr;
+    ShaderHandle m_shader;
+    Shader::UniformHandle m_areaMin = Shader::kInvalidUniform, m_areaScale = Shader::kInvalidUniform;
+
+    TextureHandle m_texture;
+    MeshHandle m_mesh;
+    Entity m_entity;
+    GLuint m_fbo = 0;
+    GLuint m_vao = 0;
+    GLuint m_vbo = 0;
+
+    glm::vec2 m_worldMin = glm::vec2(0.0f), m_worldMax = glm::vec2(1.0f);
+    std::vector<Segment> m_pending;
+    Stats m_stats;
+};
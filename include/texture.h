@@ -1,28 +1,50 @@
 #pragma once // texture.h
 
+#include "cookedTexture.h"
 #include <GL/glew.h>
 #include <string>
 
 class Texture
 {
   public:
-    // Loads the texture from 'path'. Throws on failure.
+    // Loads the texture from 'path', preferring a cooked 'path.ctex' when present. Throws on failure.
     Texture(const std::string &path, bool flipVertically = true);
+    // Allocates an empty RGBA8 texture, e.g. an atlas page or a streaming placeholder
+    Texture(int width, int height, GLint wrap = GL_CLAMP_TO_EDGE);
     Texture() = default;
 
     // Cleans up the GPU resource.
     ~Texture();
 
+    // owns a GL name, never copy it
+    Texture(const Texture &) = delete;
+    Texture &operator=(const Texture &) = delete;
+
     /// Bind to the given texture unit (0,1,2...)
     void Bind(GLuint unit = 0) const;
 
-    // Unbinds any texture from GL_TEXTURE_2D
+    // Unbinds any texture from GL_TEXTURE_2D on unit 0
     static void Unbind();
 
+    // Re-specifies 'levels' empty mip levels, keeping the GL name
+    void Allocate(int width, int height, int levels = 1, Cooked::Format format = Cooked::Format::RGBA8);
+    // Writes RGBA8 pixels into the rectangle starting at (x, y).
+    // With a GL_PIXEL_UNPACK_BUFFER bound, 'rgba' is an offset into it.
+    void Upload(int x, int y, int width, int height, const unsigned char *rgba, int level = 0);
+    void UploadCompressed(int x, int y, int width, int height, Cooked::Format format, GLsizei size, const void *data, int level = 0);
+
+    // GL internal format for a cooked format, 0 if the driver can't sample it
+    static GLenum CookedFormat(Cooked::Format format);
+    void GenerateMipmaps();
+
     // Returns the raw OpenGL texture handle
     GLuint GetID() const { return m_id; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
 
   private:
+    bool LoadCooked(const std::string &path, bool flipVertically);
+
     GLuint m_id = 0;
     int m_width = 0, m_height = 0, m_channels = 0;
 };
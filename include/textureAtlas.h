@@ -0,0 +1,66 @@
+#pragma once // textureAtlas.h
+#include "texture.h"
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Sub-rectangle of an atlas page
+struct AtlasRegion
+{
+    Texture *m_page = nullptr;
+    glm::vec4 m_uvRect{0.0f, 0.0f, 1.0f, 1.0f}; // xy = offset, zw = size
+    int m_width = 0, m_height = 0;
+};
+
+// Bottom-left skyline bin packer
+class SkylinePacker
+{
+  public:
+    SkylinePacker(int width, int height);
+    // Finds a spot for a w*h rect, false if the page is full
+    bool pack(int w, int h, int &outX, int &outY);
+    float occupancy() const;
+
+  private:
+    struct Node
+    {
+        int m_x, m_y, m_width;
+    };
+    int fit(size_t index, int w, int h) const;
+    void addLevel(size_t index, int x, int y, int w, int h);
+
+    int m_width, m_height;
+    long long m_usedArea = 0;
+    std::vector<Node> m_skyline;
+};
+
+class TextureAtlas
+{
+  public:
+    explicit TextureAtlas(int pageSize = 1024, int padding = 2);
+
+    // Decodes 'path' and packs it into the first page with room. Throws on failure.
+    AtlasRegion add(const std::string &path, bool flipVertically = true);
+    AtlasRegion add(const unsigned char *rgba, int width, int height);
+
+    // Rebuilds mipmaps of pages touched since the last call
+    void flush();
+    void cleanup();
+
+    size_t getPageCount() const { return m_pages.size(); }
+    float getOccupancy(size_t page) const { return m_pages[page].m_packer.occupancy(); }
+
+  private:
+    struct Page
+    {
+        std::unique_ptr<Texture> m_texture;
+        SkylinePacker m_packer;
+        bool m_dirty;
+    };
+
+    int m_pageSize;
+    int m_padding;
+    std::vector<Page> m_pages;
+    std::vector<unsigned char> m_scratch;
+};
@@ -0,0 +1,109 @@
+#pragma once // textureStreamer.h
+#include "cookedTexture.h"
+#include "texture.h"
+#include <GL/glew.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decodes images on worker threads and uploads them on the GL thread through
+// a ring of pixel-unpack buffers, at most 'uploadBudget' bytes per frame.
+// Cooked textures skip the decode and are copied out of their mapping.
+class TextureStreamer
+{
+  public:
+    struct Stats
+    {
+        int m_pending = 0;        // requested but not fully uploaded
+        int m_completed = 0;      // since startup
+        size_t m_frameBytes = 0;  // uploaded during the last update()
+        double m_frameMs = 0.0;   // CPU time of the last update()
+        double m_maxFrameMs = 0.0;
+    };
+
+    // GL thread, once the texture is fully uploaded (true) or failed to load (false)
+    using ReadyCallback = std::function<void(bool loaded)>;
+
+    TextureStreamer() = default;
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    // Spawns the decode workers, 0 = one per core minus the GL thread
+    void init(int workerCount = 0, size_t uploadBudget = 4 * 1024 * 1024);
+    void cleanup();
+
+    // Returns immediately with a 1x1 placeholder that is filled in later.
+    // Dropping the last reference cancels the upload, and 'onReady' with it.
+    std::shared_ptr<Texture> request(const std::string &path, bool flipVertically = true, GLint wrap = GL_REPEAT, ReadyCallback onReady = nullptr);
+
+    // GL thread, once per frame
+    void update();
+
+    void setUploadBudget(size_t bytes) { m_uploadBudget = bytes; }
+    size_t getUploadBudget() const { return m_uploadBudget; }
+    const Stats &getStats() const { return m_stats; }
+    // stats lag a frame behind request(), the live count does not
+    bool idle() const { return m_requested == 0; }
+
+  private:
+    struct Job
+    {
+        std::string m_path;
+        bool m_flip;
+        std::weak_ptr<Texture> m_target;
+        ReadyCallback m_onReady;
+    };
+    struct Level
+    {
+        const unsigned char *m_data;
+        int m_width, m_height;
+    };
+    struct Decoded
+    {
+        std::weak_ptr<Texture> m_target;
+        ReadyCallback m_onReady;
+        std::string m_path;
+        unsigned char *m_pixels = nullptr; // stbi owned, RGBA8
+        std::unique_ptr<CookedTextureFile> m_cooked;
+        Cooked::Format m_format = Cooked::Format::RGBA8;
+        std::vector<Level> m_levels; // empty if loading failed
+        size_t m_level = 0;
+        int m_nextRow = 0;
+        bool m_allocated = false;
+    };
+    struct Slot
+    {
+        GLuint m_pbo = 0;
+        size_t m_size = 0; // bytes allocated, each slot grows on its own when used
+        GLsync m_fence = nullptr;
+    };
+
+    void workerLoop();
+    static bool loadCooked(Decoded &image, bool flip);
+    // false when every PBO is still in flight or the map failed; the rows stay pending
+    bool uploadRows(Decoded &image, size_t budget, size_t &uploaded);
+    static void release(Decoded &image);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<Job> m_jobs;
+    std::deque<Decoded> m_decoded; // guarded by m_mutex
+    bool m_quit = false;
+
+    // GL thread only
+    std::deque<Decoded> m_uploading;
+    std::vector<Slot> m_ring;
+    size_t m_nextSlot = 0;
+    size_t m_slotSize = 0; // what a slot should hold, the largest band so far
+    size_t m_uploadBudget = 0;
+    int m_requested = 0;
+    Stats m_stats;
+};
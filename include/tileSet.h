@@ -0,0 +1,52 @@
+#pragma once // tileSet.h
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A track image split into square tiles, written by asset_cooker --tile or
+// by TileWorld the first time it loads an image without them:
+//   race_track.png.tiles/manifest         Tiles::Manifest
+//   race_track.png.tiles/3_1.png          column 3, row 1 (or 3_1.png.ctex,
+//                                         which the streamer prefers)
+//   race_track.png.tiles/overview.png     the whole image shrunk to one tile
+// Rows are counted in the order the image is loaded in, so from the bottom
+// when it is flipped like the textures.
+namespace Tiles
+{
+constexpr char kMagic[4] = {'T', 'I', 'L', 'E'};
+constexpr uint32_t kVersion = 2;
+constexpr uint32_t kDefaultTileSize = 256;
+constexpr const char *kExtension = ".tiles";
+
+struct Manifest
+{
+    char m_magic[4];
+    uint32_t m_version;
+    uint32_t m_width; // of the source image
+    uint32_t m_height;
+    uint32_t m_tileSize;
+    uint32_t m_columns;
+    uint32_t m_rows;
+    uint32_t m_flipped;
+    // of the image the tiles sit next to, checked without reading it; the cooker
+    // runs after every resources copy, so the copy's time is the one stored
+    uint64_t m_sourceSize;
+    int64_t m_sourceTime;
+};
+
+std::string directory(const std::string &imagePath);
+std::string tilePath(const std::string &imagePath, uint32_t column, uint32_t row);
+std::string overviewPath(const std::string &imagePath);
+
+// Size and modification time, false if the file isn't there
+bool stampSource(const std::string &imagePath, uint64_t &size, int64_t &time);
+// False when missing, malformed, split the other way up or made from another version of the image
+bool readManifest(const std::string &imagePath, bool flipped, Manifest &out);
+// 'imagePath' is where the tiles go, which for the cooker is not where the source is
+bool writeManifest(const std::string &imagePath, const Manifest &manifest);
+
+// Copies one tile out of an RGBA8 image, edge tiles are smaller
+void extract(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t tileSize, uint32_t column, uint32_t row, std::vector<uint8_t> &out, uint32_t &outWidth, uint32_t &outHeight);
+// Halves the image with a box filter until it fits in one tile
+void shrink(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t tileSize, std::vector<uint8_t> &out, uint32_t &outWidth, uint32_t &outHeight);
+} // namespace Tiles
@@ -0,0 +1,121 @@
+#pragma once // tileWorld.h
+#include "camera.h"
+#include "ecs.h"
+#include "resourceManager.h"
+#include "tileSet.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+class JobSystem;
+class SceneManager;
+
+// Ground made of tiles streamed in around the camera, so a track can be far
+// larger than one texture and only the part near the car is resident.
+//  - tiles come from <image>.tiles/, split on load when missing or stale
+//  - every frame the tiles under the view, half a tile around it and the
+//    same again where the camera is heading are wanted; nearest first, a
+//    few new requests per frame
+//  - at most 'cacheSize' tiles are loading or resident, the one wanted
+//    longest ago goes first; textures and quads go through the
+//    ResourceManager, so a dropped tile stays cached there until the
+//    texture budget needs the room
+//  - a one-tile overview of the whole image sits underneath, so tiles still
+//    on their way show blurry instead of missing
+class TileWorld
+{
+  public:
+    struct Stats
+    {
+        int m_tiles = 0;
+        int m_resident = 0;
+        int m_loading = 0;
+        int m_waiting = 0; // wanted but not requested yet
+        int m_requests = 0; // since load
+        int m_evictions = 0;
+        size_t m_residentBytes = 0; // estimated, mips included
+        float m_lookahead = 0.0f;   // how far ahead of the view tiles are prefetched, world units
+        double m_splitMs = 0.0;     // 0 when the tiles were already on disk
+    };
+
+    static constexpr int kDefaultCacheSize = 64;
+
+    TileWorld() = default;
+    ~TileWorld() { unload(); }
+
+    TileWorld(const TileWorld &) = delete;
+    TileWorld &operator=(const TileWorld &) = delete;
+
+    void init(SceneManager &scene, ResourceManager &resources);
+    // The image covers [worldMin, worldMax]; nothing is drawn until update() asks for tiles
+    void load(const std::string &imagePath, const glm::vec2 &worldMin, const glm::vec2 &worldMax, bool flipVertically = true, JobSystem *jobs = nullptr);
+    void unload();
+
+    // Once per frame after the camera moved
+    void update(const Camera &camera, float frameTime);
+    // Everything the camera wants is resident
+    bool idle() const { return m_updated && m_stats.m_loading == 0 && m_stats.m_waiting == 0; }
+
+    void setCacheSize(int tiles) { m_cacheSize = tiles < kMinCacheSize ? kMinCacheSize : tiles; }
+    int getCacheSize() const { return m_cacheSize; }
+    const Stats &getStats() const { return m_stats; }
+
+  private:
+    enum class State : uint8_t
+    {
+        Unloaded,
+        Loading,
+        Resident,
+        Failed,
+    };
+
+    struct Tile
+    {
+        State m_state = State::Unloaded;
+        TextureHandle m_texture;
+        MeshHandle m_mesh;
+        uint32_t m_request = 0; // tells a callback for an earlier request of the same tile apart
+        Entity m_entity;
+        glm::vec2 m_min = glm::vec2(0.0f), m_max = glm::vec2(0.0f); // world
+        size_t m_bytes = 0;
+        uint64_t m_wantedFrame = 0;
+    };
+
+    // a 3x3 block around the view plus one spare
+    static constexpr int kMinCacheSize = 10;
+    // new tile requests per frame, the streamer's upload budget is the real limit
+    static constexpr int kMaxRequestsPerFrame = 8;
+    // seconds of camera travel prefetched, roughly decode plus upload time
+    static constexpr float kLookaheadSeconds = 0.75f;
+    static constexpr float kMaxLookaheadTiles = 4.0f;
+    static constexpr uint32_t kOverview = UINT32_MAX;
+
+    bool split(const std::string &imagePath, bool flipVertically, JobSystem *jobs);
+    void request(uint32_t index);
+    void ready(uint32_t index, uint32_t request, bool loaded);
+    void evict(uint32_t index);
+    Tile &tile(uint32_t index) { return index == kOverview ? m_overview : m_tiles[index]; }
+
+    SceneManager *m_scene = nullptr;
+    ResourceManager *m_resources = nullptr;
+
+    std::string m_path;
+    bool m_flip = true;
+    bool m_singleImage = false; // the tiles couldn't be written, the image is the only tile
+    Tiles::Manifest m_manifest = {};
+    glm::vec2 m_worldMin = glm::vec2(0.0f), m_texelSize = glm::vec2(1.0f);
+    std::vector<Tile> m_tiles; // row-major
+    Tile m_overview;
+    Entity m_root; // parent of every tile sprite
+    std::vector<uint32_t> m_loaded; // loading or resident, in no particular order
+    std::vector<uint32_t> m_wanted; // scratch, kept for its capacity
+
+    glm::vec2 m_lastCenter = glm::vec2(0.0f), m_velocity = glm::vec2(0.0f);
+    bool m_updated = false;
+    uint64_t m_frame = 0;
+    uint32_t m_requestCount = 0;
+    int m_cacheSize = kDefaultCacheSize;
+    Stats m_stats;
+};
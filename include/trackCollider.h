@@ -0,0 +1,49 @@
+#pragma once // trackCollider.h
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// Signed distance field of the drivable area of a track image, built once
+// with an exact Euclidean distance transform and cached next to the image.
+// Distances are in world units: negative on track, positive off it.
+class TrackCollider
+{
+  public:
+    struct Sample
+    {
+        float m_distance;
+        glm::vec2 m_normal; // points off track
+        float m_friction;   // 1 on asphalt, lower on kerbs and grass
+    };
+
+    TrackCollider();
+
+    // The image covers [worldMin, worldMax]; rows run bottom to top when flipped like the texture
+    void load(const std::string &imagePath, const glm::vec2 &worldMin, const glm::vec2 &worldMax, bool flipVertically = true, JobSystem *jobs = nullptr);
+    bool isLoaded() const { return !m_distance.empty(); }
+
+    // Bilinear, O(1); outside the image the distance keeps growing
+    Sample sample(const glm::vec2 &position) const;
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    double getLoadMs() const { return m_loadMs; }
+    bool wasCached() const { return m_cached; }
+
+    static constexpr const char *kExtension = ".sdf";
+
+  private:
+    void build(const std::string &imagePath, bool flipVertically, JobSystem *jobs);
+    bool readCache(const std::string &cachePath, uint64_t sourceSize, int64_t sourceTime, int sourceWidth, int sourceHeight);
+    void writeCache(const std::string &cachePath, uint64_t sourceSize, int64_t sourceTime) const;
+
+    int m_width, m_height;
+    glm::vec2 m_worldMin, m_texelSize;
+    std::vector<float> m_distance;  // in texels, scaled on lookup
+    std::vector<uint8_t> m_friction; // 0..255
+    double m_loadMs;
+    bool m_cached;
+};
@@ -0,0 +1,81 @@
+#pragma once // transformStore.h
+#include "components.h"
+#include "ecs.h"
+#include <atomic>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class JobSystem;
+
+// 2D transforms with parents, one array per field. Writes only mark a node
+// dirty; update() recomputes the dirty nodes and everything below them, four
+// at a time, into world affines laid out the way the sprite instances want
+// them. Nodes nobody touches cost nothing per frame.
+//  - a child's world transform is parent world * child local
+//  - nodes are indices, reused after destroy(); the owning entity holds it in a TransformNode
+class TransformStore
+{
+  public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Stats
+    {
+        size_t m_nodes = 0;
+        size_t m_updated = 0; // last update()
+        size_t m_levels = 0;  // depths walked by the last update()
+    };
+
+    TransformStore() = default;
+    TransformStore(const TransformStore &) = delete;
+    TransformStore &operator=(const TransformStore &) = delete;
+
+    // The world transform is valid right away
+    uint32_t create(Entity owner, const Transform2D &local, uint32_t parent = kNone);
+    // Children move up to the root, keeping their local transforms
+    void destroy(uint32_t node);
+    void clear();
+    // kNone detaches; a parent can't be one of the node's own descendants
+    void setParent(uint32_t node, uint32_t parent);
+    uint32_t getParent(uint32_t node) const { return m_parent[node]; }
+
+    // Safe from several threads as long as each node is written by one of them
+    void setLocal(uint32_t node, const Transform2D &local);
+    void setLocal(uint32_t node, const glm::vec2 &position, float rotation);
+    Transform2D getLocal(uint32_t node) const;
+    // As of the last update()
+    const Affine2D &getWorld(uint32_t node) const { return m_world[node]; }
+    Entity getOwner(uint32_t node) const { return m_owner[node]; }
+
+    // Parents before children; the jobs split each depth level
+    void update(JobSystem *jobs = nullptr);
+    // Nodes the last update() recomputed
+    const std::vector<uint32_t> &getUpdated() const { return m_updated; }
+    Stats getStats() const;
+
+  private:
+    void markDirty(uint32_t node);
+    void unlink(uint32_t node);
+    void setDepth(uint32_t node, uint32_t depth);
+    void computeBatch(const uint32_t *nodes, size_t count);
+
+    // local, written by setLocal
+    std::vector<float> m_posX, m_posY, m_rotation, m_scaleX, m_scaleY;
+    // hierarchy, children as a doubly linked sibling list
+    std::vector<uint32_t> m_parent, m_firstChild, m_nextSibling, m_prevSibling, m_depth;
+    std::vector<Entity> m_owner;
+    std::vector<uint8_t> m_alive;
+    // world, one Affine2D per node
+    std::vector<Affine2D> m_world;
+
+    // dirty nodes, appended once each; sized to the node count so appends never reallocate
+    std::vector<uint8_t> m_dirty;
+    std::vector<uint32_t> m_dirtyList;
+    std::atomic<uint32_t> m_dirtyCount{0};
+
+    std::vector<uint32_t> m_free;
+    std::vector<uint32_t> m_updated;
+    std::vector<uint32_t> m_stack; // scratch for the subtree walks
+    std::vector<uint32_t> m_levelStart;
+    size_t m_levels = 0;
+};
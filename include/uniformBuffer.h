@@ -0,0 +1,51 @@
+#pragma once // uniformBuffer.h
+#include <GL/glew.h>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Binding points for uniform blocks shared by every program.
+// Shader binds any active block with one of these names when it is linked.
+namespace UniformBlock
+{
+enum Binding : GLuint
+{
+    Camera = 0,
+};
+
+struct Shared
+{
+    const char *m_name;
+    Binding m_binding;
+};
+
+inline constexpr Shared kShared[] = {
+    {"Camera", Camera},
+};
+} // namespace UniformBlock
+
+// std140 layout of the Camera block in the shaders
+struct CameraBlock
+{
+    glm::mat4 m_view;
+    glm::mat4 m_projection;
+};
+
+class UniformBuffer
+{
+  public:
+    UniformBuffer() = default;
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+    // Allocates 'size' bytes and attaches the buffer to 'binding'
+    void init(GLuint binding, size_t size);
+    void update(const void *data, size_t size, size_t offset = 0) const;
+    void cleanup();
+
+  private:
+    GLuint m_id = 0;
+    GLuint m_binding = 0;
+    size_t m_size = 0;
+};
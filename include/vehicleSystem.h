@@ -0,0 +1,142 @@
+#pragma once // vehicleSystem.h
+#include "player.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+class CarCollider;
+class JobSystem;
+class TrackCollider;
+
+// Minimal allocator so SoA arrays start on a SIMD boundary
+template <typename T, size_t Alignment> struct AlignedAllocator
+{
+    using value_type = T;
+    template <typename U> struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Alignment))); }
+    void deallocate(T *p, size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+
+    bool operator==(const AlignedAllocator &) const { return true; }
+    bool operator!=(const AlignedAllocator &) const { return false; }
+};
+
+// Constants shared by every kernel, so all paths produce the same bits
+namespace VehicleMath
+{
+inline constexpr float kDegToRad = 0.01745329251994329576923690768489f;
+inline constexpr float kTwoOverPi = 0.636619772367581343075535053490057448f;
+// pi/2 split in three for the Cody-Waite reduction
+inline constexpr float kPio2Hi = 1.5703125f;
+inline constexpr float kPio2Mid = 4.837512969970703125e-4f;
+inline constexpr float kPio2Lo = 7.54978995489188216e-8f;
+// minimax polynomials on [-pi/4, pi/4] (cephes sinf/cosf)
+inline constexpr float kSin0 = -1.6666654611e-1f;
+inline constexpr float kSin1 = 8.3321608736e-3f;
+inline constexpr float kSin2 = -1.9515295891e-4f;
+inline constexpr float kCos0 = 4.166664568298827e-2f;
+inline constexpr float kCos1 = -1.388731625493765e-3f;
+inline constexpr float kCos2 = 2.443315711809948e-5f;
+// below these the car snaps to rest once input is released
+inline constexpr float kRestAngular = 10.0f;
+inline constexpr float kRestSpeed = 10.0f;
+// track contact: the car body is a circle about as wide as the sprite
+inline constexpr float kCarRadius = 30.0f;
+inline constexpr float kWallRestitution = 0.3f;
+// extra linear drag at zero surface friction
+inline constexpr float kSurfaceDrag = 4.0f;
+
+// radians, same operation order as the SIMD kernels
+inline void fastSinCos(float x, float &outSin, float &outCos)
+{
+    float q = std::nearbyint(x * kTwoOverPi);
+    int quadrant = (int)q;
+    float r = ((x - q * kPio2Hi) - q * kPio2Mid) - q * kPio2Lo;
+    float r2 = r * r;
+    float s = ((kSin2 * r2 + kSin1) * r2 + kSin0) * r2 * r + r;
+    float c = ((kCos2 * r2 + kCos1) * r2 + kCos0) * r2 * r2 - 0.5f * r2 + 1.0f;
+    if (quadrant & 1) std::swap(s, c);
+    outSin = (quadrant & 2) ? -s : s;
+    outCos = ((quadrant + 1) & 2) ? -c : c;
+}
+} // namespace VehicleMath
+
+// Integrates many cars with the Player car model, one array per field.
+// Slot 0 is the player, the rest are AI cars.
+class VehicleSystem
+{
+  public:
+    enum class Path
+    {
+        Scalar,
+        SSE,
+        AVX2,
+    };
+
+    using FloatArray = std::vector<float, AlignedAllocator<float, 32>>;
+
+    VehicleSystem();
+
+    // Returns the new slot
+    size_t add(const PlayerData &state);
+    // Keeps the first 'count' slots
+    void resize(size_t count);
+    size_t count() const { return m_count; }
+
+    // Random wandering AI cars scattered inside 'halfExtent' of the origin
+    void spawnAI(size_t count, float halfExtent, uint32_t seed = 1);
+
+    // Cars are kept on the drivable part of 'track'; nullptr disables collision
+    void setTrack(const TrackCollider *track) { m_track = track; }
+    // Cars bump into each other after every tick; nullptr lets them pass through
+    void setCarCollider(CarCollider *collider) { m_cars = collider; }
+
+    void setControls(size_t slot, float steer, float throttle);
+    void read(size_t slot, PlayerData &out) const;
+
+    // Fans out over lane-aligned ranges when given a job system
+    void update(float deltaTime, JobSystem *jobs = nullptr);
+
+    // Picks the widest kernel this CPU supports
+    static Path bestPath();
+    static bool supported(Path path);
+    static const char *pathName(Path path);
+    void setPath(Path path) { m_path = supported(path) ? path : Path::Scalar; }
+    Path getPath() const { return m_path; }
+
+    // Simulates 'count' AI cars for 'ticks' ticks, returns vehicles per millisecond
+    static double benchmark(Path path, size_t count, int ticks, JobSystem *jobs = nullptr);
+
+    PlayerConstData m_constData;
+
+    // SoA state, padded to a multiple of kLanes
+    FloatArray m_posX, m_posY;
+    FloatArray m_velX, m_velY;
+    FloatArray m_rotation, m_angularVelocity;
+    FloatArray m_steer, m_throttle;
+
+    static constexpr size_t kLanes = 8;
+    // Cars per job, small batches are not worth the handoff
+    static constexpr size_t kJobGrain = 4096;
+
+  private:
+    void updateScalar(size_t begin, size_t end, float dt);
+    void updateSSE(size_t begin, size_t end, float dt);
+    void updateAVX2(size_t begin, size_t end, float dt);
+    void updateRange(size_t begin, size_t end, float dt);
+    void collideTrack(size_t begin, size_t end, float dt);
+
+    size_t m_count;
+    Path m_path;
+    const TrackCollider *m_track;
+    CarCollider *m_cars;
+};
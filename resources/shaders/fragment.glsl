@@ -6,5 +6,10 @@ uniform sampler2D uTexture;
 out vec4 FragColor;
 
 void main(){
+#ifdef OVERDRAW
+    // the same faint tint per covered fragment, layers stack up into bright spots
+    FragColor = vec4(1.0, 0.45, 0.1, 0.2 * texture(uTexture, vUV).a);
+#else
     FragColor = texture(uTexture, vUV);
+#endif
 }
@@ -0,0 +1,12 @@
+// particleFragment.glsl
+#version 330 core
+
+in vec2 vCorner;
+in vec4 vColor;
+out vec4 FragColor;
+
+void main(){
+    // soft round falloff inside the quad
+    float falloff = clamp(1.0 - dot(vCorner, vCorner), 0.0, 1.0);
+    FragColor = vColor * falloff;
+}
@@ -0,0 +1,50 @@
+// particleVertex.glsl
+#version 330 core
+
+// per-instance, one float per field straight from ParticleSystem's arrays
+layout(location=0) in float iPosX;
+layout(location=1) in float iPosY;
+layout(location=2) in float iVelX;
+layout(location=3) in float iVelY;
+layout(location=4) in float iAge; // 0 at birth, 1 is dead
+layout(location=5) in float iSize;
+layout(location=6) in float iKind; // 0 smoke, 1 spark
+
+// shared by every program, updated once per frame (see CameraBlock)
+layout(std140) uniform Camera {
+    mat4 uView;
+    mat4 uProjection;
+};
+
+out vec2 vCorner;
+out vec4 vColor; // premultiplied
+
+void main(){
+    // triangle strip corners from the vertex index, no vertex buffer
+    vCorner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    vColor = vec4(0.0);
+    if (iAge >= 1.0) {
+        // all four corners on one point, the quad has no area and is never rasterized
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    vec2 offset;
+    if (iKind < 0.5) {
+        // smoke puffs up and thins out, fading in over the first frames
+        offset = vCorner * iSize * (0.5 + 1.5 * iAge);
+        float alpha = 0.35 * (1.0 - iAge) * min(iAge * 8.0, 1.0);
+        vColor = vec4(vec3(0.75) * alpha, alpha);
+    } else {
+        // sparks streak along their motion and cool down; alpha 0 adds them to what's below
+        vec2 velocity = vec2(iVelX, iVelY);
+        float speed = length(velocity);
+        vec2 along = speed > 1.0 ? velocity / speed : vec2(1.0, 0.0);
+        vec2 across = vec2(-along.y, along.x);
+        offset = along * vCorner.x * (iSize + speed * 0.02) + across * vCorner.y * iSize;
+        float heat = 1.0 - iAge;
+        vColor = vec4(vec3(1.0, 0.55 + 0.4 * heat, 0.15 + 0.3 * heat) * heat, 0.0);
+    }
+
+    gl_Position = uProjection * uView * vec4(vec2(iPosX, iPosY) + offset, 0.0, 1.0);
+}
@@ -0,0 +1,15 @@
+// skidFragment.glsl
+#version 330 core
+
+in float vAcross;
+in float vStrength;
+out vec4 FragColor;
+
+// the texture is cleared to this colour, see SkidMarks
+const vec3 kRubber = vec3(0.06);
+
+void main(){
+    // thinner towards the edges of the tread
+    float alpha = vStrength * (1.0 - vAcross * vAcross);
+    FragColor = vec4(kRubber * alpha, alpha);
+}
@@ -0,0 +1,27 @@
+// skidVertex.glsl
+#version 330 core
+
+// per-instance, see SkidMarks::Segment
+layout(location=0) in vec4 iEnds; // from in xy, to in zw
+layout(location=1) in vec2 iShape; // half width, strength
+
+// world rectangle the texture covers: min corner and 2 / size
+uniform vec2 uAreaMin;
+uniform vec2 uAreaScale;
+
+out float vAcross;
+out float vStrength;
+
+void main(){
+    // triangle strip corners from the vertex index: x runs along the mark, y across it
+    float along = float(gl_VertexID & 1);
+    vAcross = float(gl_VertexID >> 1) * 2.0 - 1.0;
+    vStrength = iShape.y;
+
+    vec2 delta = iEnds.zw - iEnds.xy;
+    float len = length(delta);
+    vec2 dir = len > 0.001 ? delta / len : vec2(1.0, 0.0);
+    vec2 p = mix(iEnds.xy, iEnds.zw, along) + vec2(-dir.y, dir.x) * vAcross * iShape.x;
+
+    gl_Position = vec4((p - uAreaMin) * uAreaScale - 1.0, 0.0, 1.0);
+}
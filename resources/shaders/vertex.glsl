@@ -1,16 +1,26 @@
 // vertex.glsl
 #version 330 core
 
-layout(location=0) in vec3 aPos;
+layout(location=0) in vec2 aPos;
 layout(location=1) in vec2 aUV;
 
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProjection;
+// per-instance (see SpriteInstance), the world transform comes from TransformStore
+layout(location=2) in vec4 iLinear; // x axis, y axis
+layout(location=3) in vec2 iTranslation;
+layout(location=4) in vec4 iUVRect;
+
+// shared by every program, updated once per frame (see CameraBlock)
+layout(std140) uniform Camera {
+    mat4 uView;
+    mat4 uProjection;
+};
 
 out vec2 vUV;
 
 void main(){
-    vUV = aUV;
-    gl_Position = uProjection * uView * uModel * vec4(aPos,1.0);
+    vUV = iUVRect.xy + aUV * iUVRect.zw;
+
+    vec2 p = mat2(iLinear.xy, iLinear.zw) * aPos + iTranslation;
+
+    gl_Position = uProjection * uView * vec4(p, 0.0, 1.0);
 }
@@ -30,4 +30,11 @@ glm::mat4 Camera::getProjectionMatrix() const
     float hw = (m_width * 0.5f) / m_zoom;
     float hh = (m_height * 0.5f) / m_zoom;
     return glm::ortho(-hw, hw, -hh, hh, -1.0f, 1.0f);
-}
\ No newline at end of file
+}
+void Camera::getVisibleBounds(glm::vec2 &outMin, glm::vec2 &outMax) const
+{
+    // same extents as the projection, shifted by the view translation
+    glm::vec2 halfExtent((m_width * 0.5f) / m_zoom, (m_height * 0.5f) / m_zoom);
+    outMin = m_position - halfExtent;
+    outMax = m_position + halfExtent;
+}
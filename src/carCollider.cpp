@@ -0,0 +1,346 @@
+// carCollider.cpp
+#include "carCollider.h"
+#include "jobSystem.h"
+#include "profiler.h"
+#include "vehicleSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+// overlap of |c0 + speed * t| < radius, as [enter, exit] in t
+bool axisInterval(float c0, float speed, float radius, float &enter, float &exit)
+{
+    if (std::fabs(speed) < 1e-6f)
+    {
+        enter = -INFINITY;
+        exit = INFINITY;
+        return std::fabs(c0) < radius;
+    }
+    float t0 = (-radius - c0) / speed, t1 = (radius - c0) / speed;
+    enter = std::min(t0, t1);
+    exit = std::max(t0, t1);
+    return true;
+}
+} // namespace
+
+void CarCollider::setShape(const glm::vec2 &localMin, const glm::vec2 &localMax)
+{
+    m_center = (localMin + localMax) * 0.5f;
+    m_half = glm::abs(localMax - localMin) * 0.5f;
+}
+
+int CarCollider::bandOf(float y) { return (int)std::floor(y / kBandHeight); }
+
+void CarCollider::reset(size_t count)
+{
+    for (std::vector<float> *array : {&m_axisX, &m_axisY, &m_centerX, &m_centerY, &m_minX, &m_maxX, &m_minY, &m_maxY})
+        array->assign(count, 0.0f);
+    // an empty band range, every body gets added to its buckets on the next tick
+    m_bandLo.assign(count, 0);
+    m_bandHi.assign(count, -1);
+    m_oldLo.assign(count, 0);
+    m_oldHi.assign(count, -1);
+    m_impactTime.assign(count, 1.0f);
+    for (int bucket = 0; bucket < kBuckets; bucket++)
+        m_buckets[bucket].clear();
+}
+
+void CarCollider::computeBoxes(const VehicleSystem &vehicles, float dt, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        float s, c;
+        VehicleMath::fastSinCos(vehicles.m_rotation[i] * VehicleMath::kDegToRad, s, c);
+        float cx = vehicles.m_posX[i] + c * m_center.x - s * m_center.y;
+        float cy = vehicles.m_posY[i] + s * m_center.x + c * m_center.y;
+        float dx = vehicles.m_velX[i] * dt, dy = vehicles.m_velY[i] * dt;
+        float extentX = std::fabs(c) * m_half.x + std::fabs(s) * m_half.y;
+        float extentY = std::fabs(s) * m_half.x + std::fabs(c) * m_half.y;
+        m_axisX[i] = c;
+        m_axisY[i] = s;
+        m_centerX[i] = cx;
+        m_centerY[i] = cy;
+        // the box where the tick started and where it ended, the heading held
+        m_minX[i] = std::min(cx, cx - dx) - extentX;
+        m_maxX[i] = std::max(cx, cx - dx) + extentX;
+        m_minY[i] = std::min(cy, cy - dy) - extentY;
+        m_maxY[i] = std::max(cy, cy - dy) + extentY;
+
+        m_oldLo[i] = m_bandLo[i];
+        m_oldHi[i] = m_bandHi[i];
+        m_bandLo[i] = bandOf(m_minY[i]);
+        m_bandHi[i] = std::min(bandOf(m_maxY[i]), m_bandLo[i] + kBuckets - 1);
+    }
+}
+
+void CarCollider::updateBucket(int bucket)
+{
+    std::vector<Proxy> &proxies = m_buckets[bucket];
+    // drop the bodies that left, refresh the rest in place so the order from last tick survives
+    size_t kept = 0;
+    for (const Proxy &proxy : proxies)
+    {
+        uint32_t body = proxy.m_body;
+        if (!touches(m_bandLo[body], m_bandHi[body], bucket)) continue;
+        proxies[kept++] = {m_minX[body], m_maxX[body], m_minY[body], m_maxY[body], body};
+    }
+    proxies.resize(kept);
+    for (uint32_t body : m_added[bucket])
+        proxies.push_back({m_minX[body], m_maxX[body], m_minY[body], m_maxY[body], body});
+
+    size_t moves = 0;
+    if (m_added[bucket].size() > kept / 4 + 16)
+    {
+        // mostly new, a full sort beats shifting each one into place
+        std::sort(proxies.begin(), proxies.end(), [](const Proxy &a, const Proxy &b) { return a.m_minX < b.m_minX; });
+    }
+    else
+    {
+        for (size_t i = 1; i < proxies.size(); i++)
+        {
+            Proxy proxy = proxies[i];
+            size_t j = i;
+            for (; j > 0 && proxies[j - 1].m_minX > proxy.m_minX; j--)
+                proxies[j] = proxies[j - 1];
+            proxies[j] = proxy;
+            moves += i - j;
+        }
+    }
+    m_bucketMoves[bucket] = moves;
+
+    // sweep: only the following proxies that start before this one ends can overlap it in x
+    std::vector<Pair> &pairs = m_bucketPairs[bucket];
+    pairs.clear();
+    for (size_t i = 0; i < proxies.size(); i++)
+    {
+        const Proxy &a = proxies[i];
+        for (size_t j = i + 1; j < proxies.size() && proxies[j].m_minX <= a.m_maxX; j++)
+        {
+            const Proxy &b = proxies[j];
+            if (a.m_minY > b.m_maxY || b.m_minY > a.m_maxY) continue;
+            // a pair shares every bucket where both boxes are, it's reported only where its y overlap starts
+            if (bucketOf(bandOf(std::max(a.m_minY, b.m_minY))) != bucket) continue;
+            pairs.push_back({std::min(a.m_body, b.m_body), std::max(a.m_body, b.m_body)});
+        }
+    }
+}
+
+void CarCollider::testPair(const VehicleSystem &vehicles, float dt, const Pair &pair, Contact &contact) const
+{
+    uint32_t a = pair.m_a, b = pair.m_b;
+    contact.m_hit = false;
+    // in b's frame: a starts at 'start' and moves by 'motion' over the tick
+    glm::vec2 end(m_centerX[a] - m_centerX[b], m_centerY[a] - m_centerY[b]);
+    glm::vec2 motion((vehicles.m_velX[a] - vehicles.m_velX[b]) * dt, (vehicles.m_velY[a] - vehicles.m_velY[b]) * dt);
+    glm::vec2 start = end - motion;
+
+    glm::vec2 axesA[2] = {{m_axisX[a], m_axisY[a]}, {-m_axisY[a], m_axisX[a]}};
+    glm::vec2 axesB[2] = {{m_axisX[b], m_axisY[b]}, {-m_axisY[b], m_axisX[b]}};
+    const glm::vec2 axes[4] = {axesA[0], axesA[1], axesB[0], axesB[1]};
+
+    float enter = 0.0f, exit = 1.0f, endDepth = INFINITY, startDepth = INFINITY;
+    int enterAxis = -1, endAxis = 0, startAxis = 0;
+    for (int k = 0; k < 4; k++)
+    {
+        const glm::vec2 &axis = axes[k];
+        float radius = m_half.x * (std::fabs(glm::dot(axesA[0], axis)) + std::fabs(glm::dot(axesB[0], axis))) + m_half.y * (std::fabs(glm::dot(axesA[1], axis)) + std::fabs(glm::dot(axesB[1], axis)));
+        float axisEnter, axisExit;
+        if (!axisInterval(glm::dot(start, axis), glm::dot(motion, axis), radius, axisEnter, axisExit)) return;
+        if (axisEnter > enter)
+        {
+            enter = axisEnter;
+            enterAxis = k;
+        }
+        exit = std::min(exit, axisExit);
+        if (enter > exit) return;
+
+        float depth = radius - std::fabs(glm::dot(end, axis));
+        if (depth < endDepth)
+        {
+            endDepth = depth;
+            endAxis = k;
+        }
+        depth = radius - std::fabs(glm::dot(start, axis));
+        if (depth < startDepth)
+        {
+            startDepth = depth;
+            startAxis = k;
+        }
+    }
+
+    // the normal points from a to b, so a is on its negative side
+    auto normalAt = [&](const glm::vec2 &offset, int k) { return glm::dot(offset, axes[k]) > 0.0f ? -axes[k] : axes[k]; };
+    if (enterAxis >= 0)
+    {
+        // apart when the tick started: back to where they met, deep overlaps at the end point the wrong way
+        contact.m_normal = normalAt(start + motion * enter, enterAxis);
+        contact.m_depth = 0.0f;
+        contact.m_time = enter;
+    }
+    else if (exit >= 1.0f)
+    {
+        // touching all tick: out along the shallowest axis
+        contact.m_normal = normalAt(end, endAxis);
+        contact.m_depth = endDepth;
+        contact.m_time = 1.0f;
+    }
+    else
+    {
+        // overlapping at the start and apart at the end: fine if they were separating, passing through if not
+        contact.m_normal = normalAt(start, startAxis);
+        if (glm::dot(motion, contact.m_normal) <= 0.0f) return;
+        contact.m_depth = startDepth;
+        contact.m_time = 0.0f;
+    }
+    contact.m_a = a;
+    contact.m_b = b;
+    contact.m_impulse = 0.0f;
+    contact.m_hit = true;
+}
+
+void CarCollider::resolve(VehicleSystem &vehicles, float dt)
+{
+    // cars in a new contact go back to where they first touched, so none can pass through another
+    for (const Contact &contact : m_contacts)
+        if (contact.m_time < 1.0f)
+        {
+            m_impactTime[contact.m_a] = std::min(m_impactTime[contact.m_a], contact.m_time);
+            m_impactTime[contact.m_b] = std::min(m_impactTime[contact.m_b], contact.m_time);
+        }
+    for (const Contact &contact : m_contacts)
+        for (uint32_t body : {contact.m_a, contact.m_b})
+        {
+            float rewind = (1.0f - m_impactTime[body]) * dt;
+            vehicles.m_posX[body] -= vehicles.m_velX[body] * rewind;
+            vehicles.m_posY[body] -= vehicles.m_velY[body] * rewind;
+            m_impactTime[body] = 1.0f;
+        }
+
+    for (Contact &contact : m_contacts)
+    {
+        float closing = (vehicles.m_velX[contact.m_b] - vehicles.m_velX[contact.m_a]) * contact.m_normal.x + (vehicles.m_velY[contact.m_b] - vehicles.m_velY[contact.m_a]) * contact.m_normal.y;
+        contact.m_target = closing < 0.0f ? -closing * kRestitution : 0.0f;
+    }
+    // equal masses: each side takes half of the change
+    for (int iteration = 0; iteration < kIterations; iteration++)
+        for (Contact &contact : m_contacts)
+        {
+            uint32_t a = contact.m_a, b = contact.m_b;
+            glm::vec2 n = contact.m_normal;
+            float speed = (vehicles.m_velX[b] - vehicles.m_velX[a]) * n.x + (vehicles.m_velY[b] - vehicles.m_velY[a]) * n.y;
+            float impulse = std::max(contact.m_impulse + (contact.m_target - speed) * 0.5f, 0.0f);
+            float change = impulse - contact.m_impulse;
+            contact.m_impulse = impulse;
+            vehicles.m_velX[a] -= n.x * change;
+            vehicles.m_velY[a] -= n.y * change;
+            vehicles.m_velX[b] += n.x * change;
+            vehicles.m_velY[b] += n.y * change;
+        }
+
+    for (const Contact &contact : m_contacts)
+    {
+        float push = std::max(contact.m_depth - kSlop, 0.0f) * kCorrection * 0.5f;
+        if (push <= 0.0f) continue;
+        vehicles.m_posX[contact.m_a] -= contact.m_normal.x * push;
+        vehicles.m_posY[contact.m_a] -= contact.m_normal.y * push;
+        vehicles.m_posX[contact.m_b] += contact.m_normal.x * push;
+        vehicles.m_posY[contact.m_b] += contact.m_normal.y * push;
+    }
+}
+
+void CarCollider::solve(VehicleSystem &vehicles, float dt, JobSystem *jobs)
+{
+    m_stats = Stats();
+    if (!m_enabled) return;
+    PROFILE_SCOPE("Car collisions");
+    auto start = std::chrono::steady_clock::now();
+    size_t count = vehicles.count();
+    if (count != m_bandLo.size()) reset(count);
+    m_stats.m_bodies = count;
+
+    if (!jobs || count <= kJobGrain) computeBoxes(vehicles, dt, 0, count);
+    else jobs->parallelFor(0, count, kJobGrain, [&](size_t begin, size_t end) { computeBoxes(vehicles, dt, begin, end); });
+
+    // bodies whose band range changed join their new buckets; cheap, most cars stay in their band
+    for (int bucket = 0; bucket < kBuckets; bucket++)
+        m_added[bucket].clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        int lo = m_bandLo[i], hi = m_bandHi[i];
+        if (lo == m_oldLo[i] && hi == m_oldHi[i]) continue;
+        for (int band = lo; band <= hi; band++)
+        {
+            int bucket = bucketOf(band);
+            if (!touches(m_oldLo[i], m_oldHi[i], bucket)) m_added[bucket].push_back((uint32_t)i);
+        }
+    }
+
+    // buckets share nothing, one job each
+    auto buckets = [this](size_t begin, size_t end)
+    {
+        for (size_t bucket = begin; bucket < end; bucket++)
+            updateBucket((int)bucket);
+    };
+    if (!jobs || count <= kJobGrain) buckets(0, kBuckets);
+    else jobs->parallelFor(0, kBuckets, 1, buckets);
+
+    // bucket order, so the contacts come out the same on every run
+    m_pairs.clear();
+    for (int bucket = 0; bucket < kBuckets; bucket++)
+    {
+        m_pairs.insert(m_pairs.end(), m_bucketPairs[bucket].begin(), m_bucketPairs[bucket].end());
+        m_stats.m_moves += m_bucketMoves[bucket];
+    }
+    m_stats.m_pairs = m_pairs.size();
+
+    m_contacts.resize(m_pairs.size());
+    auto narrow = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+            testPair(vehicles, dt, m_pairs[i], m_contacts[i]);
+    };
+    if (!jobs || m_pairs.size() <= kPairGrain) narrow(0, m_pairs.size());
+    else jobs->parallelFor(0, m_pairs.size(), kPairGrain, narrow);
+    m_contacts.erase(std::remove_if(m_contacts.begin(), m_contacts.end(), [](const Contact &contact) { return !contact.m_hit; }), m_contacts.end());
+    m_stats.m_contacts = m_contacts.size();
+    m_stats.m_swept = (size_t)std::count_if(m_contacts.begin(), m_contacts.end(), [](const Contact &contact) { return contact.m_time < 1.0f; });
+
+    // serial, contacts share cars
+    resolve(vehicles, dt);
+    m_stats.m_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+CarCollider::Stats CarCollider::benchmark(size_t count, int ticks, JobSystem *jobs)
+{
+    // about one car per 150x150, dense enough for a few contacts per car
+    VehicleSystem vehicles;
+    vehicles.spawnAI(count, 75.0f * std::sqrt((float)count));
+    CarCollider collider;
+    vehicles.setCarCollider(&collider);
+    // the first tick sorts everything from scratch, it isn't what a running game sees
+    vehicles.update(1.0f / 120.0f, jobs);
+
+    Stats total;
+    for (int t = 0; t < ticks; t++)
+    {
+        vehicles.update(1.0f / 120.0f, jobs);
+        const Stats &tick = collider.getStats();
+        total.m_moves += tick.m_moves;
+        total.m_pairs += tick.m_pairs;
+        total.m_contacts += tick.m_contacts;
+        total.m_swept += tick.m_swept;
+        total.m_ms += tick.m_ms;
+    }
+    total.m_bodies = vehicles.count();
+    if (ticks > 0)
+    {
+        total.m_moves /= ticks;
+        total.m_pairs /= ticks;
+        total.m_contacts /= ticks;
+        total.m_swept /= ticks;
+        total.m_ms /= ticks;
+    }
+    return total;
+}
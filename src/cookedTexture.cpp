@@ -0,0 +1,113 @@
+// cookedTexture.cpp
+#include "cookedTexture.h"
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool Cooked::isCompressed(Format format) { return format == Format::BC1 || format == Format::BC3; }
+
+size_t Cooked::rowPitch(Format format, uint32_t width)
+{
+    switch (format)
+    {
+    case Format::BC1:
+        return (size_t)((width + 3) / 4) * 8;
+    case Format::BC3:
+        return (size_t)((width + 3) / 4) * 16;
+    default:
+        return (size_t)width * 4;
+    }
+}
+
+uint32_t Cooked::rowsPerUnit(Format format) { return isCompressed(format) ? 4 : 1; }
+
+size_t Cooked::levelSize(Format format, uint32_t width, uint32_t height)
+{
+    uint32_t units = (height + rowsPerUnit(format) - 1) / rowsPerUnit(format);
+    return rowPitch(format, width) * units;
+}
+
+CookedTextureFile::~CookedTextureFile() { close(); }
+
+const Cooked::Mip &CookedTextureFile::mip(uint32_t level) const
+{
+    return reinterpret_cast<const Cooked::Mip *>(m_data + sizeof(Cooked::Header))[level];
+}
+
+bool CookedTextureFile::open(const std::string &path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    HANDLE mapping = GetFileSizeEx(file, &size) ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_size = (size_t)size.QuadPart;
+    m_data = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    m_size = (size_t)st.st_size;
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    m_data = data == MAP_FAILED ? nullptr : static_cast<const unsigned char *>(data);
+#endif
+    if (!m_data)
+    {
+        close();
+        return false;
+    }
+
+    // validate everything we will later index without checks
+    const size_t tableEnd = sizeof(Cooked::Header);
+    bool valid = m_size >= tableEnd;
+    if (valid)
+    {
+        const Cooked::Header &h = header();
+        valid = std::memcmp(h.m_magic, Cooked::kMagic, 4) == 0 && h.m_version == Cooked::kVersion && h.m_mipCount > 0 && h.m_mipCount <= Cooked::kMaxMips && (uint32_t)h.m_format <= (uint32_t)Cooked::Format::BC3;
+        valid = valid && m_size >= tableEnd + h.m_mipCount * sizeof(Cooked::Mip);
+        for (uint32_t i = 0; valid && i < h.m_mipCount; i++)
+        {
+            const Cooked::Mip &m = mip(i);
+            valid = m.m_offset + m.m_size <= m_size && m.m_size == Cooked::levelSize(h.m_format, m.m_width, m.m_height);
+        }
+    }
+    if (!valid) close();
+    return valid;
+}
+
+void CookedTextureFile::close()
+{
+#ifdef _WIN32
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle((HANDLE)m_mapping);
+    if (m_file) CloseHandle((HANDLE)m_file);
+    m_mapping = m_file = nullptr;
+#else
+    if (m_data) munmap(const_cast<unsigned char *>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
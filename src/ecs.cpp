@@ -0,0 +1,189 @@
+// ecs.cpp
+#include "ecs.h"
+#include <mutex>
+#include <stdexcept>
+
+static int g_componentCount = 0;
+static std::mutex g_componentMutex;
+
+World::ComponentInfo *World::components()
+{
+    // a fixed array rather than a vector: worker threads read it during queries
+    // while the main thread may be registering a new type
+    static ComponentInfo infos[kMaxComponents];
+    return infos;
+}
+
+int World::registerComponent(size_t size, size_t align)
+{
+    std::lock_guard<std::mutex> lock(g_componentMutex);
+    if (g_componentCount == kMaxComponents) throw std::runtime_error("Too many component types");
+    components()[g_componentCount] = {size, align};
+    return g_componentCount++;
+}
+
+World::~World() { clear(); }
+
+void World::clear()
+{
+    for (auto &archetype : m_archetypes)
+        for (Chunk *chunk : archetype->m_chunks)
+            m_chunkPool.destroy(chunk);
+    m_archetypes.clear();
+    // generations survive so old entities stay dead
+    m_freeRecords.clear();
+    for (uint32_t i = 0; i < m_records.size(); i++)
+    {
+        Record &record = m_records[i];
+        if (record.m_archetype) record.m_generation++;
+        record.m_archetype = nullptr;
+        m_freeRecords.push_back(i);
+    }
+    m_entityCount = 0;
+}
+
+World::Archetype &World::archetype(Mask mask)
+{
+    for (auto &archetype : m_archetypes)
+        if (archetype->m_mask == mask) return *archetype;
+
+    auto archetype = std::make_unique<Archetype>();
+    archetype->m_mask = mask;
+
+    // as many rows as fit with every array aligned, entities first
+    size_t rowBytes = sizeof(Entity);
+    for (int id = 0; id < kMaxComponents; id++)
+        if (mask & (Mask(1) << id)) rowBytes += componentInfo(id).m_size;
+    for (size_t capacity = kChunkBytes / rowBytes; capacity > 0; capacity--)
+    {
+        size_t offset = sizeof(Entity) * capacity;
+        for (int id = 0; id < kMaxComponents; id++)
+        {
+            if (!(mask & (Mask(1) << id))) continue;
+            const ComponentInfo &info = componentInfo(id);
+            offset = (offset + info.m_align - 1) / info.m_align * info.m_align;
+            archetype->m_offsets[id] = (uint32_t)offset;
+            offset += info.m_size * capacity;
+        }
+        if (offset <= kChunkBytes)
+        {
+            archetype->m_capacity = (uint32_t)capacity;
+            break;
+        }
+    }
+    if (!archetype->m_capacity) throw std::runtime_error("Components too large for one chunk");
+
+    m_archetypes.push_back(std::move(archetype));
+    return *m_archetypes.back();
+}
+
+const World::Record *World::record(Entity entity) const
+{
+    if (entity.m_index == 0 || entity.m_index > m_records.size()) return nullptr;
+    const Record &record = m_records[entity.m_index - 1];
+    if (record.m_generation != entity.m_generation || !record.m_archetype) return nullptr;
+    return &record;
+}
+
+Entity World::newEntity()
+{
+    uint32_t index;
+    if (!m_freeRecords.empty())
+    {
+        index = m_freeRecords.back();
+        m_freeRecords.pop_back();
+    }
+    else
+    {
+        index = (uint32_t)m_records.size();
+        m_records.emplace_back();
+    }
+    m_entityCount++;
+    return {index + 1, m_records[index].m_generation};
+}
+
+void World::allocateRow(Archetype &archetype, Entity entity)
+{
+    if (archetype.m_chunks.empty() || archetype.m_chunks.back()->m_count == archetype.m_capacity) archetype.m_chunks.push_back(m_chunkPool.create());
+    Chunk &chunk = *archetype.m_chunks.back();
+    uint32_t row = chunk.m_count++;
+    entities(chunk)[row] = entity;
+
+    Record &record = m_records[entity.m_index - 1];
+    record.m_archetype = &archetype;
+    record.m_chunk = (uint32_t)archetype.m_chunks.size() - 1;
+    record.m_row = row;
+}
+
+void World::removeRow(Archetype &archetype, uint32_t chunkIndex, uint32_t row)
+{
+    Chunk &chunk = *archetype.m_chunks[chunkIndex];
+    Chunk &last = *archetype.m_chunks.back();
+    uint32_t lastRow = last.m_count - 1;
+    if (&chunk != &last || row != lastRow)
+    {
+        Entity moved = entities(last)[lastRow];
+        entities(chunk)[row] = moved;
+        for (int id = 0; id < kMaxComponents; id++)
+        {
+            if (!(archetype.m_mask & (Mask(1) << id))) continue;
+            size_t size = componentInfo(id).m_size;
+            std::memcpy(column(archetype, chunk, id) + row * size, column(archetype, last, id) + lastRow * size, size);
+        }
+        Record &record = m_records[moved.m_index - 1];
+        record.m_chunk = chunkIndex;
+        record.m_row = row;
+    }
+    if (--last.m_count == 0)
+    {
+        // back to the pool, any archetype can take it
+        m_chunkPool.destroy(&last);
+        archetype.m_chunks.pop_back();
+    }
+}
+
+void World::move(Entity entity, Mask mask)
+{
+    Record &record = m_records[entity.m_index - 1];
+    Archetype &from = *record.m_archetype;
+    Archetype &to = archetype(mask);
+    uint32_t fromChunk = record.m_chunk, fromRow = record.m_row;
+
+    allocateRow(to, entity);
+    Chunk &src = *from.m_chunks[fromChunk];
+    Chunk &dst = *to.m_chunks[record.m_chunk];
+    Mask shared = from.m_mask & to.m_mask;
+    for (int id = 0; id < kMaxComponents; id++)
+    {
+        if (!(shared & (Mask(1) << id))) continue;
+        size_t size = componentInfo(id).m_size;
+        std::memcpy(column(to, dst, id) + record.m_row * size, column(from, src, id) + fromRow * size, size);
+    }
+    // new components stay zeroed until the caller writes them
+    for (int id = 0; id < kMaxComponents; id++)
+        if ((to.m_mask & ~from.m_mask) & (Mask(1) << id)) std::memset(column(to, dst, id) + record.m_row * componentInfo(id).m_size, 0, componentInfo(id).m_size);
+
+    // the row left behind is filled from the back, that only touches some other entity's record
+    removeRow(from, fromChunk, fromRow);
+}
+
+void World::destroy(Entity entity)
+{
+    Record *where = record(entity);
+    if (!where) return;
+    removeRow(*where->m_archetype, where->m_chunk, where->m_row);
+    where->m_archetype = nullptr;
+    where->m_generation++;
+    m_freeRecords.push_back(entity.m_index - 1);
+    m_entityCount--;
+}
+
+World::Stats World::getStats() const
+{
+    Stats stats;
+    stats.m_entities = m_entityCount;
+    stats.m_archetypes = m_archetypes.size();
+    for (auto &archetype : m_archetypes)
+        stats.m_chunks += archetype->m_chunks.size();
+    return stats;
+}
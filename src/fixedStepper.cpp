@@ -0,0 +1,29 @@
+// fixedStepper.cpp
+#include "fixedStepper.h"
+#include <algorithm>
+
+FixedStepper::FixedStepper(float tickRate, int maxCatchUpSteps) : m_tickRate(tickRate), m_step(1.0f / tickRate), m_accumulator(0.0f), m_maxCatchUpSteps(maxCatchUpSteps), m_lastSteps(0), m_droppedTime(0.0) {}
+
+void FixedStepper::setTickRate(float tickRate)
+{
+    m_tickRate = std::max(tickRate, 1.0f);
+    m_step = 1.0f / m_tickRate;
+    m_accumulator = std::min(m_accumulator, m_step);
+}
+
+int FixedStepper::advance(float frameTime)
+{
+    m_accumulator += std::max(frameTime, 0.0f);
+
+    int steps = (int)(m_accumulator / m_step);
+    m_accumulator = std::max(m_accumulator - steps * m_step, 0.0f);
+    if (steps > m_maxCatchUpSteps)
+    {
+        // a long stall (debugger, window drag): run slow instead of spiralling
+        m_droppedTime += (double)(steps - m_maxCatchUpSteps) * m_step;
+        steps = m_maxCatchUpSteps;
+    }
+
+    m_lastSteps = steps;
+    return steps;
+}
@@ -0,0 +1,71 @@
+// frameArena.cpp
+#include "frameArena.h"
+#include "memoryStats.h"
+#include <algorithm>
+
+FrameArena &FrameArena::get()
+{
+    static FrameArena arena;
+    return arena;
+}
+
+FrameArena::FrameArena()
+{
+    for (auto &buffer : m_buffers)
+    {
+        buffer.m_wanted = kInitialCapacity;
+        reset(buffer);
+    }
+    m_frameStartHeap = MemoryStats::heap().m_allocations;
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+    Buffer &buffer = m_buffers[m_current];
+    m_stats.m_allocations++;
+    m_stats.m_bytes += size;
+
+    uintptr_t base = (uintptr_t)buffer.m_memory.get();
+    uintptr_t aligned = (base + buffer.m_used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    size_t end = (size_t)(aligned - base) + size;
+    if (end <= buffer.m_capacity)
+    {
+        buffer.m_used = end;
+        buffer.m_wanted = std::max(buffer.m_wanted, end);
+        return (void *)aligned;
+    }
+
+    // out of room: heap for now, a bigger buffer next time round
+    m_stats.m_overflows++;
+    buffer.m_wanted += size + alignment;
+    buffer.m_overflow.emplace_back(new uint8_t[size + alignment]);
+    uintptr_t raw = (uintptr_t)buffer.m_overflow.back().get();
+    return (void *)((raw + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void FrameArena::reset(Buffer &buffer)
+{
+    if (buffer.m_wanted > buffer.m_capacity)
+    {
+        // with some headroom so a slowly growing scene doesn't overflow every frame
+        buffer.m_capacity = buffer.m_wanted + buffer.m_wanted / 2;
+        buffer.m_memory.reset(new uint8_t[buffer.m_capacity]);
+    }
+    buffer.m_overflow.clear();
+    buffer.m_used = 0;
+    buffer.m_wanted = 0;
+}
+
+void FrameArena::endFrame()
+{
+    uint64_t heap = MemoryStats::heap().m_allocations;
+    m_stats.m_heapAllocations = heap - m_frameStartHeap;
+    m_stats.m_capacity = m_buffers[m_current].m_capacity;
+    m_lastFrame = m_stats;
+    m_stats = Stats();
+
+    m_current ^= 1;
+    reset(m_buffers[m_current]);
+    // a resize above is the arena's own doing, not the frame's
+    m_frameStartHeap = MemoryStats::heap().m_allocations;
+}
@@ -0,0 +1,148 @@
+// framePacer.cpp
+#include "framePacer.h"
+#include "profiler.h"
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+const char *FramePacer::modeName(Mode mode)
+{
+    switch (mode)
+    {
+    case AdaptiveVSync:
+        return "Adaptive VSync";
+    case Uncapped:
+        return "Uncapped";
+    case Capped:
+        return "Capped";
+    case JustInTime:
+        return "Just in time";
+    default:
+        return "VSync";
+    }
+}
+
+void FramePacer::init(GLFWwindow *window, Mode mode)
+{
+    m_window = window;
+    if (m_window)
+    {
+        m_adaptiveSupported = glfwExtensionSupported("GLX_EXT_swap_control_tear") || glfwExtensionSupported("WGL_EXT_swap_control_tear");
+        GLFWmonitor *monitor = glfwGetPrimaryMonitor();
+        const GLFWvidmode *videoMode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+        if (videoMode && videoMode->refreshRate > 0) m_refreshHz = videoMode->refreshRate;
+    }
+    m_started = false;
+    m_stats = Stats();
+    setMode(mode);
+}
+
+void FramePacer::setMode(Mode mode)
+{
+    m_mode = mode;
+    m_workPeakMs = 0.0;
+    m_stats.m_missed = 0;
+    applySwapInterval();
+}
+
+void FramePacer::setTargetFps(double fps) { m_targetFps = std::clamp(fps, 10.0, 1000.0); }
+
+void FramePacer::applySwapInterval()
+{
+    if (!m_window) return;
+    int interval = 0;
+    if (m_mode == VSync || m_mode == JustInTime) interval = 1;
+    else if (m_mode == AdaptiveVSync) interval = m_adaptiveSupported ? -1 : 1;
+    glfwSwapInterval(interval);
+}
+
+void FramePacer::waitForInput()
+{
+    Clock::time_point now = Clock::now();
+    Clock::time_point target = now;
+    if (m_mode == Capped)
+    {
+        // scheduled from the last target, not from now, so the rate doesn't drift
+        auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_targetFps));
+        target = m_nextFrame;
+        // too late for this slot (or the first capped frame), start over instead of rushing to catch up
+        if (now > target + period) target = now;
+        m_nextFrame = target + period;
+    }
+    else if (m_started && m_mode == JustInTime)
+    {
+        // the swap returned at a vblank, the next one is a refresh later; leave room for the slowest recent frame
+        double budgetMs = 1000.0 / m_refreshHz - m_workPeakMs - kJustInTimeMarginMs;
+        if (budgetMs > 0.0) target = m_lastSwap + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(budgetMs));
+    }
+
+    if (target > now)
+    {
+        PROFILE_SCOPE("Frame pacing");
+        waitUntil(target);
+    }
+    m_inputTime = Clock::now();
+    m_stats.m_waitMs = msBetween(now, m_inputTime);
+}
+
+void FramePacer::waitUntil(Clock::time_point target)
+{
+    // the scheduler can wake us late by about the worst oversleep seen, keep that much (and a bit) for spinning
+    double spinMs = m_stats.m_oversleepMs * 1.5 + 0.1;
+    for (;;)
+    {
+        Clock::time_point now = Clock::now();
+        double remainingMs = msBetween(now, target);
+        if (remainingMs <= spinMs) break;
+        double sleepMs = remainingMs - spinMs;
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(sleepMs));
+        double oversleepMs = std::max(msBetween(now, Clock::now()) - sleepMs, 0.0);
+        m_stats.m_oversleepMs = std::max(oversleepMs, m_stats.m_oversleepMs * kPeakDecay);
+    }
+    while (Clock::now() < target)
+        std::this_thread::yield();
+}
+
+void FramePacer::beforeSwap()
+{
+    m_stats.m_workMs = msBetween(m_inputTime, Clock::now());
+    m_workPeakMs = std::max(m_stats.m_workMs, m_workPeakMs * kPeakDecay);
+}
+
+void FramePacer::afterSwap()
+{
+    // drivers may queue the swap and return early; finishing here makes the return the actual vblank
+    if (m_window && m_mode == JustInTime) glFinish();
+    Clock::time_point now = Clock::now(), lastSwap = m_lastSwap;
+    m_stats.m_latencyMs = msBetween(m_inputTime, now);
+    m_lastSwap = now;
+    if (!m_started)
+    {
+        m_started = true;
+        return;
+    }
+
+    m_stats.m_frameMs = msBetween(lastSwap, now);
+    if (m_mode == JustInTime && m_stats.m_frameMs > 1.5 * 1000.0 / m_refreshHz) m_stats.m_missed++;
+    m_framePlot[m_plotHead] = (float)m_stats.m_frameMs;
+    m_latencyPlot[m_plotHead] = (float)m_stats.m_latencyMs;
+    m_plotHead = (m_plotHead + 1) % kPlotFrames;
+    m_plotCount = std::min(m_plotCount + 1, kPlotFrames);
+
+    double sum = 0.0, latencySum = 0.0, maxMs = 0.0;
+    for (int i = 0; i < m_plotCount; i++)
+    {
+        sum += m_framePlot[i];
+        latencySum += m_latencyPlot[i];
+        maxMs = std::max(maxMs, (double)m_framePlot[i]);
+    }
+    double mean = sum / m_plotCount, variance = 0.0;
+    for (int i = 0; i < m_plotCount; i++)
+        variance += (m_framePlot[i] - mean) * (m_framePlot[i] - mean);
+    m_stats.m_meanMs = mean;
+    m_stats.m_stdDevMs = std::sqrt(variance / m_plotCount);
+    m_stats.m_maxMs = maxMs;
+    m_stats.m_meanLatencyMs = latencySum / m_plotCount;
+}
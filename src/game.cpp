@@ -1,11 +1,21 @@
 // game.cpp
 #include "game.h"
+#include "components.h"
+#include "frameArena.h"
+#include "gameSystems.h"
+#include "glStateCache.h"
+#include "memoryStats.h"
+#include "profiler.h"
 #include "shader.h"
+#include "shaderCache.h"
 #include "texture.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <sstream>
 
-Game::Game() : m_window(nullptr), m_renderer(800, 800)
+Game::Game() : m_window(nullptr), m_renderer(800, 800), m_showControlPanel(true), m_panelKeyWasDown(false), m_aiCount(0), m_benchmarkResults{}, m_wheelsPlaced(false), m_smokeCarry(0.0f), m_sparkCarry(0.0f), m_firstFrameMs(-1.0), m_streamHitchMs(0.0), m_wasStreaming(false)
 {
     m_windowSettings.m_width = 800;
     m_windowSettings.m_height = 800;
@@ -19,6 +29,7 @@ Game::~Game()
 
 int Game::run()
 {
+    m_startTime = std::chrono::steady_clock::now();
     init();
     gameLoop();
     shutDown();
@@ -48,7 +59,8 @@ void Game::init()
                                        Renderer *R = static_cast<Renderer *>(glfwGetWindowUserPointer(win));
                                        if (R) R->onResize(w, h);
                                    });
-    // glfwSwapInterval(1);
+    // vsync by default, the loop used to spin as fast as it could
+    m_pacer.init(m_window, FramePacer::VSync);
 
     // Initialize GLEW
     glewExperimental = GL_TRUE;
@@ -61,70 +73,252 @@ void Game::init()
     if (!ImGui_ImplGlfw_InitForOpenGL(m_window, true)) throw std::runtime_error("Failed to initialize ImGui for OpenGL\n");
     if (!ImGui_ImplOpenGL3_Init("#version 330 core")) throw std::runtime_error("Failed to initialize OpenGL version for ImGui\n");
 
+    // GL stays on this thread, workers only get CPU-side work
+    Profiler::setThreadName("main");
+    Profiler::get().initGpu();
+    m_jobs.init();
     m_renderer.init(m_window);
 
     setupScene();
+    startInputLog();
 }
 
 void Game::setupScene()
 {
-    m_brickTex = new Texture("resources/textures/brick_x32.png");
-    m_raceTrackTex = new Texture("resources/textures/race_track.png");
+    // small sprites share atlas pages, the track is too big for one
+    m_brickRegion = m_renderer.getAtlas().add("resources/textures/brick_x32.png");
+    m_trackTiles.init(m_renderer.getScene(), m_renderer.getResources());
+    loadTrack("resources/textures/race_track.png");
+    m_player.init(m_renderer, m_vehicles);
+
+    // every car is a box the size of the player's mesh
+    if (const Mesh *carMesh = m_renderer.getResources().get(m_player.getCarMesh())) m_cars.setShape(carMesh->getBoundsMin(), carMesh->getBoundsMax());
+    m_vehicles.setCarCollider(&m_cars);
+}
+
+void Game::loadTrack(const std::string &path)
+{
+    unloadTrack();
+    const glm::vec2 trackCenter(100.0f, 100.0f);
+    const glm::vec2 half(512.0f * 5.0f, 512.0f * 5.0f);
+    // split into tiles the first time, streamed around the camera from then on
+    m_trackTiles.load(path, trackCenter - half, trackCenter + half, true, &m_jobs);
+
+    // same image and placement as the tiles, flipped like the texture
+    m_track.load(path, trackCenter - half, trackCenter + half, true, &m_jobs);
+    m_vehicles.setTrack(&m_track);
+    m_trackPath = path;
+
+    // marks from the old track would float over the new one
+    m_renderer.getSkidMarks().setArea(trackCenter - half, trackCenter + half);
+    m_renderer.getParticles().clear();
+    m_wheelsPlaced = false;
+}
+
+void Game::unloadTrack() { m_trackTiles.unload(); }
+
+void Game::spawnAI(size_t count)
+{
+    destroyAI();
+    m_vehicles.spawnAI(count, 2500.0f);
+    const Mesh *carMesh = m_renderer.getResources().get(m_player.getCarMesh());
+    if (!carMesh) return;
+
+    SceneManager &scene = m_renderer.getScene();
+    m_aiEntities.reserve(count);
+    for (size_t slot = 1; slot < m_vehicles.count(); slot++)
+    {
+        PlayerData state;
+        m_vehicles.read(slot, state);
+        Transform2D transform;
+        transform.m_position = state.m_position;
+        transform.m_rotation = state.m_rotation;
+        Vehicle vehicle;
+        vehicle.m_slot = (uint32_t)slot;
+        vehicle.m_prevPosition = vehicle.m_position = state.m_position;
+        vehicle.m_prevRotation = vehicle.m_rotation = state.m_rotation;
+        m_aiEntities.push_back(scene.createSprite(*carMesh, transform, RenderQueue::Cars, vehicle, Velocity()));
+    }
+}
+
+void Game::destroyAI()
+{
+    for (Entity entity : m_aiEntities)
+        m_renderer.getScene().destroy(entity);
+    m_aiEntities.clear();
+}
+
+void Game::setInputLog(const std::string &recordPath, const std::string &replayPath)
+{
+    m_recordPath = recordPath;
+    m_replayPath = replayPath;
+}
+
+void Game::startInputLog()
+{
+    if (!m_replayPath.empty())
+    {
+        m_replay.load(m_replayPath);
+        // same tick length, tuning and kernel as the recording, or the checksums cannot match
+        const InputLog::Header &header = m_replay.getHeader();
+        m_stepper.setTickRate(header.m_tickRate);
+        m_player.m_constData = header.m_constData;
+        m_vehicles.setPath((VehicleSystem::Path)header.m_path);
+        // the same traffic, AI cars spawn from a fixed seed
+        m_cars.setEnabled(header.m_carCollisions != 0);
+        m_aiCount = (int)header.m_aiCars;
+        spawnAI(header.m_aiCars);
+        if (InputLog::checksum(m_player.m_data) != header.m_initialChecksum) std::cerr << "Replay starts from a different player state than the recording\n";
+        std::cout << "Replaying " << m_replayPath << ": " << m_replay.getTickCount() << " ticks at " << header.m_tickRate << " Hz\n";
+    }
 
-    using Vertices = std::vector<Vertex>;
-    using Indicies = std::vector<unsigned>;
+    if (!m_recordPath.empty())
+    {
+        InputLog::Header header;
+        header.m_tickRate = m_stepper.getTickRate();
+        header.m_path = (uint32_t)m_vehicles.getPath();
+        header.m_aiCars = (uint32_t)(m_vehicles.count() - 1); // slot 0 is the player
+        header.m_carCollisions = m_cars.isEnabled() ? 1 : 0;
+        header.m_initialChecksum = InputLog::checksum(m_player.m_data);
+        header.m_constData = m_player.m_constData;
+        m_recorder.start(m_recordPath, header);
+    }
+}
+
+void Game::reportReplay() const
+{
+    std::cout << "Replay: " << m_replay.getTick() << " of " << m_replay.getTickCount() << " ticks, " << m_replay.getChecksumsMatched() << " checksums matched";
+    if (m_replay.hasDiverged()) std::cout << ", diverged before tick " << m_replay.getDivergedTick();
+    std::cout << "\n";
+}
 
-    const float tiling = 100000.0f;
-    const float halfW = 512.0f * 5.0f;
-    const float halfH = 512.0f * 5.0f;
-    Vertices rectVerts = {
-        {{-halfW, -halfH, 0.0f}, {0.0f, 0.0f}}, //
-        {{halfW, -halfH, 0.0f}, {1.0f, 0.0f}},  //
-        {{halfW, halfH, 0.0f}, {1.0f, 1.0f}},   //
-        {{-halfW, halfH, 0.0f}, {0.0f, 1.0f}}   //
-    };
-    Indicies rectInds = {
-        0, 1, 2, //
-        0, 2, 3  //
-    };
-    Mesh *quadMesh = new Mesh(rectVerts, rectInds, *m_raceTrackTex);
+void Game::update(const InputState &input, float deltaTime)
+{
+    PROFILE_SCOPE("Simulation");
+    // simulation runs at a fixed rate, rendering interpolates between ticks
+    int steps = m_stepper.advance(deltaTime);
+    float step = m_stepper.getStep();
+    for (int i = 0; i < steps; i++)
+    {
+        // a replay stands in for the keyboard until it runs out
+        bool replaying = m_replay.isPlaying();
+        InputState tickInput = replaying ? m_replay.next() : input;
+
+        World &world = m_renderer.getScene().getWorld();
+        m_player.handleInput(tickInput, step);
+        m_player.applyControls();
+        GameSystems::pushControls(world, m_vehicles);
+        m_vehicles.update(step, &m_jobs);
+        GameSystems::pullState(world, m_vehicles, &m_jobs);
+        m_player.readState();
+
+        // zoom and the panel key are per tick too, so a replay plays back the whole session
+        float &camZoom = m_renderer.getCamera().getZoom();
+        if (tickInput.down(InputState::ZoomIn)) camZoom *= 1.0f + 1.0f * step;
+        if (tickInput.down(InputState::ZoomOut)) camZoom /= 1.0f + 1.0f * step;
+        bool panelKey = tickInput.down(InputState::TogglePanel);
+        if (panelKey && !m_panelKeyWasDown) m_showControlPanel = !m_showControlPanel;
+        m_panelKeyWasDown = panelKey;
+
+        m_recorder.record(tickInput, m_player.m_data);
+        if (replaying)
+        {
+            m_replay.verify(m_player.m_data);
+            if (!m_replay.isPlaying()) reportReplay();
+        }
+    }
+    World &world = m_renderer.getScene().getWorld();
+    TransformStore &transforms = m_renderer.getScene().getTransforms();
+    GameSystems::interpolate(world, transforms, m_stepper.getAlpha(), &m_jobs);
+    GameSystems::followCamera(world, transforms, m_renderer.getCamera(), deltaTime);
+    m_trackTiles.update(m_renderer.getCamera(), deltaTime);
+    m_renderer.getScene().updateBounds(&m_jobs);
+    // visual only, from the state the ticks left behind, so replays stay in sync
+    updateEffects(deltaTime);
+    m_renderer.getParticles().update(deltaTime);
+}
 
-    SceneObject *obj1 = new SceneObject(*quadMesh, glm::vec2(100.0f, 100.0f), glm::vec2(1.0f), 0.0f);
-    m_renderer.getScene().addObject(obj1);
+void Game::updateEffects(float deltaTime)
+{
+    // rear wheels relative to the car's centre, x along the heading
+    const glm::vec2 rearWheel(-28.0f, 22.0f);
+    // sideways speed where tires start to slide, and how much more until they slide fully
+    const float slideSpeed = 120.0f, slideRange = 300.0f;
+    // below this forward speed, throttle spins the wheels
+    const float spinSpeed = 150.0f;
+    const float markHalfWidth = 5.0f, markStrength = 0.3f;
+    // longer than any frame's travel; more is a teleport, not a slide
+    const float maxMarkStep = 100.0f;
+    const float smokeRate = 60.0f, sparkRate = 400.0f; // per second, at full slip or full speed
+    const float sparkSpeed = 150.0f;
+
+    const PlayerData &data = m_player.m_data;
+    float heading = glm::radians(data.m_rotation);
+    glm::vec2 forward(std::cos(heading), std::sin(heading)), right(-forward.y, forward.x);
+    float sideways = std::abs(glm::dot(data.m_velocity, right));
+    float ahead = glm::dot(data.m_velocity, forward);
+    float slide = glm::clamp((sideways - slideSpeed) / slideRange, 0.0f, 1.0f);
+    float spin = ahead < spinSpeed ? data.m_throttle * (1.0f - std::max(ahead, 0.0f) / spinSpeed) : 0.0f;
+    float slip = std::max(slide, glm::clamp(spin, 0.0f, 1.0f));
+
+    SkidMarks &marks = m_renderer.getSkidMarks();
+    ParticleSystem &particles = m_renderer.getParticles();
+    m_smokeCarry += smokeRate * slip * deltaTime;
+    int puffs = (int)m_smokeCarry;
+    m_smokeCarry -= (float)puffs;
+    for (int wheel = 0; wheel < 2; wheel++)
+    {
+        glm::vec2 position = data.m_position + forward * rearWheel.x + right * (wheel ? rearWheel.y : -rearWheel.y);
+        bool connected = m_wheelsPlaced && glm::length(position - m_lastWheels[wheel]) < maxMarkStep;
+        if (slip > 0.0f && connected) marks.add(m_lastWheels[wheel], position, markHalfWidth, markStrength * slip);
+        // smoke trails behind, slower than the car
+        if (puffs) particles.emit(ParticleSystem::Smoke, position, data.m_velocity * 0.2f, puffs);
+        m_lastWheels[wheel] = position;
+    }
+    m_wheelsPlaced = true;
 
-    m_player.init(m_renderer);
+    // the wall keeps the body exactly kCarRadius inside, that's when it scrapes
+    TrackCollider::Sample edge = m_track.sample(data.m_position);
+    float speed = glm::length(data.m_velocity);
+    if (edge.m_distance + VehicleMath::kCarRadius > -2.0f && speed > sparkSpeed)
+    {
+        m_sparkCarry += sparkRate * std::min(speed / m_player.m_constData.maxSpeed, 1.0f) * deltaTime;
+        int sparks = (int)m_sparkCarry;
+        m_sparkCarry -= (float)sparks;
+        glm::vec2 contact = data.m_position + edge.m_normal * VehicleMath::kCarRadius;
+        particles.emit(ParticleSystem::Spark, contact, data.m_velocity * 0.5f - edge.m_normal * 100.0f, sparks);
+    }
 }
 
 void Game::gameLoop()
 {
     int counter = 0;
     bool show_demo_window = false;
-    bool showControlPanel = true;
-    bool TabDown = false;
-    bool TabWasDown = false;
+    bool showProfiler = false;
+    bool captureWasDown = false;
 
-    float &camZoom = m_renderer.getCamera().getZoom();
     float *zoom = &m_renderer.getCamera().getZoom();
     float *pos = glm::value_ptr(m_renderer.getCamera().getPos());
 
     float deltaTime;
     const auto &data = m_player.m_data;
 
+    Profiler &profiler = Profiler::get();
     while (!glfwWindowShouldClose(m_window))
     {
-        // Poll events
+        profiler.beginFrame();
+
+        // Poll events, as late as the pacing mode wants
+        m_pacer.waitForInput();
         glfwPollEvents();
+        InputState input = InputState::fromWindow(m_window);
 
         deltaTime = ImGui::GetIO().DeltaTime;
-        m_player.handleInput(m_window, deltaTime);
-        m_player.update(deltaTime);
+        update(input, deltaTime);
 
-        TabDown = (glfwGetKey(m_window, GLFW_KEY_TAB) == GLFW_PRESS);
-        if (TabDown && !TabWasDown) showControlPanel = !showControlPanel;
-        TabWasDown = TabDown;
-
-        if (glfwGetKey(m_window, GLFW_KEY_Z) == GLFW_PRESS) camZoom *= 1.0f + 1.0f * deltaTime;
-        if (glfwGetKey(m_window, GLFW_KEY_X) == GLFW_PRESS) camZoom /= 1.0f + 1.0f * deltaTime;
+        bool captureDown = input.down(InputState::CaptureTrace);
+        if (captureDown && !captureWasDown) profiler.captureTrace();
+        captureWasDown = captureDown;
 
         // Start ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
@@ -132,7 +326,7 @@ void Game::gameLoop()
         ImGui::NewFrame();
 
         // Control panel
-        if (showControlPanel)
+        if (m_showControlPanel)
         {
             ImGui::Begin("Control Panel (Tab to toggle)");
 
@@ -140,6 +334,64 @@ void Game::gameLoop()
             ImGui::Text("Button pressed %d times", counter);
             ImGui::Text("FPS: %.2f", ImGui::GetIO().Framerate);
             ImGui::Text("mSPF: %.5f miliseconds", ImGui::GetIO().DeltaTime * 1000.0f);
+            const auto &renderStats = m_renderer.getStats();
+            ImGui::Text("Draw calls: %d (%d sprites, %d materials)", renderStats.m_drawCalls, renderStats.m_instances, renderStats.m_materials);
+            ImGui::Text("Binds: %d program, %d texture, %d mesh; atlas pages: %d", renderStats.m_programBinds, renderStats.m_textureBinds, renderStats.m_meshBinds, (int)m_renderer.getAtlas().getPageCount());
+            const auto &poolStats = m_renderer.getMeshPool().getStats();
+            ImGui::Text("Mesh pool: %d meshes, %.1f / %.1f KB vertices, %.1f / %.1f KB indices, %d grows", poolStats.m_meshes, poolStats.m_vertexBytes / 1024.0f, poolStats.m_vertexCapacity / 1024.0f, poolStats.m_indexBytes / 1024.0f, poolStats.m_indexCapacity / 1024.0f, poolStats.m_grows);
+            const auto &arenaStats = FrameArena::get().getStats();
+            const auto worldStats = m_renderer.getScene().getWorld().getStats();
+            ImGui::Text("Frame arena: %.1f / %.1f KB in %d allocations, %d overflowed", arenaStats.m_bytes / 1024.0f, arenaStats.m_capacity / 1024.0f, arenaStats.m_allocations, arenaStats.m_overflows);
+            if (MemoryStats::isCounting()) ImGui::Text("Heap allocations last frame: %llu", (unsigned long long)arenaStats.m_heapAllocations);
+            ImGui::Text("World: %zu entities in %zu archetypes, %zu chunks of %zu KB", worldStats.m_entities, worldStats.m_archetypes, worldStats.m_chunks, World::kChunkBytes / 1024);
+            const auto transformStats = m_renderer.getScene().getTransforms().getStats();
+            ImGui::Text("Transforms: %zu nodes, %zu recomputed last frame in %zu levels", transformStats.m_nodes, transformStats.m_updated, transformStats.m_levels);
+            ResourceManager &resources = m_renderer.getResources();
+            const auto &resourceStats = resources.getStats();
+            ImGui::Text("Resources: %d textures (%.1f MB), %d meshes, %d shaders; %d unused, %d awaiting delete", resourceStats.m_textures, resourceStats.m_textureBytes / (1024.0f * 1024.0f), resourceStats.m_meshes, resourceStats.m_shaders, resourceStats.m_unused, resourceStats.m_pendingDeletes);
+            ImGui::Text("Loads: %d, reused %d by path and %d by content, %d evicted", resourceStats.m_loads, resourceStats.m_pathHits, resourceStats.m_contentHits, resourceStats.m_evictions);
+            ResourceManager::Budget budget = resources.getBudget();
+            int textureBudgetMb = (int)(budget.m_textureBytes / (1024 * 1024));
+            if (ImGui::SliderInt("Texture budget (MB)", &textureBudgetMb, 0, 1024))
+            {
+                budget.m_textureBytes = (size_t)textureBudgetMb * 1024 * 1024;
+                resources.setBudget(budget);
+            }
+            const auto &tileStats = m_trackTiles.getStats();
+            ImGui::Text("Track tiles: %d / %d resident (%.1f MB), %d loading, %d waiting; %d requests, %d evicted", tileStats.m_resident, tileStats.m_tiles, tileStats.m_residentBytes / (1024.0f * 1024.0f), tileStats.m_loading, tileStats.m_waiting, tileStats.m_requests, tileStats.m_evictions);
+            ImGui::Text("Tile prefetch: %.0f units ahead; split took %.1f ms", tileStats.m_lookahead, tileStats.m_splitMs);
+            int tileCache = m_trackTiles.getCacheSize();
+            if (ImGui::SliderInt("Tile cache", &tileCache, 10, 256)) m_trackTiles.setCacheSize(tileCache);
+            // the track isn't in the input log, switching it would break a recording or replay
+            if (!m_recorder.isRecording() && !m_replay.isPlaying())
+            {
+                static const char *tracks[][2] = {{"Race track", "resources/textures/race_track.png"}, {"Track", "resources/textures/track.png"}};
+                ImGui::Text("Track:");
+                for (const auto &track : tracks)
+                {
+                    ImGui::SameLine();
+                    if (ImGui::Button(track[0]) && m_trackPath != track[1]) loadTrack(track[1]);
+                }
+            }
+            const auto &glCounters = GLStateCache::get().getCounters();
+            int glIssued = 0, glSkipped = 0;
+            for (int kind = 0; kind < GLStateCache::kKindCount; kind++)
+            {
+                glIssued += glCounters.m_issued[kind];
+                glSkipped += glCounters.m_skipped[kind];
+            }
+            if (ImGui::TreeNode("glstate", "GL state calls: %d issued, %d skipped", glIssued, glSkipped))
+            {
+                for (int kind = 0; kind < GLStateCache::kKindCount; kind++)
+                    ImGui::Text("%-14s %4d issued, %4d skipped", GLStateCache::kindName((GLStateCache::Kind)kind), glCounters.m_issued[kind], glCounters.m_skipped[kind]);
+                ImGui::TreePop();
+            }
+            const auto &sceneStats = m_renderer.getScene().getStats();
+            ImGui::Text("Scene: %d submitted, %d culled (%d cells visited)", sceneStats.m_submitted, sceneStats.m_culled, sceneStats.m_cellsVisited);
+            const auto &particleStats = m_renderer.getParticles().getStats();
+            ImGui::Text("Particles: %zu / %zu alive, %zu emitted last frame (%zu over live ones), %.3f ms", particleStats.m_alive, ParticleSystem::kCapacity, particleStats.m_emitted, particleStats.m_recycled, particleStats.m_ms);
+            const auto &skidStats = m_renderer.getSkidMarks().getStats();
+            ImGui::Text("Skid marks: %zu segments baked last frame, %zu dropped; %.1f MB texture", skidStats.m_segments, skidStats.m_dropped, skidStats.m_bytes / (1024.0f * 1024.0f));
             ImGui::Text("Runtime: %.2f", ImGui::GetTime());
             ImGui::Text("Mouse: %.2f, %.2f", ImGui::GetIO().MousePos.x, ImGui::GetIO().MousePos.y);
             if (ImGui::Button("Click Me"))
@@ -147,6 +399,27 @@ void Game::gameLoop()
                 counter++;
             }
             ImGui::Checkbox("Enable demo window", &show_demo_window);
+            ImGui::SameLine();
+            ImGui::Checkbox("Profiler", &showProfiler);
+
+            const auto &streamStats = m_renderer.getStreamer().getStats();
+            ImGui::Text("First frame: %.1f ms", m_firstFrameMs);
+            const auto &shaderStats = ShaderCache::get().getStats();
+            ImGui::Text("Shaders: %d programs in %.1f ms, %d from binaries, %d compiled, %d rejected%s", shaderStats.m_programs, shaderStats.m_buildMs, shaderStats.m_hits, shaderStats.m_compiled, shaderStats.m_rejected, ShaderCache::get().isParallel() ? ", parallel" : "");
+            bool overdraw = m_renderer.getDebugView() == Renderer::Overdraw;
+            if (ImGui::Checkbox("Overdraw view", &overdraw)) m_renderer.setDebugView(overdraw ? Renderer::Overdraw : Renderer::Normal);
+            ImGui::Text("Streaming: %d pending, %d done, %.2f MB last frame", streamStats.m_pending, streamStats.m_completed, streamStats.m_frameBytes / (1024.0f * 1024.0f));
+            ImGui::Text("Longest hitch while streaming: %.2f ms (upload %.2f ms)", m_streamHitchMs, streamStats.m_maxFrameMs);
+            int budgetKb = (int)(m_renderer.getStreamer().getUploadBudget() / 1024);
+            if (ImGui::SliderInt("Upload budget (KB)", &budgetKb, 256, 32768)) m_renderer.getStreamer().setUploadBudget((size_t)budgetKb * 1024);
+            if (ImGui::Button("Stream stress test"))
+            {
+                // dozens of large textures that nothing draws, just to load the streamer
+                m_stressTextures.clear();
+                m_streamHitchMs = 0.0;
+                for (int i = 0; i < 32; i++)
+                    m_stressTextures.push_back(m_renderer.getStreamer().request(i % 2 ? "resources/textures/race_track.png" : "resources/textures/track.png"));
+            }
 
             ImGui::BeginChild("alldata", ImVec2(0, 0), true);
 
@@ -155,16 +428,95 @@ void Game::gameLoop()
             ImGui::SliderFloat2("Camera position", pos, -400.0f, 400.0f);
             ImGui::SliderFloat("Camera smoothing", &m_player.m_constData.cameraSmoothing, 0.0f, 30.0f);
 
-            ImGui::Text("Car params:");
-            ImGui::SliderFloat("Max Speed", &m_player.m_constData.maxSpeed, 10.0f, 1000.0f);
-            ImGui::SliderFloat("Acceleration rate", &m_player.m_constData.accelerationRate, 10.0f, 1000.0f);
-            ImGui::SliderFloat("Max turn rate", &m_player.m_constData.maxTurnRate, -1000.0f, 1000.0f);
-            ImGui::SliderFloat("Turn rate", &m_player.m_constData.turnRate, -1000.0f, 1000.0f);
-            ImGui::SliderFloat("Angular drag", &m_player.m_constData.angularDrag, 0.0f, 3.0f);
-            ImGui::SliderFloat("Linear drag", &m_player.m_constData.linearDrag, 0.0f, 3.0f);
+            ImGui::Text("Frame pacing (%.0f Hz display):", m_pacer.getRefreshHz());
+            const char *paceModes[FramePacer::kModeCount];
+            for (int i = 0; i < FramePacer::kModeCount; i++)
+                paceModes[i] = FramePacer::modeName((FramePacer::Mode)i);
+            int paceMode = (int)m_pacer.getMode();
+            if (ImGui::Combo("Pacing", &paceMode, paceModes, FramePacer::kModeCount)) m_pacer.setMode((FramePacer::Mode)paceMode);
+            if (paceMode == FramePacer::AdaptiveVSync && !m_pacer.isAdaptiveSupported()) ImGui::Text("No swap_control_tear here, same as VSync");
+            float targetFps = (float)m_pacer.getTargetFps();
+            if (paceMode == FramePacer::Capped && ImGui::SliderFloat("Frame cap (fps)", &targetFps, 10.0f, 500.0f)) m_pacer.setTargetFps(targetFps);
+            const auto &pacing = m_pacer.getStats();
+            ImGui::Text("Frame %.2f ms: mean %.2f, std dev %.2f, max %.2f", pacing.m_frameMs, pacing.m_meanMs, pacing.m_stdDevMs, pacing.m_maxMs);
+            ImGui::Text("Input latency %.2f ms (mean %.2f): waited %.2f, worked %.2f", pacing.m_latencyMs, pacing.m_meanLatencyMs, pacing.m_waitMs, pacing.m_workMs);
+            if (paceMode == FramePacer::Capped) ImGui::Text("Sleep overshoot %.3f ms, spun instead", pacing.m_oversleepMs);
+            if (paceMode == FramePacer::JustInTime) ImGui::Text("Missed vblanks: %d", pacing.m_missed);
+            ImGui::PlotLines("Frame ms##pacing", m_pacer.getFramePlot(), FramePacer::kPlotFrames, m_pacer.getPlotHead(), nullptr, 0.0f, 50.0f, ImVec2(0.0f, 60.0f));
+            ImGui::PlotLines("Latency ms", m_pacer.getLatencyPlot(), FramePacer::kPlotFrames, m_pacer.getPlotHead(), nullptr, 0.0f, 50.0f, ImVec2(0.0f, 60.0f));
+
+            ImGui::Text("Simulation:");
+            // tick rate, tuning, kernel, traffic and collisions are in the log header, changing them
+            // mid-session would make the replay diverge for reasons the recorded input didn't cause
+            bool logging = m_recorder.isRecording() || m_replay.isPlaying();
+            float tickRate = m_stepper.getTickRate();
+            if (!logging && ImGui::SliderFloat("Tick rate (Hz)", &tickRate, 10.0f, 1000.0f)) m_stepper.setTickRate(tickRate);
+            int maxCatchUp = m_stepper.getMaxCatchUpSteps();
+            if (ImGui::SliderInt("Max catch-up ticks", &maxCatchUp, 1, 32)) m_stepper.setMaxCatchUpSteps(maxCatchUp);
+            ImGui::Text("Ticks this frame: %d, alpha: %.2f, dropped: %.2f s", m_stepper.getLastSteps(), m_stepper.getAlpha(), m_stepper.getDroppedTime());
+            if (m_replay.getTickCount() > 0) ImGui::Text("Replay: tick %u of %u, %u checksums matched%s", m_replay.getTick(), m_replay.getTickCount(), m_replay.getChecksumsMatched(), m_replay.hasDiverged() ? ", DIVERGED" : "");
+            if (m_recorder.isRecording())
+            {
+                ImGui::Text("Recording: %u ticks", m_recorder.getTicks());
+                ImGui::SameLine();
+                if (ImGui::Button("Stop recording")) m_recorder.stop();
+            }
+
+            ImGui::Text("Vehicles (%s):", VehicleSystem::pathName(m_vehicles.getPath()));
+            if (!logging)
+            {
+                ImGui::SliderInt("AI cars", &m_aiCount, 0, 100000);
+                ImGui::SameLine();
+                if (ImGui::Button("Spawn")) spawnAI((size_t)m_aiCount);
+            }
+            const char *paths[] = {"Scalar", "SSE", "AVX2"};
+            int path = (int)m_vehicles.getPath();
+            if (!logging && ImGui::Combo("Kernel", &path, paths, IM_ARRAYSIZE(paths))) m_vehicles.setPath((VehicleSystem::Path)path);
+            if (ImGui::Button("Benchmark 100k cars"))
+            {
+                for (int p = 0; p < 3; p++)
+                    m_benchmarkResults[p] = VehicleSystem::supported((VehicleSystem::Path)p) ? VehicleSystem::benchmark((VehicleSystem::Path)p, 100000, 20) : 0.0;
+                m_benchmarkResults[3] = VehicleSystem::benchmark(VehicleSystem::bestPath(), 100000, 20, &m_jobs);
+            }
+            ImGui::Text("Vehicles/ms: scalar %.0f, SSE %.0f, AVX2 %.0f", m_benchmarkResults[0], m_benchmarkResults[1], m_benchmarkResults[2]);
+            ImGui::Text("Vehicles/ms on %d threads: %.0f", m_jobs.getThreadCount(), m_benchmarkResults[3]);
+
+            bool collide = m_cars.isEnabled();
+            if (!logging && ImGui::Checkbox("Car collisions", &collide)) m_cars.setEnabled(collide);
+            const auto &collisionStats = m_cars.getStats();
+            double naivePairs = (double)collisionStats.m_bodies * (collisionStats.m_bodies - 1) / 2.0;
+            ImGui::Text("Last tick: %zu pairs tested (naive %.0f), %zu contacts, %zu swept, %zu sort moves, %.3f ms", collisionStats.m_pairs, naivePairs, collisionStats.m_contacts, collisionStats.m_swept, collisionStats.m_moves, collisionStats.m_ms);
+            const size_t collisionCounts[] = {1000, 5000, 10000, 50000};
+            if (ImGui::Button("Benchmark collisions"))
+                for (int i = 0; i < 4; i++)
+                    m_collisionResults[i] = CarCollider::benchmark(collisionCounts[i], 60, &m_jobs);
+            for (int i = 0; i < 4; i++)
+                if (m_collisionResults[i].m_bodies) ImGui::Text("%zu cars: %zu pairs, %zu contacts per tick, %.3f ms", m_collisionResults[i].m_bodies, m_collisionResults[i].m_pairs, m_collisionResults[i].m_contacts, m_collisionResults[i].m_ms);
+
+            ImGui::Text("Job system:");
+            for (int i = 0; i < m_jobs.getThreadCount(); i++)
+            {
+                const auto &jobStats = m_jobs.getStats(i);
+                char label[64];
+                snprintf(label, sizeof(label), "%s %d: %u jobs, %u stolen", i == 0 ? "main" : "worker", i, jobStats.m_jobs, jobStats.m_steals);
+                ImGui::ProgressBar(jobStats.m_utilization, ImVec2(-1.0f, 0.0f), label);
+            }
+
+            if (!logging)
+            {
+                ImGui::Text("Car params:");
+                ImGui::SliderFloat("Max Speed", &m_player.m_constData.maxSpeed, 10.0f, 1000.0f);
+                ImGui::SliderFloat("Acceleration rate", &m_player.m_constData.accelerationRate, 10.0f, 1000.0f);
+                ImGui::SliderFloat("Max turn rate", &m_player.m_constData.maxTurnRate, -1000.0f, 1000.0f);
+                ImGui::SliderFloat("Turn rate", &m_player.m_constData.turnRate, -1000.0f, 1000.0f);
+                ImGui::SliderFloat("Angular drag", &m_player.m_constData.angularDrag, 0.0f, 3.0f);
+                ImGui::SliderFloat("Linear drag", &m_player.m_constData.linearDrag, 0.0f, 3.0f);
+            }
 
             ImGui::BeginChild("cardata", ImVec2(0, 0), true);
             ImGui::Text("Car data:");
+            TrackCollider::Sample trackSample = m_track.sample(data.m_position);
+            ImGui::Text("Track: %.1f from edge, friction %.2f (SDF %s in %.1f ms)", -trackSample.m_distance, trackSample.m_friction, m_track.wasCached() ? "cached" : "built", m_track.getLoadMs());
             ImGui::Text("Steering: %.2f, Throttle: %.2f", data.m_steer, data.m_throttle);
             ImGui::Text("Angular velocity: %.2f, Rotation: %.2f", data.m_angularVelocity, data.m_rotation);
             ImGui::Text("Position: %.2f, %.2f", data.m_position.x, data.m_position.y);
@@ -187,27 +539,78 @@ void Game::gameLoop()
         ImGui::End();
 
         if (show_demo_window) ImGui::ShowDemoWindow(&show_demo_window);
+        if (showProfiler) profiler.drawPanel(&showProfiler);
 
         m_renderer.renderFrame();
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            PROFILE_GPU_SCOPE("ImGui");
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            GLStateCache::get().invalidate();
+        }
 
         // Swap buffers
-        glfwSwapBuffers(m_window);
+        {
+            PROFILE_SCOPE("Swap");
+            m_pacer.beforeSwap();
+            glfwSwapBuffers(m_window);
+            m_pacer.afterSwap();
+        }
+
+        trackStreaming();
+        m_jobs.endFrame();
+        GLStateCache::get().endFrame();
+        FrameArena::get().endFrame();
+        profiler.endFrame();
     }
 }
 
+void Game::trackStreaming()
+{
+    if (m_firstFrameMs < 0.0)
+    {
+        m_firstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+        std::cout << "First frame after " << m_firstFrameMs << " ms\n";
+        return;
+    }
+
+    bool streaming = !m_renderer.getStreamer().idle();
+    if (streaming) m_streamHitchMs = std::max(m_streamHitchMs, (double)ImGui::GetIO().DeltaTime * 1000.0);
+    if (m_wasStreaming && !streaming) std::cout << "Streaming finished, longest hitch " << m_streamHitchMs << " ms\n";
+    m_wasStreaming = streaming;
+}
+
 void Game::shutDown()
 {
-    // ImGui shutdown
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    bool windowed = m_window != nullptr;
+    if (windowed)
+    {
+        // ImGui shutdown
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
+
+    m_recorder.stop();
+    if (m_replay.isPlaying() && m_replay.getTick() > 0) reportReplay();
 
+    // release GL textures while the context is still alive
+    m_stressTextures.clear();
+    unloadTrack();
+    destroyAI();
+    m_player.cleanup(m_renderer);
     m_renderer.cleanup();
+    Profiler::get().flush();
+    Profiler::get().cleanupGpu();
 
-    // GLFW cleanup
-    glfwDestroyWindow(m_window);
-    glfwTerminate();
-    m_window = nullptr;
-}
\ No newline at end of file
+    if (windowed)
+    {
+        // GLFW cleanup
+        glfwDestroyWindow(m_window);
+        glfwTerminate();
+        m_window = nullptr;
+    }
+    m_headless.cleanup();
+
+    m_jobs.shutdown();
+}
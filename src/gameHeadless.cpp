@@ -0,0 +1,214 @@
+// gameHeadless.cpp
+#include "game.h"
+#include "frameArena.h"
+#include "glStateCache.h"
+#include "memoryStats.h"
+#include "pngWriter.h"
+#include "profiler.h"
+#include "shaderCache.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+namespace
+{
+struct FrameTiming
+{
+    double m_total;
+    double m_simulation;
+    double m_render; // CPU side of renderFrame
+    double m_gpu;    // waiting in glFinish
+};
+
+double msSince(std::chrono::steady_clock::time_point start) { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); }
+
+double percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(p * (values.size() - 1) + 0.5)];
+}
+
+// laps of full throttle with alternating long and short turns, same every run
+InputState scriptedInput(int frame)
+{
+    InputState input;
+    input.set(InputState::Throttle, true);
+    int phase = frame % 240;
+    input.set(InputState::SteerLeft, phase < 40);
+    input.set(InputState::SteerRight, phase >= 120 && phase < 140);
+    return input;
+}
+} // namespace
+
+void Game::initHeadless(const HeadlessOptions &options)
+{
+    m_headless.init(options.m_width, options.m_height);
+    Profiler::setThreadName("main");
+    Profiler::get().initGpu();
+
+    m_jobs.init();
+    m_pacer.init(nullptr, options.m_fpsCap > 0 ? FramePacer::Capped : FramePacer::Uncapped);
+    if (options.m_fpsCap > 0) m_pacer.setTargetFps(options.m_fpsCap);
+    m_renderer.onResize(options.m_width, options.m_height);
+    m_renderer.init(nullptr);
+
+    setupScene();
+    m_cars.setEnabled(options.m_carCollisions);
+    if (options.m_aiCars > 0) spawnAI((size_t)options.m_aiCars);
+    startInputLog();
+}
+
+int Game::runHeadless(const HeadlessOptions &options)
+{
+    m_startTime = std::chrono::steady_clock::now();
+    initHeadless(options);
+    // a replay runs to its end unless told otherwise
+    bool replaying = m_replay.isPlaying();
+    int frameLimit = options.m_frames > 0 ? options.m_frames : replaying ? INT_MAX : 600;
+    if (replaying) std::printf("Headless %dx%d on %s, replaying\n", options.m_width, options.m_height, (const char *)glGetString(GL_RENDERER));
+    else std::printf("Headless %dx%d on %s, %d frames\n", options.m_width, options.m_height, (const char *)glGetString(GL_RENDERER), frameLimit);
+
+    // let streamed textures land first so every measured frame draws the same scene
+    int warmup = 0;
+    for (; warmup < 1000 && (!m_renderer.getStreamer().idle() || !m_trackTiles.idle()); warmup++)
+    {
+        m_trackTiles.update(m_renderer.getCamera(), 0.0f);
+        m_headless.bind();
+        m_renderer.renderFrame();
+        glFinish();
+        FrameArena::get().endFrame();
+    }
+    std::printf("Startup %.1f ms, %d warm-up frames\n", msSince(m_startTime), warmup);
+    const auto &shaderStats = ShaderCache::get().getStats();
+    std::printf("Shaders: %d programs in %.1f ms, %d from binaries, %d compiled, %d rejected (binaries %s, parallel compile %s)\n", shaderStats.m_programs, shaderStats.m_buildMs, shaderStats.m_hits, shaderStats.m_compiled, shaderStats.m_rejected, ShaderCache::get().isEnabled() ? "on" : "off", ShaderCache::get().isParallel() ? "on" : "off");
+
+    // fixed simulated frame time so runs are reproducible, wall time is what gets measured
+    const float frameTime = 1.0f / 60.0f;
+    std::vector<FrameTiming> timings;
+    timings.reserve(replaying ? m_replay.getTickCount() : frameLimit);
+    long long drawCalls = 0, sprites = 0, culled = 0, binds = 0, glIssued = 0, glSkipped = 0, transformsUpdated = 0, collisionPairs = 0, collisionContacts = 0, particlesAlive = 0, skidSegments = 0, particlesRecycled = 0;
+    double collisionMs = 0.0;
+    int maxDrawCalls = 0;
+    uint64_t heapAllocations = 0;
+    int heapFrames = 0;
+    size_t arenaPeak = 0;
+    std::vector<uint8_t> pixels;
+
+    Profiler &profiler = Profiler::get();
+    if (!options.m_tracePath.empty()) profiler.captureTrace(frameLimit, options.m_tracePath);
+
+    int frame = 0;
+    for (; frame < frameLimit && (!replaying || m_replay.isPlaying()); frame++)
+    {
+        profiler.beginFrame();
+        // the cap's wait isn't part of the measured frame
+        m_pacer.waitForInput();
+        FrameTiming timing;
+        auto frameStart = std::chrono::steady_clock::now();
+
+        update(scriptedInput(frame), frameTime);
+        timing.m_simulation = msSince(frameStart);
+
+        auto renderStart = std::chrono::steady_clock::now();
+        m_headless.bind();
+        m_renderer.renderFrame();
+        timing.m_render = msSince(renderStart);
+
+        // stands in for the swap: the frame is only done once the GPU is
+        auto gpuStart = std::chrono::steady_clock::now();
+        m_pacer.beforeSwap();
+        glFinish();
+        m_pacer.afterSwap();
+        timing.m_gpu = msSince(gpuStart);
+        timing.m_total = msSince(frameStart);
+        timings.push_back(timing);
+
+        const auto &stats = m_renderer.getStats();
+        drawCalls += stats.m_drawCalls;
+        binds += stats.m_programBinds + stats.m_textureBinds + stats.m_meshBinds;
+        sprites += stats.m_instances;
+        culled += m_renderer.getScene().getStats().m_culled;
+        transformsUpdated += (long long)m_renderer.getScene().getTransforms().getStats().m_updated;
+        // the frame's last tick
+        collisionPairs += (long long)m_cars.getStats().m_pairs;
+        collisionContacts += (long long)m_cars.getStats().m_contacts;
+        collisionMs += m_cars.getStats().m_ms;
+        maxDrawCalls = std::max(maxDrawCalls, stats.m_drawCalls);
+        particlesAlive += (long long)m_renderer.getParticles().getStats().m_alive;
+        particlesRecycled += (long long)m_renderer.getParticles().getStats().m_recycled;
+        skidSegments += (long long)m_renderer.getSkidMarks().getStats().m_segments;
+
+        // readback is outside the measured frame
+        if (std::find(options.m_dumpFrames.begin(), options.m_dumpFrames.end(), frame) != options.m_dumpFrames.end())
+        {
+            m_headless.readPixels(pixels);
+            char name[32];
+            std::snprintf(name, sizeof(name), "/frame_%05d.png", frame);
+            std::string path = options.m_dumpDir + name;
+            if (!Png::write(path, options.m_width, options.m_height, pixels.data())) std::fprintf(stderr, "Failed to write %s\n", path.c_str());
+            else std::printf("Wrote %s\n", path.c_str());
+        }
+        m_jobs.endFrame();
+        GLStateCache &glState = GLStateCache::get();
+        glState.endFrame();
+        for (int kind = 0; kind < GLStateCache::kKindCount; kind++)
+        {
+            glIssued += glState.getCounters().m_issued[kind];
+            glSkipped += glState.getCounters().m_skipped[kind];
+        }
+        profiler.endFrame();
+        FrameArena &arena = FrameArena::get();
+        arena.endFrame();
+        heapAllocations += arena.getStats().m_heapAllocations;
+        heapFrames += arena.getStats().m_heapAllocations ? 1 : 0;
+        arenaPeak = std::max(arenaPeak, arena.getStats().m_bytes);
+    }
+
+    auto column = [&timings](double FrameTiming::*field)
+    {
+        std::vector<double> values;
+        values.reserve(timings.size());
+        for (const auto &timing : timings)
+            values.push_back(timing.*field);
+        return values;
+    };
+    struct Row
+    {
+        const char *m_name;
+        double FrameTiming::*m_field;
+    } rows[] = {
+        {"frame", &FrameTiming::m_total},
+        {"simulation", &FrameTiming::m_simulation},
+        {"render cpu", &FrameTiming::m_render},
+        {"gpu wait", &FrameTiming::m_gpu},
+    };
+
+    int frames = std::max(1, frame);
+    std::printf("%-12s %9s %9s %9s %9s  (ms)\n", "", "p50", "p95", "p99", "max");
+    for (const auto &row : rows)
+    {
+        std::vector<double> values = column(row.m_field);
+        std::printf("%-12s %9.3f %9.3f %9.3f %9.3f\n", row.m_name, percentile(values, 0.50), percentile(values, 0.95), percentile(values, 0.99), percentile(values, 1.0));
+    }
+    const auto &poolStats = m_renderer.getMeshPool().getStats();
+    std::printf("Mesh pool: %d meshes, %zu vertex bytes, %zu index bytes (%zu B per vertex)\n", poolStats.m_meshes, poolStats.m_vertexBytes, poolStats.m_indexBytes, m_renderer.getMeshPool().getVertexSize());
+    const auto &resourceStats = m_renderer.getResources().getStats();
+    std::printf("Resources: %d textures (%.1f MB), %d meshes, %d shaders; %d loads, %d reused\n", resourceStats.m_textures, resourceStats.m_textureBytes / (1024.0 * 1024.0), resourceStats.m_meshes, resourceStats.m_shaders, resourceStats.m_loads, resourceStats.m_pathHits + resourceStats.m_contentHits);
+    const auto &tileStats = m_trackTiles.getStats();
+    std::printf("Tiles: %d of %d resident (%.1f MB), %d requests, %d evicted; split %.1f ms\n", tileStats.m_resident, tileStats.m_tiles, tileStats.m_residentBytes / (1024.0 * 1024.0), tileStats.m_requests, tileStats.m_evictions, tileStats.m_splitMs);
+    const auto &pacing = m_pacer.getStats();
+    std::printf("Pacing: %s, frame %.2f ms mean, %.3f std dev, %.2f max; input latency %.2f ms mean\n", options.m_fpsCap > 0 ? "capped" : "uncapped", pacing.m_meanMs, pacing.m_stdDevMs, pacing.m_maxMs, pacing.m_meanLatencyMs);
+    std::printf("Collisions: %.1f pairs tested, %.1f contacts, %.3f ms per tick\n", (double)collisionPairs / frames, (double)collisionContacts / frames, collisionMs / frames);
+    std::printf("Effects: %.1f particles alive, %lld recycled; %.1f skid segments per frame into a %.1f MB texture\n", (double)particlesAlive / frames, particlesRecycled, (double)skidSegments / frames, m_renderer.getSkidMarks().getStats().m_bytes / (1024.0 * 1024.0));
+    std::printf("Transforms: %zu nodes, %.1f recomputed per frame\n", m_renderer.getScene().getTransforms().getStats().m_nodes, (double)transformsUpdated / frames);
+    if (MemoryStats::isCounting()) std::printf("Memory: frame arena peak %.1f KB; %llu heap allocations in %d of %d frames\n", arenaPeak / 1024.0, (unsigned long long)heapAllocations, heapFrames, frames);
+    else std::printf("Memory: frame arena peak %.1f KB; heap allocations not counted in this build\n", arenaPeak / 1024.0);
+    std::printf("GL state calls: %.1f issued, %.1f skipped per frame\n", (double)glIssued / frames, (double)glSkipped / frames);
+    std::printf("Draw calls: %.1f avg, %d max; binds %.1f avg; sprites %.1f avg, culled %.1f avg; %zu vehicles\n", (double)drawCalls / frames, maxDrawCalls, (double)binds / frames, (double)sprites / frames, (double)culled / frames, m_vehicles.count());
+
+    // lets a bisect script tell a diverged replay from a slow one
+    bool diverged = m_replay.hasDiverged();
+    shutDown();
+    return diverged ? 1 : 0;
+}
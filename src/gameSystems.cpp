@@ -0,0 +1,65 @@
+// gameSystems.cpp
+#include "gameSystems.h"
+#include "components.h"
+#include "profiler.h"
+#include "transformStore.h"
+#include "vehicleSystem.h"
+#include <algorithm>
+
+namespace GameSystems
+{
+void pushControls(World &world, VehicleSystem &vehicles)
+{
+    world.each<Vehicle, VehicleControl>(
+        [&](Entity, Vehicle &vehicle, VehicleControl &control)
+        {
+            if (vehicle.m_slot < vehicles.count()) vehicles.setControls(vehicle.m_slot, control.m_steer, control.m_throttle);
+        });
+}
+
+void pullState(World &world, const VehicleSystem &vehicles, JobSystem *jobs)
+{
+    PROFILE_SCOPE("Pull state");
+    size_t count = vehicles.count();
+    world.parallelEach<Vehicle, Velocity>(jobs,
+                                          [&](Entity, Vehicle &vehicle, Velocity &velocity)
+                                          {
+                                              size_t slot = vehicle.m_slot;
+                                              if (slot >= count) return;
+                                              vehicle.m_prevPosition = vehicle.m_position;
+                                              vehicle.m_prevRotation = vehicle.m_rotation;
+                                              vehicle.m_position = glm::vec2(vehicles.m_posX[slot], vehicles.m_posY[slot]);
+                                              vehicle.m_rotation = vehicles.m_rotation[slot];
+                                              velocity.m_linear = glm::vec2(vehicles.m_velX[slot], vehicles.m_velY[slot]);
+                                              velocity.m_angular = vehicles.m_angularVelocity[slot];
+                                          });
+}
+
+void interpolate(World &world, TransformStore &transforms, float alpha, JobSystem *jobs)
+{
+    // one node per vehicle, so the parallel writes never share a node
+    world.parallelEach<Vehicle, TransformNode>(jobs,
+                                               [&transforms, alpha](Entity, Vehicle &vehicle, TransformNode &node)
+                                               {
+                                                   glm::vec2 position = glm::mix(vehicle.m_prevPosition, vehicle.m_position, alpha);
+                                                   // rotation wraps at +-360, blend along the short way round
+                                                   float turn = vehicle.m_rotation - vehicle.m_prevRotation;
+                                                   if (turn > 180.0f) turn -= 360.0f;
+                                                   if (turn < -180.0f) turn += 360.0f;
+                                                   transforms.setLocal(node.m_node, position, vehicle.m_prevRotation + turn * alpha);
+                                               });
+}
+
+void followCamera(World &world, const TransformStore &transforms, Camera &camera, float frameTime)
+{
+    world.each<TransformNode, CameraTarget>(
+        [&](Entity, TransformNode &node, CameraTarget &target)
+        {
+            glm::vec2 camPos = camera.getPos();
+            float alpha = std::clamp(target.m_smoothing * frameTime, 0.0f, 1.0f);
+            // the local position: world transforms aren't updated yet this frame, and targets are roots
+            camPos += (transforms.getLocal(node.m_node).m_position - camPos) * alpha;
+            camera.setPosition(camPos);
+        });
+}
+} // namespace GameSystems
@@ -0,0 +1,200 @@
+// glStateCache.cpp
+#include "glStateCache.h"
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+#include <iterator>
+
+GLStateCache &GLStateCache::get()
+{
+    static GLStateCache cache;
+    return cache;
+}
+
+const char *GLStateCache::kindName(Kind kind)
+{
+    static const char *names[kKindCount] = {"program", "active texture", "texture", "vertex array", "buffer", "blend", "uniform", "uniform block"};
+    return names[kind];
+}
+
+GLStateCache::GLStateCache() { invalidate(); }
+
+bool GLStateCache::changed(Kind kind, bool differs)
+{
+    if (differs) m_counters.m_issued[kind]++;
+    else m_counters.m_skipped[kind]++;
+    return differs;
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+    if (!changed(Program, m_program != program)) return;
+    glUseProgram(program);
+    m_program = program;
+}
+
+void GLStateCache::bindTexture(GLuint texture, GLuint unit)
+{
+    if (unit >= kTextureUnits)
+    {
+        // outside the shadow, always issued
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        m_activeUnit = unit;
+        return;
+    }
+    if (!changed(Texture, m_textures[unit] != texture)) return;
+    if (changed(ActiveTexture, m_activeUnit != unit))
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_activeUnit = unit;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    m_textures[unit] = texture;
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+    if (!changed(VertexArray, m_vao != vao)) return;
+    glBindVertexArray(vao);
+    m_vao = vao;
+}
+
+GLuint *GLStateCache::bufferSlot(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+        return &m_arrayBuffer;
+    case GL_UNIFORM_BUFFER:
+        return &m_uniformBuffer;
+    case GL_PIXEL_UNPACK_BUFFER:
+        return &m_unpackBuffer;
+    }
+    return nullptr;
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+    GLuint *slot = bufferSlot(target);
+    if (!changed(Buffer, !slot || *slot != buffer)) return;
+    glBindBuffer(target, buffer);
+    if (slot) *slot = buffer;
+}
+
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    // indexed bindings are set once at init, not worth shadowing
+    changed(Buffer, true);
+    glBindBufferBase(target, index, buffer);
+    if (GLuint *slot = bufferSlot(target)) *slot = buffer;
+}
+
+void GLStateCache::setBlend(bool enabled, GLenum src, GLenum dst)
+{
+    if (changed(Blend, m_blendEnabled != (int)enabled))
+    {
+        if (enabled) glEnable(GL_BLEND);
+        else glDisable(GL_BLEND);
+        m_blendEnabled = enabled;
+    }
+    if (!enabled) return;
+    if (changed(Blend, m_blendSrc != src || m_blendDst != dst))
+    {
+        glBlendFunc(src, dst);
+        m_blendSrc = src;
+        m_blendDst = dst;
+    }
+}
+
+bool GLStateCache::uniformChanged(GLint location, const void *value, int words)
+{
+    // -1 is ignored by GL anyway
+    if (location < 0) return false;
+    if (m_program == kUnknown) return changed(Uniform, true);
+
+    UniformValue &shadow = m_uniforms[((uint64_t)m_program << 32) | (uint32_t)location];
+    bool differs = shadow.m_count != words || std::memcmp(shadow.m_words, value, words * sizeof(uint32_t)) != 0;
+    if (changed(Uniform, differs))
+    {
+        std::memcpy(shadow.m_words, value, words * sizeof(uint32_t));
+        shadow.m_count = words;
+    }
+    return differs;
+}
+
+void GLStateCache::uniform(GLint location, int value)
+{
+    if (uniformChanged(location, &value, 1)) glUniform1i(location, value);
+}
+
+void GLStateCache::uniform(GLint location, float value)
+{
+    if (uniformChanged(location, &value, 1)) glUniform1f(location, value);
+}
+
+void GLStateCache::uniform(GLint location, const glm::vec2 &value)
+{
+    if (uniformChanged(location, glm::value_ptr(value), 2)) glUniform2f(location, value.x, value.y);
+}
+
+void GLStateCache::uniform(GLint location, const glm::mat4 &value)
+{
+    if (uniformChanged(location, glm::value_ptr(value), 16)) glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void GLStateCache::bufferSubData(GLenum target, GLuint buffer, size_t offset, size_t size, const void *data)
+{
+    std::vector<uint8_t> &contents = m_bufferContents[buffer];
+    bool differs = contents.size() < offset + size || std::memcmp(contents.data() + offset, data, size) != 0;
+    if (!changed(UniformBlock, differs)) return;
+
+    if (contents.size() < offset + size) contents.resize(offset + size);
+    std::memcpy(contents.data() + offset, data, size);
+    bindBuffer(target, buffer);
+    glBufferSubData(target, offset, size, data);
+}
+
+void GLStateCache::textureDeleted(GLuint texture)
+{
+    for (auto &bound : m_textures)
+        if (bound == texture) bound = 0;
+}
+
+void GLStateCache::bufferDeleted(GLuint buffer)
+{
+    for (GLuint *slot : {&m_arrayBuffer, &m_uniformBuffer, &m_unpackBuffer})
+        if (*slot == buffer) *slot = 0;
+    m_bufferContents.erase(buffer);
+}
+
+void GLStateCache::vertexArrayDeleted(GLuint vao)
+{
+    if (m_vao == vao) m_vao = 0;
+}
+
+void GLStateCache::programDeleted(GLuint program)
+{
+    // a current program lives on until it is replaced, its name can't come back before that
+    for (auto it = m_uniforms.begin(); it != m_uniforms.end();)
+        it = (it->first >> 32) == program ? m_uniforms.erase(it) : std::next(it);
+}
+
+void GLStateCache::invalidate()
+{
+    m_program = kUnknown;
+    m_activeUnit = kUnknown;
+    for (auto &texture : m_textures)
+        texture = kUnknown;
+    m_vao = kUnknown;
+    m_arrayBuffer = kUnknown;
+    m_uniformBuffer = kUnknown;
+    m_unpackBuffer = kUnknown;
+    m_blendEnabled = -1;
+    m_blendSrc = m_blendDst = 0;
+}
+
+void GLStateCache::endFrame()
+{
+    m_lastFrame = m_counters;
+    m_counters = Counters();
+}
@@ -0,0 +1,107 @@
+// headlessContext.cpp
+#include "headlessContext.h"
+#include <stdexcept>
+#include <string>
+
+#ifdef GAME_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::HeadlessContext() : m_display(nullptr), m_context(nullptr), m_fbo(0), m_colorBuffer(0), m_width(0), m_height(0) {}
+
+HeadlessContext::~HeadlessContext() { cleanup(); }
+
+#ifdef GAME_HAS_EGL
+bool HeadlessContext::available() { return true; }
+
+void HeadlessContext::init(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+
+    // Mesa's surfaceless platform needs no X or DRM device, fall back to the default display
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) throw std::runtime_error("Failed to initialize EGL");
+    m_display = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) throw std::runtime_error("EGL has no desktop OpenGL");
+
+    const EGLint configAttribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, //
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,   //
+        EGL_NONE,                            //
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    // surfaceless displays may expose no configs at all, contexts then go without one
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0) config = nullptr;
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,                                           //
+        EGL_CONTEXT_MINOR_VERSION, 3,                                           //
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, //
+        EGL_NONE,                                                               //
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) throw std::runtime_error("Failed to create EGL context (EGL error " + std::to_string(eglGetError()) + ")");
+    m_context = context;
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) throw std::runtime_error("Failed to make the EGL context current");
+
+    // GLEW built for GLX reports a missing X display but still resolves every entry point
+    glewExperimental = GL_TRUE;
+    GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    if (glewStatus == GLEW_ERROR_NO_GLX_DISPLAY) glewStatus = GLEW_OK;
+#endif
+    if (glewStatus != GLEW_OK) throw std::runtime_error("Failed to initialize GLEW\n");
+
+    glGenRenderbuffers(1, &m_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error("Headless framebuffer incomplete");
+    bind();
+}
+
+void HeadlessContext::cleanup()
+{
+    if (!m_display) return;
+    if (m_context)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteRenderbuffers(1, &m_colorBuffer);
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(m_display, m_context);
+    }
+    eglTerminate(m_display);
+    m_fbo = m_colorBuffer = 0;
+    m_context = nullptr;
+    m_display = nullptr;
+}
+#else
+bool HeadlessContext::available() { return false; }
+
+void HeadlessContext::init(int, int) { throw std::runtime_error("Headless mode needs EGL, this build was configured without it"); }
+
+void HeadlessContext::cleanup() {}
+#endif
+
+void HeadlessContext::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void HeadlessContext::readPixels(std::vector<uint8_t> &out) const
+{
+    out.resize((size_t)m_width * m_height * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, out.data());
+}
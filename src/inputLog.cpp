@@ -0,0 +1,208 @@
+// inputLog.cpp
+#include "inputLog.h"
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+constexpr char kMagic[4] = {'I', 'N', 'P', 'L'};
+constexpr uint32_t kVersion = 2;
+
+struct FileHeader
+{
+    char m_magic[4];
+    uint32_t m_version;
+    InputLog::Header m_header;
+};
+
+// a record is a tag byte followed by its payload
+enum Record : uint8_t
+{
+    Run = 0,      // buttons, varint tick count
+    Checksum = 1, // u32 of the player state after the ticks so far
+    End = 2,      // varint total ticks
+};
+
+void writeVarint(std::ostream &out, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        out.put((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.put((char)value);
+}
+
+bool readVarint(const std::vector<uint8_t> &data, size_t &offset, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35 && offset < data.size(); shift += 7)
+    {
+        uint8_t byte = data[offset++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+} // namespace
+
+uint32_t InputLog::checksum(const PlayerData &data)
+{
+    const float fields[] = {data.m_position.x, data.m_position.y, data.m_velocity.x, data.m_velocity.y, data.m_angularVelocity, data.m_rotation, data.m_steer, data.m_throttle};
+    uint32_t hash = 2166136261u;
+    for (float field : fields)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &field, sizeof(bits));
+        for (int i = 0; i < 4; i++)
+        {
+            hash ^= (bits >> (i * 8)) & 0xFF;
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+InputRecorder::~InputRecorder() { stop(); }
+
+void InputRecorder::start(const std::string &path, const InputLog::Header &header)
+{
+    stop();
+    m_file.open(path, std::ios::binary);
+    if (!m_file) throw std::runtime_error("Failed to open input log for writing: " + path);
+
+    FileHeader fileHeader;
+    std::memcpy(fileHeader.m_magic, kMagic, sizeof(kMagic));
+    fileHeader.m_version = kVersion;
+    fileHeader.m_header = header;
+    m_file.write(reinterpret_cast<const char *>(&fileHeader), sizeof(fileHeader));
+
+    m_path = path;
+    m_checksumInterval = header.m_checksumInterval > 0 ? header.m_checksumInterval : InputLog::kChecksumInterval;
+    m_ticks = 0;
+    m_runLength = 0;
+}
+
+void InputRecorder::record(const InputState &input, const PlayerData &state)
+{
+    if (!isRecording()) return;
+
+    uint8_t buttons = input.m_buttons & InputLog::kRecordedButtons;
+    if (m_runLength > 0 && buttons != m_runButtons) flushRun();
+    m_runButtons = buttons;
+    m_runLength++;
+    m_ticks++;
+    // a longer log would not load again
+    if (m_ticks == InputLog::kMaxTicks)
+    {
+        std::cerr << "Input log reached " << InputLog::kMaxTicks << " ticks, recording stopped\n";
+        stop();
+        return;
+    }
+
+    if (m_ticks % m_checksumInterval == 0)
+    {
+        // the run so far belongs before the checkpoint
+        flushRun();
+        uint32_t sum = InputLog::checksum(state);
+        m_file.put((char)Checksum);
+        m_file.write(reinterpret_cast<const char *>(&sum), sizeof(sum));
+    }
+}
+
+void InputRecorder::flushRun()
+{
+    if (m_runLength == 0) return;
+    m_file.put((char)Run);
+    m_file.put((char)m_runButtons);
+    writeVarint(m_file, m_runLength);
+    m_runLength = 0;
+}
+
+void InputRecorder::stop()
+{
+    if (!isRecording()) return;
+    flushRun();
+    m_file.put((char)End);
+    writeVarint(m_file, m_ticks);
+    m_file.close();
+    if (!m_file) std::cerr << "Failed to write input log: " << m_path << "\n";
+    else std::cout << "Recorded " << m_ticks << " ticks to " << m_path << "\n";
+}
+
+void InputReplay::load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Failed to open input log: " + path);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    FileHeader fileHeader;
+    if (data.size() < sizeof(fileHeader)) throw std::runtime_error("Input log is too short: " + path);
+    std::memcpy(&fileHeader, data.data(), sizeof(fileHeader));
+    if (std::memcmp(fileHeader.m_magic, kMagic, sizeof(kMagic)) != 0 || fileHeader.m_version != kVersion) throw std::runtime_error("Not an input log, or a different version: " + path);
+
+    std::vector<uint8_t> buttons;
+    std::vector<Checkpoint> checkpoints;
+    bool ended = false;
+    size_t offset = sizeof(fileHeader);
+    while (offset < data.size() && !ended)
+    {
+        uint8_t tag = data[offset++];
+        uint32_t value = 0;
+        if (tag == Run && offset < data.size())
+        {
+            uint8_t runButtons = data[offset++];
+            if (!readVarint(data, offset, value)) break;
+            // checked before the run is expanded, the End count comes too late for that
+            if (value > InputLog::kMaxTicks - buttons.size()) throw std::runtime_error("Input log is corrupt: " + path);
+            buttons.insert(buttons.end(), value, runButtons);
+        }
+        else if (tag == Checksum && offset + sizeof(uint32_t) <= data.size())
+        {
+            std::memcpy(&value, data.data() + offset, sizeof(value));
+            offset += sizeof(value);
+            checkpoints.push_back({(uint32_t)buttons.size(), value});
+        }
+        else if (tag == End && readVarint(data, offset, value))
+        {
+            if (value != buttons.size()) throw std::runtime_error("Input log is corrupt: " + path);
+            ended = true;
+        }
+        else throw std::runtime_error("Input log is corrupt: " + path);
+    }
+    // a recording cut short by a crash still replays up to where it stopped
+    if (!ended) std::cerr << "Input log " << path << " is truncated, replaying " << buttons.size() << " ticks\n";
+
+    m_header = fileHeader.m_header;
+    m_buttons.swap(buttons);
+    m_checkpoints.swap(checkpoints);
+    m_nextCheckpoint = 0;
+    m_tick = 0;
+    m_matched = 0;
+    m_divergedTick = -1;
+}
+
+InputState InputReplay::next() const
+{
+    InputState input;
+    if (isPlaying()) input.m_buttons = m_buttons[m_tick];
+    return input;
+}
+
+void InputReplay::verify(const PlayerData &state)
+{
+    m_tick++;
+    if (m_nextCheckpoint >= m_checkpoints.size() || m_checkpoints[m_nextCheckpoint].m_tick != m_tick) return;
+
+    const Checkpoint &checkpoint = m_checkpoints[m_nextCheckpoint++];
+    if (InputLog::checksum(state) == checkpoint.m_checksum) m_matched++;
+    else if (!hasDiverged())
+    {
+        // somewhere since the previous checkpoint
+        m_divergedTick = m_tick;
+        uint32_t lastGood = m_nextCheckpoint > 1 ? m_checkpoints[m_nextCheckpoint - 2].m_tick : 0;
+        std::cerr << "Replay diverged between ticks " << lastGood << " and " << m_tick << " (checksum " << InputLog::checksum(state) << ", recorded " << checkpoint.m_checksum << ")\n";
+    }
+}
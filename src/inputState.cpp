@@ -0,0 +1,17 @@
+// inputState.cpp
+#include "inputState.h"
+
+InputState InputState::fromWindow(GLFWwindow *window)
+{
+    InputState state;
+    auto key = [window](int code) { return glfwGetKey(window, code) == GLFW_PRESS; };
+    state.set(Throttle, key(GLFW_KEY_W));
+    state.set(Brake, key(GLFW_KEY_S));
+    state.set(SteerLeft, key(GLFW_KEY_A));
+    state.set(SteerRight, key(GLFW_KEY_D));
+    state.set(ZoomIn, key(GLFW_KEY_Z));
+    state.set(ZoomOut, key(GLFW_KEY_X));
+    state.set(TogglePanel, key(GLFW_KEY_TAB));
+    state.set(CaptureTrace, key(GLFW_KEY_F9));
+    return state;
+}
@@ -0,0 +1,178 @@
+// jobSystem.cpp
+#include "jobSystem.h"
+#include "profiler.h"
+#include <algorithm>
+
+namespace
+{
+// which deque the calling thread owns; threads we didn't spawn count as the main thread
+thread_local const JobSystem *t_system = nullptr;
+thread_local int t_index = 0;
+} // namespace
+
+JobSystem::~JobSystem() { shutdown(); }
+
+void JobSystem::init(int workerCount)
+{
+    if (workerCount <= 0) workerCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+
+    m_quit = false;
+    for (int i = 0; i <= workerCount; i++)
+        m_workers.push_back(std::make_unique<Worker>());
+    for (int i = 1; i <= workerCount; i++)
+        m_threads.emplace_back(&JobSystem::workerLoop, this, i);
+    m_frameStart = std::chrono::steady_clock::now();
+}
+
+void JobSystem::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (auto &thread : m_threads)
+        thread.join();
+    m_threads.clear();
+    m_workers.clear();
+}
+
+int JobSystem::currentIndex() const { return t_system == this ? t_index : 0; }
+
+void JobSystem::run(const Job &job)
+{
+    // no workers (not initialised): run inline
+    if (m_workers.empty())
+    {
+        job.m_function(job.m_context, job.m_begin, job.m_end);
+        return;
+    }
+
+    if (job.m_counter) job.m_counter->m_pending++;
+    int index = currentIndex();
+    Worker &worker = *m_workers[index];
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(worker.m_mutex);
+        if (worker.m_back - worker.m_front < kRingSize)
+        {
+            worker.m_jobs[worker.m_back++ & (kRingSize - 1)] = job;
+            queued = true;
+        }
+    }
+    if (!queued)
+    {
+        execute(index, job);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queued++;
+    }
+    m_wake.notify_one();
+}
+
+bool JobSystem::pop(int index, Job &out)
+{
+    // newest first, its data is most likely still in cache
+    Worker &worker = *m_workers[index];
+    std::lock_guard<std::mutex> lock(worker.m_mutex);
+    if (worker.m_front == worker.m_back) return false;
+    out = worker.m_jobs[--worker.m_back & (kRingSize - 1)];
+    return true;
+}
+
+bool JobSystem::steal(int thief, Job &out)
+{
+    int count = (int)m_workers.size();
+    for (int offset = 1; offset < count; offset++)
+    {
+        Worker &victim = *m_workers[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.m_mutex);
+        if (victim.m_front == victim.m_back) continue;
+        // oldest first, usually the biggest piece of work left
+        out = victim.m_jobs[victim.m_front++ & (kRingSize - 1)];
+        m_workers[thief]->m_stealCount++;
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::execute(int index, const Job &job)
+{
+    auto start = std::chrono::steady_clock::now();
+    job.m_function(job.m_context, job.m_begin, job.m_end);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    if (job.m_counter) job.m_counter->m_pending--;
+
+    Worker &worker = *m_workers[index];
+    worker.m_busyNs += (uint64_t)ns;
+    worker.m_jobCount++;
+}
+
+bool JobSystem::tryRunOne(int index)
+{
+    Job job;
+    if (!pop(index, job) && !steal(index, job)) return false;
+    m_queued--;
+    execute(index, job);
+    return true;
+}
+
+void JobSystem::workerLoop(int index)
+{
+    t_system = this;
+    t_index = index;
+    Profiler::setThreadName("job worker " + std::to_string(index));
+    while (!m_quit)
+    {
+        if (tryRunOne(index)) continue;
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this] { return m_quit || m_queued > 0; });
+    }
+}
+
+void JobSystem::wait(Counter &counter)
+{
+    int index = currentIndex();
+    while (counter.m_pending > 0)
+    {
+        if (!tryRunOne(index)) std::this_thread::yield();
+    }
+}
+
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain, JobFunction function, void *context)
+{
+    if (begin >= end) return;
+    grain = std::max<size_t>(grain, 1);
+    if (m_workers.empty() || end - begin <= grain)
+    {
+        function(context, begin, end);
+        return;
+    }
+
+    Counter counter;
+    for (size_t chunk = begin; chunk < end; chunk += grain)
+        run({function, context, chunk, std::min(end, chunk + grain), &counter});
+    wait(counter);
+}
+
+void JobSystem::endFrame()
+{
+    auto now = std::chrono::steady_clock::now();
+    double frameNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_frameStart).count();
+    m_frameStart = now;
+
+    for (auto &worker : m_workers)
+    {
+        uint64_t busy = worker->m_busyNs;
+        uint32_t jobs = worker->m_jobCount, steals = worker->m_stealCount;
+        worker->m_stats.m_utilization = frameNs > 0.0 ? std::min(1.0f, (float)((busy - worker->m_lastBusyNs) / frameNs)) : 0.0f;
+        worker->m_stats.m_jobs = jobs - worker->m_lastJobCount;
+        worker->m_stats.m_steals = steals - worker->m_lastStealCount;
+        worker->m_lastBusyNs = busy;
+        worker->m_lastJobCount = jobs;
+        worker->m_lastStealCount = steals;
+    }
+}
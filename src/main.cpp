@@ -1,8 +1,69 @@
 // main.cpp
 #include "game.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
 
-int main()
+namespace
 {
+void printUsage()
+{
+    std::cerr << "usage: Game [--record FILE] [--replay FILE] [--headless [--frames N] [--size WxH] [--ai N] [--dump-frames A,B,...] [--dump-dir DIR] [--trace FILE] [--fps-cap N] [--no-collisions]]\n";
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bool headless = false;
+    HeadlessOptions options;
+    std::string recordPath, replayPath;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "--headless") == 0) headless = true;
+        else if (std::strcmp(arg, "--frames") == 0 && hasValue) options.m_frames = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--ai") == 0 && hasValue) options.m_aiCars = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--dump-dir") == 0 && hasValue) options.m_dumpDir = argv[++i];
+        else if (std::strcmp(arg, "--trace") == 0 && hasValue) options.m_tracePath = argv[++i];
+        else if (std::strcmp(arg, "--fps-cap") == 0 && hasValue) options.m_fpsCap = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--no-collisions") == 0) options.m_carCollisions = false;
+        else if (std::strcmp(arg, "--record") == 0 && hasValue) recordPath = argv[++i];
+        else if (std::strcmp(arg, "--replay") == 0 && hasValue) replayPath = argv[++i];
+        else if (std::strcmp(arg, "--size") == 0 && hasValue)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &options.m_width, &options.m_height) != 2 || options.m_width <= 0 || options.m_height <= 0)
+            {
+                printUsage();
+                return 1;
+            }
+        }
+        else if (std::strcmp(arg, "--dump-frames") == 0 && hasValue)
+        {
+            std::stringstream list(argv[++i]);
+            std::string frame;
+            while (std::getline(list, frame, ','))
+                options.m_dumpFrames.push_back(std::atoi(frame.c_str()));
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
     Game game;
-    return game.run();
+    game.setInputLog(recordPath, replayPath);
+
+    try
+    {
+        return headless ? game.runHeadless(options) : game.run();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << (headless ? "Headless run failed: " : "Run failed: ") << e.what() << "\n";
+        return 1;
+    }
 }
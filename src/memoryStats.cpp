@@ -0,0 +1,49 @@
+// memoryStats.cpp
+#include "memoryStats.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_bytes{0};
+} // namespace
+
+#ifdef GAME_COUNT_ALLOCATIONS
+// nothrow new forwards here; over-aligned new has its own path and is not counted
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete[](void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+#endif
+
+bool MemoryStats::isCounting()
+{
+#ifdef GAME_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+MemoryStats::Heap MemoryStats::heap()
+{
+    Heap heap;
+    heap.m_allocations = g_allocations.load(std::memory_order_relaxed);
+    heap.m_bytes = g_bytes.load(std::memory_order_relaxed);
+    return heap;
+}
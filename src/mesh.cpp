@@ -1,46 +1,20 @@
 // mesh.cpp
 #include "mesh.h"
-#include <GL/glew.h>
 
-Mesh::Mesh(const std::vector<Vertex> &verts, const std::vector<unsigned> &idx, Texture &texture) : m_texture(texture), m_indexCount((GLsizei)idx.size()), m_vao(0), m_vbo(0), m_ebo(0)
-{
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
-
-    glGenBuffers(1, &m_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(Vertex), verts.data(), GL_STATIC_DRAW);
+Mesh::Mesh(MeshPool &pool, const std::vector<Vertex> &verts, const std::vector<unsigned> &idx, Texture &texture) : m_pool(pool), m_texture(texture), m_uvRect(0.0f, 0.0f, 1.0f, 1.0f) { upload(verts, idx); }
 
-    glGenBuffers(1, &m_ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(unsigned), idx.data(), GL_STATIC_DRAW);
+Mesh::Mesh(MeshPool &pool, const std::vector<Vertex> &verts, const std::vector<unsigned> &idx, const AtlasRegion &region) : m_pool(pool), m_texture(*region.m_page), m_uvRect(region.m_uvRect) { upload(verts, idx); }
 
-    // pos attr
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, m_relPosition));
-    // uv attr
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, m_texCoords));
-
-    glBindVertexArray(0);
-}
-
-Mesh::~Mesh()
+void Mesh::upload(const std::vector<Vertex> &verts, const std::vector<unsigned> &idx)
 {
-    glDeleteBuffers(1, &m_ebo);
-    glDeleteBuffers(1, &m_vbo);
-    glDeleteVertexArrays(1, &m_vao);
+    m_boundsMin = m_boundsMax = verts.empty() ? glm::vec2(0.0f) : verts[0].m_position;
+    for (const auto &v : verts)
+    {
+        m_boundsMin = glm::min(m_boundsMin, v.m_position);
+        m_boundsMax = glm::max(m_boundsMax, v.m_position);
+    }
+
+    m_range = m_pool.allocate(verts, idx);
 }
 
-void Mesh::Draw(GLuint shaderProgram) const
-{
-    // bind texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_texture.GetID());
-    glUniform1i(glGetUniformLocation(shaderProgram, "uTexture"), 0);
-
-    // draw
-    glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, nullptr);
-    glBindVertexArray(0);
-}
\ No newline at end of file
+Mesh::~Mesh() { m_pool.release(m_range); }
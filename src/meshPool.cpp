@@ -0,0 +1,210 @@
+// meshPool.cpp
+#include "meshPool.h"
+#include "glStateCache.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+void MeshPool::FreeList::reset(size_t capacity)
+{
+    m_free.clear();
+    m_capacity = capacity;
+    if (capacity) m_free.emplace(0, capacity);
+}
+
+void MeshPool::FreeList::grow(size_t capacity)
+{
+    if (capacity <= m_capacity) return;
+    size_t oldCapacity = m_capacity;
+    m_capacity = capacity;
+    release(oldCapacity, capacity - oldCapacity);
+}
+
+bool MeshPool::FreeList::allocate(size_t count, size_t &offset)
+{
+    if (count == 0)
+    {
+        offset = 0;
+        return true;
+    }
+    for (auto it = m_free.begin(); it != m_free.end(); ++it)
+    {
+        if (it->second < count) continue;
+        offset = it->first;
+        size_t left = it->second - count;
+        m_free.erase(it);
+        if (left) m_free.emplace(offset + count, left);
+        return true;
+    }
+    return false;
+}
+
+void MeshPool::FreeList::release(size_t offset, size_t count)
+{
+    if (count == 0) return;
+    auto next = m_free.lower_bound(offset);
+    if (next != m_free.end() && offset + count == next->first)
+    {
+        count += next->second;
+        next = m_free.erase(next);
+    }
+    if (next != m_free.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset)
+        {
+            prev->second += count;
+            return;
+        }
+    }
+    m_free.emplace(offset, count);
+}
+
+MeshPool::MeshPool(Layout layout) : m_layout(layout) {}
+
+MeshPool::~MeshPool() { cleanup(); }
+
+size_t MeshPool::getVertexSize() const { return m_layout == Layout::Packed ? 2 * sizeof(float) + 2 * sizeof(uint16_t) : sizeof(Vertex); }
+
+void MeshPool::init(size_t vertexCapacity, size_t indexCapacity)
+{
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vbo);
+    glGenBuffers(1, &m_ebo);
+    // uploads go through the copy target so they never disturb the bound VAO
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * getVertexSize(), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(Index), nullptr, GL_STATIC_DRAW);
+
+    m_vertices.reset(vertexCapacity);
+    m_indices.reset(indexCapacity);
+    m_stats = Stats();
+    m_stats.m_vertexCapacity = vertexCapacity * getVertexSize();
+    m_stats.m_indexCapacity = indexCapacity * sizeof(Index);
+    setupVao();
+}
+
+void MeshPool::cleanup()
+{
+    if (!m_vao) return;
+    GLStateCache &glState = GLStateCache::get();
+    glState.vertexArrayDeleted(m_vao);
+    glState.bufferDeleted(m_vbo);
+    glState.bufferDeleted(m_ebo);
+    glDeleteVertexArrays(1, &m_vao);
+    glDeleteBuffers(1, &m_vbo);
+    glDeleteBuffers(1, &m_ebo);
+    m_vao = m_vbo = m_ebo = 0;
+    m_vertices.reset(0);
+    m_indices.reset(0);
+}
+
+void MeshPool::setupVao()
+{
+    GLStateCache &glState = GLStateCache::get();
+    glState.bindVertexArray(m_vao);
+    glState.bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+
+    const GLsizei stride = (GLsizei)getVertexSize();
+    const void *uvOffset = (void *)(2 * sizeof(float));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, nullptr);
+    glEnableVertexAttribArray(1);
+    if (m_layout == Layout::Packed) glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, uvOffset);
+    else glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, uvOffset);
+}
+
+void MeshPool::growBuffer(GLuint &buffer, size_t usedBytes, size_t newBytes)
+{
+    GLuint bigger = 0;
+    glGenBuffers(1, &bigger);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+
+    GLStateCache::get().bufferDeleted(buffer);
+    glDeleteBuffers(1, &buffer);
+    buffer = bigger;
+    m_stats.m_grows++;
+}
+
+MeshPool::Range MeshPool::allocate(const std::vector<Vertex> &verts, const std::vector<unsigned> &idx)
+{
+    if (!m_vao) throw std::runtime_error("MeshPool used before init");
+    if (verts.size() > 0x10000) throw std::runtime_error("Mesh has more vertices than 16-bit indices can address");
+    for (unsigned index : idx)
+        if (index >= verts.size()) throw std::runtime_error("Mesh index out of range");
+    if (m_layout == Layout::Packed)
+        for (const auto &v : verts)
+            if (v.m_texCoords.x < 0.0f || v.m_texCoords.x > 1.0f || v.m_texCoords.y < 0.0f || v.m_texCoords.y > 1.0f) throw std::runtime_error("Packed meshes need uvs in [0, 1], use the Float layout");
+
+    const size_t stride = getVertexSize();
+    size_t firstVertex = 0, firstIndex = 0;
+    bool grown = false;
+    while (!m_vertices.allocate(verts.size(), firstVertex))
+    {
+        size_t capacity = m_vertices.getCapacity();
+        size_t bigger = std::max(capacity * 2, capacity + verts.size());
+        growBuffer(m_vbo, capacity * stride, bigger * stride);
+        m_vertices.grow(bigger);
+        m_stats.m_vertexCapacity = bigger * stride;
+        grown = true;
+    }
+    while (!m_indices.allocate(idx.size(), firstIndex))
+    {
+        size_t capacity = m_indices.getCapacity();
+        size_t bigger = std::max(capacity * 2, capacity + idx.size());
+        growBuffer(m_ebo, capacity * sizeof(Index), bigger * sizeof(Index));
+        m_indices.grow(bigger);
+        m_stats.m_indexCapacity = bigger * sizeof(Index);
+        grown = true;
+    }
+    // the VAO still points at the old buffers
+    if (grown) setupVao();
+
+    m_staging.resize(verts.size() * stride);
+    uint8_t *dst = m_staging.data();
+    for (const auto &v : verts)
+    {
+        std::memcpy(dst, &v.m_position, 2 * sizeof(float));
+        if (m_layout == Layout::Packed)
+        {
+            uint16_t uv[2] = {(uint16_t)(v.m_texCoords.x * 65535.0f + 0.5f), (uint16_t)(v.m_texCoords.y * 65535.0f + 0.5f)};
+            std::memcpy(dst + 2 * sizeof(float), uv, sizeof(uv));
+        }
+        else std::memcpy(dst + 2 * sizeof(float), &v.m_texCoords, 2 * sizeof(float));
+        dst += stride;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, firstVertex * stride, m_staging.size(), m_staging.data());
+
+    // relative to the base vertex, so they fit in 16 bits wherever the mesh lands
+    std::vector<Index> indices(idx.begin(), idx.end());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, firstIndex * sizeof(Index), indices.size() * sizeof(Index), indices.data());
+
+    Range range;
+    range.m_firstVertex = (uint32_t)firstVertex;
+    range.m_vertexCount = (uint32_t)verts.size();
+    range.m_firstIndex = (uint32_t)firstIndex;
+    range.m_indexCount = (uint32_t)idx.size();
+
+    m_stats.m_meshes++;
+    m_stats.m_vertexBytes += verts.size() * stride;
+    m_stats.m_indexBytes += idx.size() * sizeof(Index);
+    return range;
+}
+
+void MeshPool::release(const Range &range)
+{
+    if (!m_vao) return;
+    m_vertices.release(range.m_firstVertex, range.m_vertexCount);
+    m_indices.release(range.m_firstIndex, range.m_indexCount);
+    m_stats.m_meshes--;
+    m_stats.m_vertexBytes -= range.m_vertexCount * getVertexSize();
+    m_stats.m_indexBytes -= range.m_indexCount * sizeof(Index);
+}
@@ -0,0 +1,182 @@
+// particleSystem.cpp
+#include "particleSystem.h"
+#include "glStateCache.h"
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PARTICLE_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+struct KindParams
+{
+    float m_lifeMin, m_lifeMax; // seconds
+    float m_sizeMin, m_sizeMax; // half width in world units at birth
+    float m_spread;             // random speed added on both axes
+    float m_drag;               // share of the velocity lost per second
+};
+
+constexpr KindParams kKinds[ParticleSystem::kKindCount] = {
+    {0.8f, 1.6f, 10.0f, 18.0f, 40.0f, 1.5f}, // Smoke
+    {0.2f, 0.45f, 2.0f, 3.5f, 260.0f, 0.8f}, // Spark
+};
+
+uint32_t nextRandom(uint32_t &state)
+{
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+float randomRange(uint32_t &state, float lo, float hi) { return lo + (hi - lo) * (float)(nextRandom(state) & 0xffffff) / 16777216.0f; }
+
+#ifdef PARTICLE_X86
+// live lanes in a 4-bit compare mask
+constexpr int kBitCount[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+#endif
+} // namespace
+
+ParticleSystem::~ParticleSystem() { cleanup(); }
+
+void ParticleSystem::init(ResourceManager &resources)
+{
+    m_resources = &resources;
+    m_shader = resources.loadShader("resources/shaders/particleVertex.glsl", "resources/shaders/particleFragment.glsl");
+    m_data.assign(kFieldCount * kCapacity, 0.0f);
+    clear();
+
+    GLStateCache &glState = GLStateCache::get();
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vbo);
+    glState.bindVertexArray(m_vao);
+    glState.bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, kDrawnFields * kCapacity * sizeof(float), nullptr, GL_STREAM_DRAW);
+    // one float attribute per field, each array is one block of the buffer
+    for (GLuint location = 0; location < kDrawnFields; location++)
+    {
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void *)(location * kCapacity * sizeof(float)));
+        glVertexAttribDivisor(location, 1);
+    }
+}
+
+void ParticleSystem::cleanup()
+{
+    GLStateCache &glState = GLStateCache::get();
+    if (m_vbo)
+    {
+        glState.bufferDeleted(m_vbo);
+        glDeleteBuffers(1, &m_vbo);
+    }
+    if (m_vao)
+    {
+        glState.vertexArrayDeleted(m_vao);
+        glDeleteVertexArrays(1, &m_vao);
+    }
+    m_vbo = m_vao = 0;
+    if (m_resources && m_shader) m_resources->release(m_shader);
+    m_shader = ShaderHandle();
+    m_resources = nullptr;
+}
+
+void ParticleSystem::clear()
+{
+    // age 1 with no life left to spend stays dead
+    std::fill(field(Age), field(Age) + kCapacity, 1.0f);
+    std::fill(field(InvLife), field(InvLife) + kCapacity, 0.0f);
+    m_head = 0;
+    m_stats.m_alive = 0;
+}
+
+void ParticleSystem::emit(Kind kind, const glm::vec2 &position, const glm::vec2 &velocity, int count)
+{
+    if (m_data.empty()) return;
+    const KindParams &params = kKinds[kind];
+    for (int n = 0; n < count; n++)
+    {
+        size_t i = m_head;
+        m_head = (m_head + 1) % kCapacity;
+        if (field(Age)[i] < 1.0f) m_recycled++;
+        m_emitted++;
+
+        field(PosX)[i] = position.x;
+        field(PosY)[i] = position.y;
+        field(VelX)[i] = velocity.x + randomRange(m_random, -params.m_spread, params.m_spread);
+        field(VelY)[i] = velocity.y + randomRange(m_random, -params.m_spread, params.m_spread);
+        field(Age)[i] = 0.0f;
+        field(Size)[i] = randomRange(m_random, params.m_sizeMin, params.m_sizeMax);
+        field(Type)[i] = (float)kind;
+        field(InvLife)[i] = 1.0f / randomRange(m_random, params.m_lifeMin, params.m_lifeMax);
+        field(Drag)[i] = params.m_drag;
+    }
+}
+
+void ParticleSystem::update(float dt)
+{
+    PROFILE_SCOPE("Particles");
+    auto start = std::chrono::steady_clock::now();
+    float *posX = field(PosX), *posY = field(PosY), *velX = field(VelX), *velY = field(VelY);
+    float *age = field(Age), *invLife = field(InvLife), *drag = field(Drag);
+    size_t alive = 0;
+    if (!m_data.empty())
+    {
+#ifdef PARTICLE_X86
+        // dead slots go through the same math, they just stay at age 1
+        const __m128 vDt = _mm_set1_ps(dt), one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+        for (size_t i = 0; i < kCapacity; i += 4)
+        {
+            __m128 a = _mm_min_ps(_mm_add_ps(_mm_loadu_ps(&age[i]), _mm_mul_ps(_mm_loadu_ps(&invLife[i]), vDt)), one);
+            __m128 damping = _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(_mm_loadu_ps(&drag[i]), vDt)), zero);
+            __m128 vx = _mm_mul_ps(_mm_loadu_ps(&velX[i]), damping);
+            __m128 vy = _mm_mul_ps(_mm_loadu_ps(&velY[i]), damping);
+            _mm_storeu_ps(&age[i], a);
+            _mm_storeu_ps(&velX[i], vx);
+            _mm_storeu_ps(&velY[i], vy);
+            _mm_storeu_ps(&posX[i], _mm_add_ps(_mm_loadu_ps(&posX[i]), _mm_mul_ps(vx, vDt)));
+            _mm_storeu_ps(&posY[i], _mm_add_ps(_mm_loadu_ps(&posY[i]), _mm_mul_ps(vy, vDt)));
+            alive += kBitCount[_mm_movemask_ps(_mm_cmplt_ps(a, one))];
+        }
+#else
+        for (size_t i = 0; i < kCapacity; i++)
+        {
+            age[i] = std::min(age[i] + invLife[i] * dt, 1.0f);
+            float damping = std::max(1.0f - drag[i] * dt, 0.0f);
+            velX[i] *= damping;
+            velY[i] *= damping;
+            posX[i] += velX[i] * dt;
+            posY[i] += velY[i] * dt;
+            alive += age[i] < 1.0f ? 1 : 0;
+        }
+#endif
+    }
+    m_stats.m_alive = alive;
+    m_stats.m_emitted = m_emitted;
+    m_stats.m_recycled = m_recycled;
+    m_emitted = m_recycled = 0;
+    m_stats.m_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ParticleSystem::draw()
+{
+    if (!m_stats.m_alive || !m_resources) return;
+    const Shader *shader = m_resources->get(m_shader);
+    if (!shader) return;
+
+    GLStateCache &glState = GLStateCache::get();
+    glState.bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    // orphan the old storage so the driver doesn't stall on last frame's draw
+    glBufferData(GL_ARRAY_BUFFER, kDrawnFields * kCapacity * sizeof(float), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, kDrawnFields * kCapacity * sizeof(float), m_data.data());
+
+    // premultiplied: smoke blends over, sparks come out with alpha 0 and just add
+    glState.setBlend(true, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    shader->use();
+    glState.bindVertexArray(m_vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)kCapacity);
+}
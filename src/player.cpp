@@ -1,11 +1,13 @@
 // player.cpp
 #include "player.h"
+#include "components.h"
+#include "vehicleSystem.h"
 #include <algorithm>
 #include <vector>
 
-Player::Player() : m_carTexture(nullptr), m_carSprite(nullptr), m_camera(nullptr) {}
+Player::Player() : m_vehicles(nullptr), m_slot(0), m_world(nullptr) {}
 
-void Player::init(Renderer &renderer)
+void Player::init(Renderer &renderer, VehicleSystem &vehicles)
 {
     const float halfLen = 40.0f;
     const float halfWidth = 30.0f;
@@ -13,14 +15,14 @@ void Player::init(Renderer &renderer)
     const float tipLen = 20.0f;
 
     std::vector<Vertex> carVertices = {
-        {{-halfLen, -halfWidth, 0.0f}, {0.25f, 0.0f}},            // 0
-        {{halfLen, -halfWidth, 0.0f}, {0.75f, 0.0f}},             // 1
-        {{halfLen, halfWidth, 0.0f}, {0.75f, 1.0f}},              // 2
-        {{-halfLen, halfWidth, 0.0f}, {0.25f, 1.0f}},             // 3
-        {{-halfLen - tipLen, halfTipWidth, 0.0f}, {0.0f, 1.0f}},  // 4
-        {{-halfLen - tipLen, -halfTipWidth, 0.0f}, {0.0f, 0.0f}}, // 5
-        {{halfLen + tipLen, -halfTipWidth, 0.0f}, {1.0f, 0.0f}},  // 6
-        {{halfLen + tipLen, halfTipWidth, 0.0f}, {1.0f, 1.0f}},   // 7
+        {{-halfLen, -halfWidth}, {0.25f, 0.0f}},            // 0
+        {{halfLen, -halfWidth}, {0.75f, 0.0f}},             // 1
+        {{halfLen, halfWidth}, {0.75f, 1.0f}},              // 2
+        {{-halfLen, halfWidth}, {0.25f, 1.0f}},             // 3
+        {{-halfLen - tipLen, halfTipWidth}, {0.0f, 1.0f}},  // 4
+        {{-halfLen - tipLen, -halfTipWidth}, {0.0f, 0.0f}}, // 5
+        {{halfLen + tipLen, -halfTipWidth}, {1.0f, 0.0f}},  // 6
+        {{halfLen + tipLen, halfTipWidth}, {1.0f, 1.0f}},   // 7
     };
     std::vector<unsigned> carIndicies = {
         0, 1, 2, //
@@ -30,12 +32,9 @@ void Player::init(Renderer &renderer)
         1, 6, 7, //
         1, 7, 2, //
     };
-    m_carTexture = new Texture("resources/textures/car_tex.png");
-    Mesh *carMesh = new Mesh(carVertices, carIndicies, *m_carTexture);
-    m_carSprite = new SceneObject(*carMesh, m_data.m_position, glm::vec2(1.0f), m_data.m_rotation);
-    renderer.getScene().addObject(m_carSprite);
-
-    m_camera = &renderer.getCamera();
+    m_carRegion = renderer.getAtlas().add("resources/textures/car_tex.png");
+    ResourceManager &resources = renderer.getResources();
+    m_carMesh = resources.createMesh(carVertices, carIndicies, m_carRegion);
 
     m_constData.accelerationRate = 1000.0f;
     m_constData.angularDrag = 2.0f;
@@ -44,72 +43,62 @@ void Player::init(Renderer &renderer)
     m_constData.maxTurnRate = 100.0f;
     m_constData.turnRate = 250.0f;
     m_constData.cameraSmoothing = 10.0f;
-}
 
-void Player::handleInput(GLFWwindow *window, float deltaTime)
-{
-    int wKey = glfwGetKey(window, GLFW_KEY_W);
-    int sKey = glfwGetKey(window, GLFW_KEY_S);
-    if (!(wKey == GLFW_PRESS) && !(sKey == GLFW_PRESS)) m_data.m_throttle = 0.0f;
-    if (wKey == GLFW_PRESS) m_data.m_throttle += 1.0f * deltaTime;
-    if (sKey == GLFW_PRESS) m_data.m_throttle -= 0.5f * deltaTime;
-    if (sKey == GLFW_PRESS && wKey == GLFW_PRESS) m_data.m_throttle -= 0.5f * deltaTime;
-    m_data.m_throttle = std::clamp(m_data.m_throttle, -1.0f, 1.0f);
+    // the player is always the first car
+    m_vehicles = &vehicles;
+    m_vehicles->resize(0);
+    m_slot = m_vehicles->add(m_data);
 
-    int aKey = glfwGetKey(window, GLFW_KEY_A);
-    int dKey = glfwGetKey(window, GLFW_KEY_D);
-    if (!(aKey == GLFW_PRESS) && !(dKey == GLFW_PRESS)) m_data.m_steer = 0.0f;
-    if (aKey == GLFW_PRESS) m_data.m_steer += 3.0f * deltaTime;
-    if (dKey == GLFW_PRESS) m_data.m_steer -= 3.0f * deltaTime;
-    m_data.m_steer = std::clamp(m_data.m_steer, -1.0f, 1.0f);
+    Transform2D transform;
+    transform.m_position = m_data.m_position;
+    transform.m_rotation = m_data.m_rotation;
+    Vehicle vehicle;
+    vehicle.m_slot = (uint32_t)m_slot;
+    vehicle.m_prevPosition = vehicle.m_position = m_data.m_position;
+    vehicle.m_prevRotation = vehicle.m_rotation = m_data.m_rotation;
+    SceneManager &scene = renderer.getScene();
+    m_entity = scene.createSprite(*resources.get(m_carMesh), transform, RenderQueue::Cars, vehicle, Velocity(), VehicleControl(), CameraTarget());
+    m_world = &scene.getWorld();
 }
 
-void Player::update(float deltaTime)
+void Player::cleanup(Renderer &renderer)
 {
-    m_data.m_angularVelocity += m_data.m_steer * m_constData.turnRate * deltaTime;
-    m_data.m_angularVelocity = std::clamp(m_data.m_angularVelocity, -m_constData.maxTurnRate, m_constData.maxTurnRate);
-    if (abs(m_data.m_angularVelocity) > 10.0f)
-    {
-        m_data.m_angularVelocity /= (1.0f + m_constData.angularDrag * deltaTime);
-    }
-    else if (m_data.m_steer == 0.0f)
-    {
-        m_data.m_angularVelocity = 0.0f;
-    }
-
-    m_data.m_rotation += m_data.m_angularVelocity * deltaTime;
-    if (m_data.m_rotation > 360.0f) m_data.m_rotation -= 360.0f;
-    if (m_data.m_rotation < -360.0f) m_data.m_rotation += 360.0f;
-
-    float rot = glm::radians(m_data.m_rotation);
-    glm::vec2 forward{std::cos(rot), std::sin(rot)};
-    m_data.m_velocity += forward * (m_data.m_throttle * m_constData.accelerationRate * deltaTime);
-    float speed = glm::length(m_data.m_velocity);
-    if (speed > m_constData.maxSpeed) m_data.m_velocity -= forward * (m_data.m_throttle * m_constData.accelerationRate * deltaTime);
+    if (!m_entity) return;
+    renderer.getScene().destroy(m_entity);
+    m_entity = Entity();
+    m_world = nullptr;
+    renderer.getResources().release(m_carMesh);
+    m_carMesh = MeshHandle();
+}
 
-    if (speed > 10.0f)
-    {
-        m_data.m_velocity /= (1.0f + m_constData.linearDrag * deltaTime);
-    }
-    else if (m_data.m_throttle == 0.0f)
-    {
-        m_data.m_velocity = glm::vec2(0.0f);
-    }
-    m_data.m_position += m_data.m_velocity * deltaTime;
+void Player::handleInput(const InputState &input, float deltaTime)
+{
+    bool forward = input.down(InputState::Throttle);
+    bool backward = input.down(InputState::Brake);
+    if (!forward && !backward) m_data.m_throttle = 0.0f;
+    if (forward) m_data.m_throttle += 1.0f * deltaTime;
+    if (backward) m_data.m_throttle -= 0.5f * deltaTime;
+    if (backward && forward) m_data.m_throttle -= 0.5f * deltaTime;
+    m_data.m_throttle = std::clamp(m_data.m_throttle, -1.0f, 1.0f);
 
-    if (m_carSprite)
-    {
-        m_carSprite->setPosition(m_data.m_position);
-        m_carSprite->setRotation(m_data.m_rotation);
-    }
-    if (m_camera) updateCamera(deltaTime);
+    bool left = input.down(InputState::SteerLeft);
+    bool right = input.down(InputState::SteerRight);
+    if (!left && !right) m_data.m_steer = 0.0f;
+    if (left) m_data.m_steer += 3.0f * deltaTime;
+    if (right) m_data.m_steer -= 3.0f * deltaTime;
+    m_data.m_steer = std::clamp(m_data.m_steer, -1.0f, 1.0f);
 }
 
-void Player::updateCamera(float deltaTime)
+void Player::applyControls()
 {
-    glm::vec2 camPos = m_camera->getPos();
-    float alpha = std::clamp(m_constData.cameraSmoothing * deltaTime, 0.0f, 1.0f);
-    camPos += (m_data.m_position - camPos) * alpha;
-
-    m_camera->setPosition(camPos);
+    // every car shares the player's tuning
+    m_vehicles->m_constData = m_constData;
+    if (!m_world) return;
+    // GameSystems::pushControls hands these to the slot
+    VehicleControl &control = *m_world->get<VehicleControl>(m_entity);
+    control.m_steer = m_data.m_steer;
+    control.m_throttle = m_data.m_throttle;
+    m_world->get<CameraTarget>(m_entity)->m_smoothing = m_constData.cameraSmoothing;
 }
+
+void Player::readState() { m_vehicles->read(m_slot, m_data); }
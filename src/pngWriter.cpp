@@ -0,0 +1,94 @@
+// pngWriter.cpp
+#include "pngWriter.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+{
+    static uint32_t table[256] = {};
+    if (!table[1])
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void putBigEndian(std::vector<uint8_t> &out, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back((uint8_t)(value >> shift));
+}
+
+void writeChunk(std::ofstream &file, const char type[4], const std::vector<uint8_t> &data)
+{
+    std::vector<uint8_t> chunk;
+    putBigEndian(chunk, (uint32_t)data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    // crc covers type and data, not the length
+    putBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    file.write(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+}
+} // namespace
+
+bool Png::write(const std::string &path, int width, int height, const uint8_t *rgba, bool bottomUp)
+{
+    // every scanline gets filter type 0 (none)
+    size_t stride = (size_t)width * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((stride + 1) * height);
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *row = rgba + stride * (bottomUp ? height - 1 - y : y);
+        raw.push_back(0);
+        raw.insert(raw.end(), row, row + stride);
+    }
+
+    // zlib stream of stored blocks, at most 65535 bytes each
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    uint32_t a = 1, b = 0;
+    for (size_t offset = 0; offset < raw.size() || offset == 0; offset += 65535)
+    {
+        uint16_t size = (uint16_t)std::min<size_t>(65535, raw.size() - offset);
+        bool last = offset + size >= raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back((uint8_t)(size & 0xFF));
+        zlib.push_back((uint8_t)(size >> 8));
+        zlib.push_back((uint8_t)(~size & 0xFF));
+        zlib.push_back((uint8_t)((uint16_t)~size >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+        if (last) break;
+    }
+    for (uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    putBigEndian(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    putBigEndian(header, (uint32_t)width);
+    putBigEndian(header, (uint32_t)height);
+    header.insert(header.end(), {8, 6, 0, 0, 0}); // 8-bit RGBA, deflate, no filter, no interlace
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+    writeChunk(file, "IHDR", header);
+    writeChunk(file, "IDAT", zlib);
+    writeChunk(file, "IEND", {});
+    return (bool)file;
+}
@@ -0,0 +1,363 @@
+// profiler.cpp
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <imgui.h>
+#include <iostream>
+
+namespace
+{
+thread_local void *t_buffer = nullptr;
+
+ImU32 colorFor(const char *name)
+{
+    // stable per name, kept in the mid range so white text stays readable
+    uint32_t hash = 2166136261u;
+    for (const char *c = name; *c; c++)
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    return IM_COL32(70 + (hash & 0x7F), 70 + ((hash >> 8) & 0x7F), 70 + ((hash >> 16) & 0x7F), 255);
+}
+} // namespace
+
+Profiler::Profiler() {}
+
+Profiler &Profiler::get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+uint64_t Profiler::now()
+{
+    static const auto epoch = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+Profiler::ThreadBuffer &Profiler::threadBuffer()
+{
+    if (!t_buffer)
+    {
+        Profiler &profiler = get();
+        std::lock_guard<std::mutex> lock(profiler.m_threadsMutex);
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->m_index = (uint16_t)profiler.m_threads.size();
+        buffer->m_name = "thread " + std::to_string(buffer->m_index);
+        t_buffer = buffer.get();
+        profiler.m_threads.push_back(std::move(buffer));
+    }
+    return *static_cast<ThreadBuffer *>(t_buffer);
+}
+
+void Profiler::setThreadName(const std::string &name)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(get().m_threadsMutex);
+    buffer.m_name = name;
+}
+
+void Profiler::record(const char *name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    uint64_t head = buffer.m_head.load(std::memory_order_relaxed);
+    buffer.m_events[head & (kRingSize - 1)] = {name, start, end, buffer.m_index, buffer.m_depth};
+    buffer.m_head.store(head + 1, std::memory_order_release);
+}
+
+Profiler::Scope::Scope(const char *name) : m_name(nullptr), m_start(0)
+{
+    if (!get().m_enabled.load(std::memory_order_relaxed)) return;
+    m_name = name;
+    m_start = now();
+    threadBuffer().m_depth++;
+}
+
+Profiler::Scope::~Scope()
+{
+    if (!m_name) return;
+    threadBuffer().m_depth--;
+    get().record(m_name, m_start, now());
+}
+
+Profiler::GpuScope::GpuScope(const char *name) : m_cpu(name), m_query(get().beginGpuQuery(name)) {}
+
+Profiler::GpuScope::~GpuScope() { get().endGpuQuery(m_query); }
+
+void Profiler::initGpu()
+{
+    // timer queries are core since 3.3
+    m_gpuReady = true;
+}
+
+void Profiler::cleanupGpu()
+{
+    for (auto &gpu : m_gpuFrames)
+    {
+        if (!gpu.m_pool.empty()) glDeleteQueries((GLsizei)gpu.m_pool.size(), gpu.m_pool.data());
+        gpu = GpuFrame();
+    }
+    m_gpuReady = false;
+}
+
+int Profiler::beginGpuQuery(const char *name)
+{
+    if (!m_gpuReady || !m_inFrame || !m_enabled) return -1;
+
+    GpuFrame &gpu = m_gpuFrames[m_frameIndex % kGpuLatency];
+    size_t query = gpu.m_queries.size();
+    if (gpu.m_pool.size() < (query + 1) * 2)
+    {
+        gpu.m_pool.resize((query + 1) * 2);
+        glGenQueries(2, &gpu.m_pool[query * 2]);
+    }
+    // timestamps instead of GL_TIME_ELAPSED, elapsed queries can't nest
+    glQueryCounter(gpu.m_pool[query * 2], GL_TIMESTAMP);
+    gpu.m_queries.push_back({name, m_gpuDepth++});
+    return (int)query;
+}
+
+void Profiler::endGpuQuery(int query)
+{
+    if (query < 0) return;
+    m_gpuDepth--;
+    GpuFrame &gpu = m_gpuFrames[m_frameIndex % kGpuLatency];
+    glQueryCounter(gpu.m_pool[query * 2 + 1], GL_TIMESTAMP);
+}
+
+void Profiler::beginFrame()
+{
+    m_frameIndex++;
+    m_inFrame = true;
+    threadBuffer().m_depth++;
+
+    Frame &frame = m_frames[m_frameIndex % kFrameHistory];
+    frame.m_index = m_frameIndex;
+    frame.m_start = now();
+    frame.m_end = 0;
+    frame.m_gpuResolved = false;
+    frame.m_events.clear();
+
+    if (!m_gpuReady) return;
+
+    // this slot was last used kGpuLatency frames ago, its results should be in by now
+    GpuFrame &gpu = m_gpuFrames[m_frameIndex % kGpuLatency];
+    if (gpu.m_pending) resolveGpu(gpu);
+
+    gpu.m_frame = m_frameIndex;
+    gpu.m_queries.clear();
+    gpu.m_pending = true;
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpu.m_clockOffset = (int64_t)now() - (int64_t)gpuNow;
+}
+
+void Profiler::endFrame()
+{
+    if (!m_inFrame) return;
+    m_inFrame = false;
+
+    Frame &frame = m_frames[m_frameIndex % kFrameHistory];
+    frame.m_end = now();
+    threadBuffer().m_depth--;
+    if (m_enabled) record("Frame", frame.m_start, frame.m_end);
+
+    {
+        // everything any thread finished since the last drain belongs to this frame
+        std::lock_guard<std::mutex> lock(m_threadsMutex);
+        for (auto &buffer : m_threads)
+        {
+            uint64_t head = buffer->m_head.load(std::memory_order_acquire);
+            if (head - buffer->m_tail > kRingSize)
+            {
+                m_lostEvents += head - buffer->m_tail - kRingSize;
+                buffer->m_tail = head - kRingSize;
+            }
+            for (; buffer->m_tail < head; buffer->m_tail++)
+                frame.m_events.push_back(buffer->m_events[buffer->m_tail & (kRingSize - 1)]);
+        }
+    }
+
+    m_frameMs[m_plotHead] = (float)((frame.m_end - frame.m_start) / 1e6);
+    m_plotHead = (m_plotHead + 1) % kPlotFrames;
+
+    if (!m_gpuReady) frameResolved(frame);
+}
+
+void Profiler::resolveGpu(GpuFrame &gpu)
+{
+    gpu.m_pending = false;
+    Frame &frame = m_frames[gpu.m_frame % kFrameHistory];
+    if (frame.m_index != gpu.m_frame) return;
+
+    size_t count = gpu.m_queries.size();
+    GLint available = GL_TRUE;
+    if (count > 0) glGetQueryObjectiv(gpu.m_pool[count * 2 - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+    {
+        // the GPU is more than kGpuLatency frames behind, drop rather than stall
+        m_gpuDropped++;
+    }
+    else
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(gpu.m_pool[i * 2], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(gpu.m_pool[i * 2 + 1], GL_QUERY_RESULT, &end);
+            frame.m_events.push_back({gpu.m_queries[i].m_name, (uint64_t)((int64_t)begin + gpu.m_clockOffset), (uint64_t)((int64_t)end + gpu.m_clockOffset), kGpuThread, gpu.m_queries[i].m_depth});
+        }
+    }
+    frame.m_gpuResolved = true;
+    frameResolved(frame);
+}
+
+void Profiler::frameResolved(Frame &frame)
+{
+    if (!m_frozen)
+    {
+        m_display = frame;
+        if (m_freezeOnHitch && (frame.m_end - frame.m_start) / 1e6 > m_hitchMs) m_frozen = true;
+    }
+
+    if (m_captureRemaining > 0 && frame.m_index >= m_captureFirst)
+    {
+        m_captureEvents.insert(m_captureEvents.end(), frame.m_events.begin(), frame.m_events.end());
+        if (--m_captureRemaining == 0) writeTrace();
+    }
+}
+
+void Profiler::captureTrace(int frames, const std::string &path)
+{
+    if (frames <= 0 || m_captureRemaining > 0) return;
+    m_captureRemaining = frames;
+    m_captureFirst = m_frameIndex + 1;
+    m_capturePath = path;
+    m_captureEvents.clear();
+}
+
+void Profiler::flush()
+{
+    if (m_gpuReady)
+    {
+        // only at shutdown or the end of a benchmark, stalling is fine here
+        glFinish();
+        std::vector<GpuFrame *> pending;
+        for (auto &gpu : m_gpuFrames)
+            if (gpu.m_pending && !(m_inFrame && gpu.m_frame == m_frameIndex)) pending.push_back(&gpu);
+        std::sort(pending.begin(), pending.end(), [](const GpuFrame *a, const GpuFrame *b) { return a->m_frame < b->m_frame; });
+        for (auto *gpu : pending)
+            resolveGpu(*gpu);
+    }
+    if (m_captureRemaining > 0)
+    {
+        m_captureRemaining = 0;
+        writeTrace();
+    }
+}
+
+void Profiler::writeTrace() const
+{
+    std::ofstream file(m_capturePath);
+    if (!file)
+    {
+        std::cerr << "Failed to write trace: " << m_capturePath << "\n";
+        return;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    {
+        std::lock_guard<std::mutex> lock(m_threadsMutex);
+        for (const auto &buffer : m_threads)
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->m_index << ",\"args\":{\"name\":\"" << buffer->m_name << "\"}},\n";
+    }
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << kGpuThread << ",\"args\":{\"name\":\"GPU\"}}";
+
+    char line[256];
+    for (const auto &event : m_captureEvents)
+    {
+        // trace_event wants microseconds
+        std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.m_name, (unsigned)event.m_thread, event.m_start / 1000.0, (event.m_end - event.m_start) / 1000.0);
+        file << line;
+    }
+    file << "\n]}\n";
+    std::cout << "Wrote " << m_captureEvents.size() << " profiler events to " << m_capturePath << "\n";
+}
+
+void Profiler::drawPanel(bool *open)
+{
+    if (!ImGui::Begin("Profiler", open))
+    {
+        ImGui::End();
+        return;
+    }
+
+    bool enabled = m_enabled;
+    if (ImGui::Checkbox("Enabled", &enabled)) m_enabled = enabled;
+    ImGui::SameLine();
+    ImGui::Checkbox("Freeze", &m_frozen);
+    ImGui::SameLine();
+    ImGui::Checkbox("Freeze on hitch", &m_freezeOnHitch);
+    ImGui::SliderFloat("Hitch threshold (ms)", &m_hitchMs, 5.0f, 100.0f);
+    if (ImGui::Button(isCapturing() ? "Capturing..." : "Capture trace (F9)")) captureTrace(kTraceFrames, kTracePath);
+
+    ImGui::PlotLines("Frame ms", m_frameMs, kPlotFrames, m_plotHead, nullptr, 0.0f, 50.0f, ImVec2(0.0f, 60.0f));
+    const Frame &frame = m_display;
+    ImGui::Text("Frame %llu: %.2f ms, %zu events (lost %llu, GPU frames dropped %llu)", (unsigned long long)frame.m_index, (frame.m_end - frame.m_start) / 1e6, frame.m_events.size(), (unsigned long long)m_lostEvents, (unsigned long long)m_gpuDropped);
+    if (frame.m_events.empty())
+    {
+        ImGui::End();
+        return;
+    }
+
+    // one lane per thread, GPU last, stacked by depth
+    std::vector<uint16_t> lanes;
+    uint64_t begin = frame.m_start, end = frame.m_end;
+    for (const auto &event : frame.m_events)
+    {
+        if (std::find(lanes.begin(), lanes.end(), event.m_thread) == lanes.end()) lanes.push_back(event.m_thread);
+        begin = std::min(begin, event.m_start);
+        end = std::max(end, event.m_end);
+    }
+    std::sort(lanes.begin(), lanes.end());
+
+    const float labelWidth = 90.0f, rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    ImDrawList *draw = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = std::max(100.0f, ImGui::GetContentRegionAvail().x - labelWidth);
+    double scale = width / (double)std::max<uint64_t>(1, end - begin);
+
+    float y = origin.y;
+    for (uint16_t lane : lanes)
+    {
+        int depth = 0;
+        for (const auto &event : frame.m_events)
+            if (event.m_thread == lane) depth = std::max(depth, (int)event.m_depth + 1);
+
+        std::string name = "GPU";
+        if (lane != kGpuThread)
+        {
+            std::lock_guard<std::mutex> lock(m_threadsMutex);
+            if (lane < m_threads.size()) name = m_threads[lane]->m_name;
+        }
+        draw->AddText(ImVec2(origin.x, y + 2.0f), IM_COL32(200, 200, 200, 255), name.c_str());
+
+        ImVec2 clipMin(origin.x + labelWidth, y), clipMax(origin.x + labelWidth + width, y + depth * rowHeight);
+        draw->PushClipRect(clipMin, clipMax, true);
+        for (const auto &event : frame.m_events)
+        {
+            if (event.m_thread != lane) continue;
+            float x0 = clipMin.x + (float)((event.m_start - begin) * scale);
+            float x1 = std::max(x0 + 1.0f, clipMin.x + (float)((event.m_end - begin) * scale));
+            float y0 = y + event.m_depth * rowHeight;
+            ImVec2 min(x0, y0), max(x1, y0 + rowHeight - 1.0f);
+            draw->AddRectFilled(min, max, colorFor(event.m_name), 2.0f);
+            if (x1 - x0 > 40.0f) draw->AddText(ImVec2(x0 + 3.0f, y0 + 2.0f), IM_COL32(255, 255, 255, 255), event.m_name);
+            if (ImGui::IsMouseHoveringRect(min, max)) ImGui::SetTooltip("%s: %.3f ms", event.m_name, (event.m_end - event.m_start) / 1e6);
+        }
+        draw->PopClipRect();
+        y += std::max(1, depth) * rowHeight + 4.0f;
+    }
+    ImGui::Dummy(ImVec2(labelWidth + width, y - origin.y));
+    ImGui::End();
+}
@@ -0,0 +1,214 @@
+// renderQueue.cpp
+#include "renderQueue.h"
+#include "glStateCache.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+namespace
+{
+// ids are recycled between frames once a table gets this full
+constexpr size_t kMaxIds = 0xFFFF;
+constexpr size_t kIdHeadroom = 4096;
+// the sort key has 8 bits for the program and programs are never recycled
+constexpr size_t kMaxPrograms = 256;
+} // namespace
+
+RenderQueue::~RenderQueue() { cleanup(); }
+
+void RenderQueue::init()
+{
+    glGenBuffers(1, &m_instanceVbo);
+    m_capacity = 0;
+}
+
+void RenderQueue::cleanup()
+{
+    if (m_instanceVbo)
+    {
+        GLStateCache::get().bufferDeleted(m_instanceVbo);
+        glDeleteBuffers(1, &m_instanceVbo);
+    }
+    m_instanceVbo = 0;
+    m_capacity = 0;
+}
+
+void RenderQueue::setProgram(GLuint program)
+{
+    auto it = std::find(m_programs.begin(), m_programs.end(), program);
+    if (it == m_programs.end())
+    {
+        if (m_programs.size() >= kMaxPrograms) throw std::runtime_error("Render queue out of program ids");
+        it = m_programs.insert(m_programs.end(), program);
+    }
+    m_program = (uint8_t)(it - m_programs.begin());
+}
+
+uint16_t RenderQueue::textureId(GLuint texture)
+{
+    auto it = m_textureIds.find(texture);
+    if (it != m_textureIds.end()) return it->second;
+    uint16_t id = (uint16_t)m_textures.size();
+    m_textures.push_back(texture);
+    m_textureIds.emplace(texture, id);
+    return id;
+}
+
+uint16_t RenderQueue::meshId(const Mesh &mesh)
+{
+    // meshes share their pool's VAO, the index range tells them apart
+    uint64_t key = ((uint64_t)mesh.getVao() << 32) | mesh.getRange().m_firstIndex;
+    auto it = m_meshIds.find(key);
+    if (it == m_meshIds.end())
+    {
+        it = m_meshIds.emplace(key, (uint16_t)m_meshes.size()).first;
+        m_meshes.push_back({mesh.getVao(), {}});
+    }
+    // a released range can come back for a different mesh
+    m_meshes[it->second].m_range = mesh.getRange();
+    return it->second;
+}
+
+void RenderQueue::submit(const Mesh &mesh, const SpriteInstance &instance, uint8_t layer, uint16_t depth)
+{
+    uint64_t key = (uint64_t)layer << kLayerShift | (uint64_t)m_program << kProgramShift | (uint64_t)textureId(mesh.getTexture().GetID()) << kTextureShift | (uint64_t)meshId(mesh) << kMeshShift | depth;
+    m_commands.push_back({key, (uint32_t)m_instances.size()});
+    m_instances.push_back(instance);
+}
+
+void RenderQueue::sortCommands()
+{
+    size_t count = m_commands.size();
+    if (count < 2) return;
+
+    // LSD radix sort, a byte per pass; stable, so equal keys keep submit order
+    uint32_t histograms[8][256] = {};
+    for (const auto &command : m_commands)
+        for (int pass = 0; pass < 8; pass++)
+            histograms[pass][(command.m_key >> (pass * 8)) & 0xFF]++;
+
+    FrameVector<Command> scratch(count);
+    Command *src = m_commands.data(), *dst = scratch.data();
+    for (int pass = 0; pass < 8; pass++)
+    {
+        int shift = pass * 8;
+        uint32_t *histogram = histograms[pass];
+        // a byte every key shares can't change the order, most of them do
+        if (histogram[(src[0].m_key >> shift) & 0xFF] == count) continue;
+
+        uint32_t offset = 0;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            uint32_t n = histogram[digit];
+            histogram[digit] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; i++)
+            dst[histogram[(src[i].m_key >> shift) & 0xFF]++] = src[i];
+        std::swap(src, dst);
+    }
+    if (src != m_commands.data()) m_commands.swap(scratch);
+}
+
+void RenderQueue::bindInstanceAttributes(size_t firstInstance) const
+{
+    const GLsizei stride = sizeof(SpriteInstance);
+    const size_t base = firstInstance * sizeof(SpriteInstance);
+
+    GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void *)(base + offsetof(SpriteInstance, m_linear)));
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (void *)(base + offsetof(SpriteInstance, m_translation)));
+    glVertexAttribDivisor(3, 1);
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, (void *)(base + offsetof(SpriteInstance, m_uvRect)));
+    glVertexAttribDivisor(4, 1);
+}
+
+void RenderQueue::execute()
+{
+    PROFILE_SCOPE("RenderQueue execute");
+    m_stats = Stats();
+    m_stats.m_commands = (int)m_commands.size();
+    sortCommands();
+
+    // instances in draw order, so every run is a contiguous slice of one upload
+    FrameVector<SpriteInstance> staging;
+    staging.reserve(m_commands.size());
+    for (const auto &command : m_commands)
+        staging.push_back(m_instances[command.m_instance]);
+
+    if (!staging.empty())
+    {
+        GLStateCache &glState = GLStateCache::get();
+        glState.bindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+        while (m_capacity < staging.size())
+            m_capacity = m_capacity ? m_capacity * 2 : 256;
+        // orphan the old storage so the driver doesn't stall on last frame's draws
+        glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, staging.size() * sizeof(SpriteInstance), staging.data());
+
+        // changes along the sorted stream; the cache drops the ones that match what GL already has
+        GLuint boundProgram = 0, boundTexture = 0, boundVao = 0;
+        FrameVector<uint32_t> materials;
+        materials.reserve(m_commands.size());
+        size_t first = 0;
+        while (first < m_commands.size())
+        {
+            uint64_t state = m_commands[first].m_key & kStateMask;
+            size_t last = first + 1;
+            while (last < m_commands.size() && (m_commands[last].m_key & kStateMask) == state)
+                last++;
+
+            GLuint program = m_programs[(state >> kProgramShift) & 0xFF];
+            GLuint texture = m_textures[(state >> kTextureShift) & 0xFFFF];
+            const MeshEntry &mesh = m_meshes[(state >> kMeshShift) & 0xFFFF];
+            if (program != boundProgram)
+            {
+                glState.useProgram(program);
+                boundProgram = program;
+                m_stats.m_programBinds++;
+            }
+            if (texture != boundTexture)
+            {
+                glState.bindTexture(texture);
+                boundTexture = texture;
+                m_stats.m_textureBinds++;
+            }
+            if (mesh.m_vao != boundVao)
+            {
+                glState.bindVertexArray(mesh.m_vao);
+                boundVao = mesh.m_vao;
+                m_stats.m_meshBinds++;
+            }
+            // GL 3.3 has no base instance, the offset goes into the attribute pointers
+            bindInstanceAttributes(first);
+            const MeshPool::Range &range = mesh.m_range;
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)range.m_indexCount, MeshPool::kIndexType, (void *)(range.m_firstIndex * sizeof(MeshPool::Index)), (GLsizei)(last - first), (GLint)range.m_firstVertex);
+            m_stats.m_drawCalls++;
+            materials.push_back((uint32_t)(state >> kTextureShift) & 0xFFFFFF);
+
+            first = last;
+        }
+        std::sort(materials.begin(), materials.end());
+        m_stats.m_materials = (int)(std::unique(materials.begin(), materials.end()) - materials.begin());
+        m_stats.m_instances = (int)staging.size();
+    }
+
+    // next frame's lists come out of this frame's arena buffer, which outlives the next frame
+    size_t expected = m_commands.size() + m_commands.size() / 4;
+    m_commands = FrameVector<Command>();
+    m_commands.reserve(expected);
+    m_instances = FrameVector<SpriteInstance>();
+    m_instances.reserve(expected);
+    if (m_textures.size() > kMaxIds - kIdHeadroom || m_meshes.size() > kMaxIds - kIdHeadroom)
+    {
+        m_textures.clear();
+        m_textureIds.clear();
+        m_meshes.clear();
+        m_meshIds.clear();
+    }
+}
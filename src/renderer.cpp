@@ -1,8 +1,12 @@
 // renderer.cpp
 #include "renderer.h"
+#include "glStateCache.h"
+#include "profiler.h"
+#include "shaderCache.h"
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <stdexcept>
+#include <vector>
 
 Renderer::Renderer(int width, int height) : m_width(width), m_height(height), m_camera((float)width, (float)height), m_window(nullptr) {}
 
@@ -10,13 +14,25 @@ SceneManager &Renderer::getScene() { return m_scene; }
 
 Camera &Renderer::getCamera() { return m_camera; }
 
+TextureAtlas &Renderer::getAtlas() { return m_atlas; }
+
+MeshPool &Renderer::getMeshPool() { return m_meshPool; }
+
+ResourceManager &Renderer::getResources() { return m_resources; }
+
+TextureStreamer &Renderer::getStreamer() { return m_streamer; }
+
+ParticleSystem &Renderer::getParticles() { return m_particles; }
+
+SkidMarks &Renderer::getSkidMarks() { return m_skidMarks; }
+
+const RenderQueue::Stats &Renderer::getStats() const { return m_queue.getStats(); }
+
 void Renderer::onResize(int width, int height)
 {
     m_width = width;
     m_height = height;
     m_camera.setSize(width, height);
-    m_shader.use();
-    m_shader.setMat4("uProjection", m_camera.getProjectionMatrix());
 }
 
 void Renderer::init(GLFWwindow *window)
@@ -24,37 +40,89 @@ void Renderer::init(GLFWwindow *window)
     m_window = window;
     // GLEW
     glewExperimental = GL_TRUE;
-    if (glewInit() != GLEW_OK) throw std::runtime_error("GLEW init failed");
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    // build shader
-    m_shader = Shader::buildShaderProgram("resources/shaders/vertex.glsl", "resources/shaders/fragment.glsl");
-    m_shader.use();
-
-    // pass projection & view once
-    glm::mat4 proj = m_camera.getProjectionMatrix();
-    glm::mat4 view = m_camera.getViewMatrix();
-    m_shader.setMat4("uProjection", proj);
-    m_shader.setMat4("uView", view);
+    GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // headless EGL contexts have no X display, the entry points still resolve
+    if (glewStatus == GLEW_ERROR_NO_GLX_DISPLAY) glewStatus = GLEW_OK;
+#endif
+    if (glewStatus != GLEW_OK) throw std::runtime_error("GLEW init failed");
+    // camera matrices live in a UBO shared by every program
+    m_cameraBuffer.init(UniformBlock::Camera, sizeof(CameraBlock));
+
+    m_queue.init();
+    m_meshPool.init();
+    m_streamer.init();
+    m_resources.init(m_streamer, m_meshPool);
+
+    // every permutation up front, from cached binaries after the first run;
+    // next to the binary, the resources folder is replaced on every build
+    ShaderCache::get().init("shader_cache");
+    const char *vertPath = "resources/shaders/vertex.glsl", *fragPath = "resources/shaders/fragment.glsl";
+    std::vector<ShaderHandle> shaders = m_resources.loadShaders({
+        {vertPath, fragPath, {}},           // Normal
+        {vertPath, fragPath, {"OVERDRAW"}}, // Overdraw
+    });
+    for (int view = 0; view < kDebugViewCount; view++)
+    {
+        m_shaders[view] = shaders[view];
+        Shader &shader = *m_resources.get(m_shaders[view]);
+        // sampler state lives in the program, set it once
+        shader.use();
+        shader.setInt(shader.uniform("uTexture"), 0);
+    }
+
+    // fixed size from here on, whatever the session does
+    m_particles.init(m_resources);
+    m_skidMarks.init(m_resources, m_scene);
 }
 
 void Renderer::renderFrame()
 {
+    PROFILE_GPU_SCOPE("renderFrame");
+    // into the decal texture before anything samples it this frame
+    m_skidMarks.flush();
+    // ImGui leaves its own state behind, only what differs gets set again
+    GLStateCache::get().setBlend(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    m_shader.use();
-    // if camera moved/zoomed, update:
-    m_shader.setMat4("uProjection", m_camera.getProjectionMatrix());
-    m_shader.setMat4("uView", m_camera.getViewMatrix());
+    // finish decoded textures within the upload budget
+    m_streamer.update();
+    // sprites added since last frame need fresh mips
+    {
+        PROFILE_SCOPE("Atlas flush");
+        m_atlas.flush();
+    }
+
+    // once per frame for all programs
+    CameraBlock camera;
+    camera.m_view = m_camera.getViewMatrix();
+    camera.m_projection = m_camera.getProjectionMatrix();
+    m_cameraBuffer.update(&camera, sizeof(camera));
+
+    // record commands for everything visible, then sort and draw them with as few binds as possible
+    PROFILE_GPU_SCOPE("drawAll");
+    m_queue.setProgram(m_resources.get(m_shaders[m_debugView])->id());
+    m_scene.drawAll(m_queue, m_camera);
+    m_queue.execute();
+    // above everything in the queue, in one draw
+    m_particles.draw();
 
-    // draw all objects
-    m_scene.drawAll(m_shader.id());
+    // evictions are fenced behind the draws above
+    m_resources.endFrame();
 }
 
 void Renderer::cleanup()
 {
-    // shader clean
-    glDeleteProgram(m_shader.id());
+    // meshes give their ranges back to the pool, so before the pool goes
+    m_skidMarks.cleanup();
+    m_particles.cleanup();
+    for (ShaderHandle shader : m_shaders)
+        m_resources.release(shader);
+    m_resources.cleanup();
+    m_streamer.cleanup();
+    m_queue.cleanup();
+    m_meshPool.cleanup();
+    m_cameraBuffer.cleanup();
+    m_atlas.cleanup();
 }
@@ -0,0 +1,446 @@
+// resourceManager.cpp
+#include "resourceManager.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+// FNV-1a, 64-bit so distinct files practically never collide
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// false if the file can't be read
+bool hashFile(const std::string &path, uint64_t &hash)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    char buffer[64 * 1024];
+    while (file)
+    {
+        file.read(buffer, sizeof(buffer));
+        hash = hashBytes(buffer, (size_t)file.gcount(), hash);
+    }
+    return true;
+}
+
+// the same file reached through different relative paths gets one key
+std::string canonicalPath(const std::string &path)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonical.string();
+}
+} // namespace
+
+ResourceManager::~ResourceManager() { cleanup(); }
+
+void ResourceManager::init(TextureStreamer &streamer, MeshPool &meshPool)
+{
+    m_streamer = &streamer;
+    m_meshPool = &meshPool;
+    m_stats = Stats();
+}
+
+void ResourceManager::cleanup()
+{
+    // GL defers deleting objects still in use on its own, the fences only guard memory reuse
+    for (auto &retired : m_retired)
+        glDeleteSync(retired.m_fence);
+    m_retired.clear();
+    m_evicted.clear();
+    // meshes first, they reference textures
+    m_meshes = Table<Mesh>();
+    m_textures = Table<Texture>();
+    m_shaders = Table<Shader>();
+    m_streamer = nullptr;
+    m_meshPool = nullptr;
+}
+
+template <typename T> ResourceManager::Slot<T> *ResourceManager::resolve(const Table<T> &table, Handle<T> handle) const
+{
+    if (handle.m_index == 0 || handle.m_index > table.m_slots.size()) return nullptr;
+    const Slot<T> &slot = table.m_slots[handle.m_index - 1];
+    if (slot.m_generation != handle.m_generation || !slot.m_resource) return nullptr;
+    return const_cast<Slot<T> *>(&slot);
+}
+
+template <typename T> Handle<T> ResourceManager::insert(Table<T> &table, std::shared_ptr<T> resource, size_t bytes, uint64_t contentHash, const std::string &key)
+{
+    uint32_t index;
+    if (!table.m_free.empty())
+    {
+        index = table.m_free.back();
+        table.m_free.pop_back();
+    }
+    else
+    {
+        index = (uint32_t)table.m_slots.size();
+        table.m_slots.emplace_back();
+    }
+
+    Slot<T> &slot = table.m_slots[index];
+    slot.m_resource = std::move(resource);
+    slot.m_refs = 1;
+    slot.m_bytes = bytes;
+    slot.m_contentHash = contentHash;
+    slot.m_key = key;
+    slot.m_texture = TextureHandle();
+    slot.m_loading = slot.m_failed = false;
+    slot.m_waiting.clear();
+    table.m_bytes += bytes;
+    if (!key.empty()) table.m_byPath[key] = index;
+    if (contentHash) table.m_byContent[contentHash] = index;
+    m_stats.m_loads++;
+    return {index + 1, slot.m_generation};
+}
+
+template <typename T> Handle<T> ResourceManager::reuse(Table<T> &table, uint32_t index)
+{
+    Slot<T> &slot = table.m_slots[index];
+    if (slot.m_refs++ == 0) table.m_unused.erase(slot.m_lru);
+    return {index + 1, slot.m_generation};
+}
+
+template <typename T> void ResourceManager::addRef(Table<T> &table, Handle<T> handle)
+{
+    Slot<T> *slot = resolve(table, handle);
+    if (!slot) return;
+    reuse(table, handle.m_index - 1);
+}
+
+template <typename T> void ResourceManager::release(Table<T> &table, Handle<T> handle)
+{
+    Slot<T> *slot = resolve(table, handle);
+    if (!slot || slot->m_refs == 0) return;
+    // stays cached until its kind goes over budget; nobody is left to tell when it arrives
+    if (--slot->m_refs > 0) return;
+    slot->m_lru = table.m_unused.insert(table.m_unused.end(), handle.m_index - 1);
+    slot->m_waiting.clear();
+}
+
+template <typename T> void ResourceManager::evict(Table<T> &table, uint32_t index)
+{
+    Slot<T> &slot = table.m_slots[index];
+    table.m_unused.erase(slot.m_lru);
+    // content hits add extra paths for the same slot
+    for (auto it = table.m_byPath.begin(); it != table.m_byPath.end();)
+        it = it->second == index ? table.m_byPath.erase(it) : std::next(it);
+    if (slot.m_contentHash) table.m_byContent.erase(slot.m_contentHash);
+    table.m_bytes -= slot.m_bytes;
+
+    m_evicted.push_back(std::move(slot.m_resource));
+    slot.m_resource.reset();
+    slot.m_generation++;
+    slot.m_key.clear();
+    table.m_free.push_back(index);
+    m_stats.m_evictions++;
+
+    TextureHandle texture = slot.m_texture;
+    slot.m_texture = TextureHandle();
+    if (texture) release(m_textures, texture);
+}
+
+template <typename T> void ResourceManager::trim(Table<T> &table, size_t byteBudget, size_t countBudget)
+{
+    while (!table.m_unused.empty() && (table.m_bytes > byteBudget || table.m_unused.size() > countBudget))
+        evict(table, table.m_unused.front());
+}
+
+TextureHandle ResourceManager::loadTexture(const std::string &path, bool flipVertically, GLint wrap)
+{
+    // flipped or wrapped differently it is another GL texture
+    std::string options = (flipVertically ? "|flip|" : "|") + std::to_string(wrap);
+    // the time of the file the streamer will read is part of the key: tiles split again
+    // for a changed image keep their names and must not come back from the cache
+    std::error_code error;
+    auto written = std::filesystem::last_write_time(path + Cooked::kExtension, error);
+    if (error) written = std::filesystem::last_write_time(path, error);
+    std::string key = canonicalPath(path) + options + "|" + std::to_string(error ? 0 : (long long)written.time_since_epoch().count());
+    auto byPath = m_textures.m_byPath.find(key);
+    if (byPath != m_textures.m_byPath.end())
+    {
+        // a failed load is tried again once nobody holds it
+        Slot<Texture> &cached = m_textures.m_slots[byPath->second];
+        if (!cached.m_failed || cached.m_refs > 0)
+        {
+            m_stats.m_pathHits++;
+            return reuse(m_textures, byPath->second);
+        }
+        evict(m_textures, byPath->second);
+    }
+
+    // a copy under another name still loads once; the streamer prefers the cooked file, so hash that one when present
+    uint64_t contentHash = hashBytes(options.data(), options.size());
+    if (!hashFile(path + Cooked::kExtension, contentHash) && !hashFile(path, contentHash)) contentHash = 0;
+    if (contentHash)
+    {
+        auto byContent = m_textures.m_byContent.find(contentHash);
+        if (byContent != m_textures.m_byContent.end())
+        {
+            m_stats.m_contentHits++;
+            m_textures.m_byPath[key] = byContent->second;
+            return reuse(m_textures, byContent->second);
+        }
+    }
+
+    // the slot is only known after the request, the callback finds it through the box
+    auto box = std::make_shared<TextureHandle>();
+    auto texture = m_streamer->request(path, flipVertically, wrap, [this, box](bool loaded) { textureReady(*box, loaded); });
+    // size is known once uploaded, see updateTextureSizes()
+    *box = insert(m_textures, std::move(texture), 0, contentHash, key);
+    m_textures.m_slots[box->m_index - 1].m_loading = true;
+    return *box;
+}
+
+TextureHandle ResourceManager::createTexture(int width, int height, GLint wrap) { return insert(m_textures, std::make_shared<Texture>(width, height, wrap), 0, 0, std::string()); }
+
+void ResourceManager::whenReady(TextureHandle handle, TextureStreamer::ReadyCallback onReady)
+{
+    Slot<Texture> *slot = resolve(m_textures, handle);
+    if (!slot) onReady(false);
+    else if (slot->m_loading) slot->m_waiting.push_back(std::move(onReady));
+    else onReady(!slot->m_failed);
+}
+
+void ResourceManager::textureReady(TextureHandle handle, bool loaded)
+{
+    // evicted while it was loading
+    Slot<Texture> *slot = resolve(m_textures, handle);
+    if (!slot) return;
+    slot->m_loading = false;
+    slot->m_failed = !loaded;
+    // a callback may load more and move the slots around
+    std::vector<TextureStreamer::ReadyCallback> waiting;
+    waiting.swap(slot->m_waiting);
+    for (auto &onReady : waiting)
+        onReady(loaded);
+}
+
+MeshHandle ResourceManager::createMesh(const std::vector<Vertex> &verts, const std::vector<unsigned> &idx, TextureHandle texture)
+{
+    Slot<Texture> *textureSlot = resolve(m_textures, texture);
+    if (!textureSlot) throw std::runtime_error("createMesh with a stale texture handle");
+
+    uint64_t contentHash = hashBytes(&texture, sizeof(texture));
+    contentHash = hashBytes(verts.data(), verts.size() * sizeof(Vertex), contentHash);
+    contentHash = hashBytes(idx.data(), idx.size() * sizeof(unsigned), contentHash);
+    auto byContent = m_meshes.m_byContent.find(contentHash);
+    if (byContent != m_meshes.m_byContent.end())
+    {
+        m_stats.m_contentHits++;
+        return reuse(m_meshes, byContent->second);
+    }
+
+    return createMesh(std::make_unique<Mesh>(*m_meshPool, verts, idx, *textureSlot->m_resource), contentHash, texture);
+}
+
+MeshHandle ResourceManager::createMesh(const std::vector<Vertex> &verts, const std::vector<unsigned> &idx, const AtlasRegion &region)
+{
+    uint64_t contentHash = hashBytes(&region.m_page, sizeof(region.m_page));
+    contentHash = hashBytes(&region.m_uvRect, sizeof(region.m_uvRect), contentHash);
+    contentHash = hashBytes(verts.data(), verts.size() * sizeof(Vertex), contentHash);
+    contentHash = hashBytes(idx.data(), idx.size() * sizeof(unsigned), contentHash);
+    auto byContent = m_meshes.m_byContent.find(contentHash);
+    if (byContent != m_meshes.m_byContent.end())
+    {
+        m_stats.m_contentHits++;
+        return reuse(m_meshes, byContent->second);
+    }
+
+    return createMesh(std::make_unique<Mesh>(*m_meshPool, verts, idx, region), contentHash, TextureHandle());
+}
+
+MeshHandle ResourceManager::createMesh(std::unique_ptr<Mesh> mesh, uint64_t contentHash, TextureHandle texture)
+{
+    const MeshPool::Range &range = mesh->getRange();
+    size_t bytes = range.m_vertexCount * m_meshPool->getVertexSize() + range.m_indexCount * sizeof(MeshPool::Index);
+    MeshHandle handle = insert(m_meshes, std::shared_ptr<Mesh>(std::move(mesh)), bytes, contentHash, std::string());
+    if (texture)
+    {
+        addRef(m_textures, texture);
+        m_meshes.m_slots[handle.m_index - 1].m_texture = texture;
+    }
+    return handle;
+}
+
+ShaderHandle ResourceManager::loadShader(const std::string &vertPath, const std::string &fragPath, const std::vector<std::string> &defines) { return loadShaders({{vertPath, fragPath, defines}})[0]; }
+
+std::vector<ShaderHandle> ResourceManager::loadShaders(const std::vector<Shader::Variant> &variants)
+{
+    std::vector<ShaderHandle> handles(variants.size());
+    // what isn't cached is built in one batch
+    std::vector<Shader::Variant> missing;
+    std::vector<size_t> missingAt;
+    std::vector<std::string> keys(variants.size());
+    std::vector<uint64_t> contentHashes(variants.size());
+    for (size_t i = 0; i < variants.size(); i++)
+    {
+        const Shader::Variant &variant = variants[i];
+        std::string &key = keys[i];
+        key = canonicalPath(variant.m_vertPath) + "|" + canonicalPath(variant.m_fragPath);
+        for (const auto &define : variant.m_defines)
+            key += "|" + define;
+        auto byPath = m_shaders.m_byPath.find(key);
+        if (byPath != m_shaders.m_byPath.end())
+        {
+            m_stats.m_pathHits++;
+            handles[i] = reuse(m_shaders, byPath->second);
+            continue;
+        }
+
+        uint64_t &contentHash = contentHashes[i];
+        contentHash = hashBytes("shader", 6);
+        if (!hashFile(variant.m_vertPath, contentHash) || !hashFile(variant.m_fragPath, contentHash)) contentHash = 0;
+        for (const auto &define : variant.m_defines)
+            contentHash = contentHash ? hashBytes(define.c_str(), define.size() + 1, contentHash) : 0;
+        if (contentHash)
+        {
+            auto byContent = m_shaders.m_byContent.find(contentHash);
+            if (byContent != m_shaders.m_byContent.end())
+            {
+                m_stats.m_contentHits++;
+                m_shaders.m_byPath[key] = byContent->second;
+                handles[i] = reuse(m_shaders, byContent->second);
+                continue;
+            }
+        }
+        missing.push_back(variant);
+        missingAt.push_back(i);
+    }
+    if (missing.empty()) return handles;
+
+    std::vector<Shader> built = Shader::buildPrograms(missing);
+    for (size_t m = 0; m < built.size(); m++)
+    {
+        size_t i = missingAt[m];
+        // the same permutation twice in one batch shares the first
+        auto byPath = m_shaders.m_byPath.find(keys[i]);
+        if (byPath != m_shaders.m_byPath.end())
+        {
+            handles[i] = reuse(m_shaders, byPath->second);
+            continue;
+        }
+        auto byContent = contentHashes[i] ? m_shaders.m_byContent.find(contentHashes[i]) : m_shaders.m_byContent.end();
+        if (byContent != m_shaders.m_byContent.end())
+        {
+            m_shaders.m_byPath[keys[i]] = byContent->second;
+            handles[i] = reuse(m_shaders, byContent->second);
+            continue;
+        }
+        handles[i] = insert(m_shaders, std::make_shared<Shader>(std::move(built[m])), 0, contentHashes[i], keys[i]);
+    }
+    return handles;
+}
+
+void ResourceManager::addRef(TextureHandle handle) { addRef(m_textures, handle); }
+
+void ResourceManager::addRef(MeshHandle handle) { addRef(m_meshes, handle); }
+
+void ResourceManager::addRef(ShaderHandle handle) { addRef(m_shaders, handle); }
+
+void ResourceManager::release(TextureHandle handle) { release(m_textures, handle); }
+
+void ResourceManager::release(MeshHandle handle) { release(m_meshes, handle); }
+
+void ResourceManager::release(ShaderHandle handle) { release(m_shaders, handle); }
+
+Texture *ResourceManager::get(TextureHandle handle) const
+{
+    Slot<Texture> *slot = resolve(m_textures, handle);
+    return slot ? slot->m_resource.get() : nullptr;
+}
+
+const Mesh *ResourceManager::get(MeshHandle handle) const
+{
+    Slot<Mesh> *slot = resolve(m_meshes, handle);
+    return slot ? slot->m_resource.get() : nullptr;
+}
+
+Shader *ResourceManager::get(ShaderHandle handle) const
+{
+    Slot<Shader> *slot = resolve(m_shaders, handle);
+    return slot ? slot->m_resource.get() : nullptr;
+}
+
+void ResourceManager::updateTextureSizes()
+{
+    // streamed textures grow from their placeholder when the upload lands
+    m_textures.m_bytes = 0;
+    for (auto &slot : m_textures.m_slots)
+    {
+        if (!slot.m_resource) continue;
+        slot.m_bytes = (size_t)slot.m_resource->GetWidth() * slot.m_resource->GetHeight() * 4 * 4 / 3;
+        m_textures.m_bytes += slot.m_bytes;
+    }
+}
+
+void ResourceManager::trimTextures()
+{
+    while (m_textures.m_bytes > m_budget.m_textureBytes)
+    {
+        if (!m_textures.m_unused.empty())
+        {
+            evict(m_textures, m_textures.m_unused.front());
+            continue;
+        }
+        // what's left is held by unused meshes, tile quads are tiny and would never go over
+        // the mesh budget; the oldest one that holds a texture goes and lets it go
+        auto holder = std::find_if(m_meshes.m_unused.begin(), m_meshes.m_unused.end(), [this](uint32_t index) { return (bool)m_meshes.m_slots[index].m_texture; });
+        if (holder == m_meshes.m_unused.end()) break;
+        evict(m_meshes, *holder);
+    }
+}
+
+void ResourceManager::collectRetired()
+{
+    // fences signal in submission order, stop at the first one still pending
+    while (!m_retired.empty())
+    {
+        GLenum status = glClientWaitSync(m_retired.front().m_fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(m_retired.front().m_fence);
+        m_retired.pop_front();
+    }
+}
+
+void ResourceManager::endFrame()
+{
+    updateTextureSizes();
+    // meshes first, evicting one can leave its texture unused
+    trim(m_meshes, m_budget.m_meshBytes, SIZE_MAX);
+    trimTextures();
+    trim(m_shaders, SIZE_MAX, (size_t)m_budget.m_unusedShaders);
+
+    if (!m_evicted.empty())
+    {
+        // this frame's draws may still read them
+        Retired retired;
+        retired.m_resources.swap(m_evicted);
+        retired.m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_retired.push_back(std::move(retired));
+    }
+    collectRetired();
+
+    m_stats.m_textures = (int)(m_textures.m_slots.size() - m_textures.m_free.size());
+    m_stats.m_meshes = (int)(m_meshes.m_slots.size() - m_meshes.m_free.size());
+    m_stats.m_shaders = (int)(m_shaders.m_slots.size() - m_shaders.m_free.size());
+    m_stats.m_unused = (int)(m_textures.m_unused.size() + m_meshes.m_unused.size() + m_shaders.m_unused.size());
+    m_stats.m_textureBytes = m_textures.m_bytes;
+    m_stats.m_meshBytes = m_meshes.m_bytes;
+    m_stats.m_pendingDeletes = 0;
+    for (const auto &retired : m_retired)
+        m_stats.m_pendingDeletes += (int)retired.m_resources.size();
+}
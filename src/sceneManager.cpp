@@ -1,10 +1,227 @@
 // sceneManager.cpp
 #include "sceneManager.h"
+#include "frameArena.h"
+#include "jobSystem.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
-void SceneManager::addObject(SceneObject *object) { m_objects.push_back(object); }
+namespace
+{
+bool overlaps(const Bounds &bounds, const glm::vec2 &min, const glm::vec2 &max) { return bounds.m_min.x <= max.x && bounds.m_max.x >= min.x && bounds.m_min.y <= max.y && bounds.m_max.y >= min.y; }
+} // namespace
+
+SceneManager::SceneManager(float cellSize) : m_cellSize(cellSize), m_stamp(0), m_nextOrder{} {}
+
+Sprite SceneManager::makeSprite(const Mesh &mesh, uint8_t layer)
+{
+    Sprite sprite;
+    sprite.m_mesh = &mesh;
+    sprite.m_uvRect = mesh.getUVRect();
+    sprite.m_layer = layer;
+    if (layer >= RenderQueue::kLayerCount) throw std::runtime_error("Sprite layer out of range");
+    // tiles, skid mark quads and AI respawns keep taking new orders, the gaps they leave are closed up before the depth runs out
+    if (m_nextOrder[layer] >= kMaxOrder) compactOrders(layer);
+    sprite.m_order = m_nextOrder[layer]++;
+    return sprite;
+}
+
+void SceneManager::compactOrders(uint8_t layer)
+{
+    std::vector<Sprite *> sprites;
+    m_world.each<Sprite>(
+        [&](Entity, Sprite &sprite)
+        {
+            if (sprite.m_layer == layer) sprites.push_back(&sprite);
+        });
+    std::sort(sprites.begin(), sprites.end(), [](const Sprite *a, const Sprite *b) { return a->m_order < b->m_order; });
+    for (size_t i = 0; i < sprites.size(); i++)
+        sprites[i]->m_order = (uint32_t)i;
+    m_nextOrder[layer] = (uint32_t)sprites.size();
+}
+
+Entity SceneManager::createNode(const Transform2D &transform)
+{
+    Entity entity = m_world.create(TransformNode());
+    m_world.get<TransformNode>(entity)->m_node = m_transforms.create(entity, transform);
+    return entity;
+}
+
+void SceneManager::destroy(Entity entity)
+{
+    const TransformNode *node = m_world.get<TransformNode>(entity);
+    if (!node) return;
+    m_transforms.destroy(node->m_node);
+    if (const Bounds *bounds = m_world.get<Bounds>(entity)) remove(entity, *bounds);
+    m_world.destroy(entity);
+}
+
+void SceneManager::setParent(Entity child, Entity parent)
+{
+    const TransformNode *childNode = m_world.get<TransformNode>(child);
+    const TransformNode *parentNode = m_world.get<TransformNode>(parent);
+    if (childNode) m_transforms.setParent(childNode->m_node, parentNode ? parentNode->m_node : TransformStore::kNone);
+}
+
+void SceneManager::setTransform(Entity entity, const Transform2D &transform)
+{
+    if (const TransformNode *node = m_world.get<TransformNode>(entity)) m_transforms.setLocal(node->m_node, transform);
+}
+
+Transform2D SceneManager::getTransform(Entity entity) const
+{
+    const TransformNode *node = m_world.get<TransformNode>(entity);
+    return node ? m_transforms.getLocal(node->m_node) : Transform2D();
+}
+
+glm::ivec2 SceneManager::cellOf(const glm::vec2 &position) const { return glm::ivec2((int)std::floor(position.x / m_cellSize), (int)std::floor(position.y / m_cellSize)); }
 
-void SceneManager::drawAll(GLuint shaderProgram) const
+void SceneManager::computeBounds(const Affine2D &world, const Sprite &sprite, Bounds &bounds) const
 {
-    for (auto *obj : m_objects)
-        obj->draw(shaderProgram);
-}
\ No newline at end of file
+    // the local box through the world transform, as in the vertex shader
+    glm::vec2 localMin = sprite.m_mesh->getBoundsMin(), localMax = sprite.m_mesh->getBoundsMax();
+    glm::vec2 center = (localMin + localMax) * 0.5f, half = (localMax - localMin) * 0.5f;
+    glm::vec2 xAxis(world.m_linear.x, world.m_linear.y), yAxis(world.m_linear.z, world.m_linear.w);
+    glm::vec2 worldCenter = xAxis * center.x + yAxis * center.y + world.m_translation;
+    glm::vec2 worldHalf = glm::abs(xAxis) * half.x + glm::abs(yAxis) * half.y;
+    bounds.m_min = worldCenter - worldHalf;
+    bounds.m_max = worldCenter + worldHalf;
+    // most moves stay inside the same cells
+    bounds.m_moved = cellOf(bounds.m_min) != bounds.m_cellMin || cellOf(bounds.m_max) != bounds.m_cellMax;
+}
+
+void SceneManager::insert(Entity entity, Bounds &bounds)
+{
+    bounds.m_cellMin = cellOf(bounds.m_min);
+    bounds.m_cellMax = cellOf(bounds.m_max);
+    bounds.m_moved = false;
+    bounds.m_large = bounds.m_cellMax.x - bounds.m_cellMin.x >= kMaxCellSpan || bounds.m_cellMax.y - bounds.m_cellMin.y >= kMaxCellSpan;
+    if (bounds.m_large)
+    {
+        m_large.push_back(entity);
+        return;
+    }
+
+    for (int y = bounds.m_cellMin.y; y <= bounds.m_cellMax.y; y++)
+        for (int x = bounds.m_cellMin.x; x <= bounds.m_cellMax.x; x++)
+            m_cells[cellKey(x, y)].push_back(entity);
+}
+
+void SceneManager::remove(Entity entity, const Bounds &bounds)
+{
+    auto unlink = [entity](std::vector<Entity> &list)
+    {
+        auto it = std::find(list.begin(), list.end(), entity);
+        if (it == list.end()) return;
+        *it = list.back();
+        list.pop_back();
+    };
+
+    if (bounds.m_large)
+    {
+        unlink(m_large);
+        return;
+    }
+
+    for (int y = bounds.m_cellMin.y; y <= bounds.m_cellMax.y; y++)
+        for (int x = bounds.m_cellMin.x; x <= bounds.m_cellMax.x; x++)
+        {
+            auto cell = m_cells.find(cellKey(x, y));
+            if (cell == m_cells.end()) continue;
+            // empty cells are kept, cars keep driving back into them
+            unlink(cell->second);
+        }
+}
+
+void SceneManager::updateBounds(JobSystem *jobs)
+{
+    m_transforms.update(jobs);
+    PROFILE_SCOPE("Bounds");
+    // only sprites whose world transform changed; the math runs in parallel, the grid is shared and updated after
+    const std::vector<uint32_t> &updated = m_transforms.getUpdated();
+    auto compute = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            Entity entity = m_transforms.getOwner(updated[i]);
+            const Sprite *sprite = m_world.get<Sprite>(entity);
+            Bounds *bounds = m_world.get<Bounds>(entity);
+            if (sprite && bounds) computeBounds(m_transforms.getWorld(updated[i]), *sprite, *bounds);
+        }
+    };
+    if (!jobs || updated.size() <= kBoundsGrain) compute(0, updated.size());
+    else jobs->parallelFor(0, updated.size(), kBoundsGrain, compute);
+
+    for (uint32_t node : updated)
+    {
+        Entity entity = m_transforms.getOwner(node);
+        Bounds *bounds = m_world.get<Bounds>(entity);
+        if (!bounds || !bounds->m_moved) continue;
+        remove(entity, *bounds);
+        insert(entity, *bounds);
+    }
+}
+
+void SceneManager::drawAll(RenderQueue &queue, const Camera &camera)
+{
+    PROFILE_SCOPE("Cull");
+    glm::vec2 viewMin, viewMax;
+    camera.getVisibleBounds(viewMin, viewMax);
+
+    m_stats = Stats();
+    auto draw = [&](const TransformNode &node, const Sprite &sprite)
+    {
+        // the world transform is already in the instance layout
+        const Affine2D &world = m_transforms.getWorld(node.m_node);
+        SpriteInstance instance;
+        instance.m_linear = world.m_linear;
+        instance.m_translation = world.m_translation;
+        instance.m_uvRect = sprite.m_uvRect;
+        // later sprites draw on top of earlier ones with the same look; only a layer with
+        // more than kMaxOrder live sprites runs out, and the ones past it share the last depth
+        queue.submit(*sprite.m_mesh, instance, sprite.m_layer, (uint16_t)std::min(sprite.m_order, kMaxOrder));
+        m_stats.m_submitted++;
+    };
+
+    size_t sprites = m_world.count<Sprite>();
+    glm::ivec2 cellMin = cellOf(viewMin), cellMax = cellOf(viewMax);
+    size_t cellCount = (size_t)(cellMax.x - cellMin.x + 1) * (size_t)(cellMax.y - cellMin.y + 1);
+    if (cellCount > m_cells.size())
+    {
+        // zoomed far out: the view covers most of the grid, testing every sprite
+        // straight through the chunks beats hopping between cells
+        m_world.each<TransformNode, Sprite, Bounds>(
+            [&](Entity, TransformNode &node, Sprite &sprite, Bounds &bounds)
+            {
+                if (overlaps(bounds, viewMin, viewMax)) draw(node, sprite);
+            });
+    }
+    else
+    {
+        // sprites can sit in several cells, the stamp makes sure each is tested once
+        uint32_t stamp = ++m_stamp;
+        auto consider = [&](Entity entity)
+        {
+            Bounds &bounds = *m_world.get<Bounds>(entity);
+            if (bounds.m_visitStamp == stamp) return;
+            bounds.m_visitStamp = stamp;
+            if (overlaps(bounds, viewMin, viewMax)) draw(*m_world.get<TransformNode>(entity), *m_world.get<Sprite>(entity));
+        };
+
+        for (int y = cellMin.y; y <= cellMax.y; y++)
+            for (int x = cellMin.x; x <= cellMax.x; x++)
+            {
+                auto cell = m_cells.find(cellKey(x, y));
+                if (cell == m_cells.end() || cell->second.empty()) continue;
+                m_stats.m_cellsVisited++;
+                for (Entity entity : cell->second)
+                    consider(entity);
+            }
+        for (Entity entity : m_large)
+            consider(entity);
+    }
+
+    // draw order is in the sort keys, visiting order doesn't matter
+    m_stats.m_culled = (int)sprites - m_stats.m_submitted;
+}
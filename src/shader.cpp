@@ -1,5 +1,11 @@
 // shader.cpp
 #include "shader.h"
+#include "glStateCache.h"
+#include "profiler.h"
+#include "shaderCache.h"
+#include "uniformBuffer.h"
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <glm/gtc/type_ptr.hpp>
 #include <sstream>
@@ -8,6 +14,7 @@
 Shader::Shader(Shader &&other) noexcept
 {
     m_id = other.m_id;
+    m_table = std::move(other.m_table);
     other.m_id = 0;
 }
 
@@ -15,62 +22,117 @@ Shader &Shader::operator=(Shader &&other) noexcept
 {
     if (this != &other)
     {
-        if (m_id) glDeleteProgram(m_id);
+        release();
         m_id = other.m_id;
+        m_table = std::move(other.m_table);
         other.m_id = 0;
     }
     return *this;
 }
 
-Shader::~Shader()
+Shader::~Shader() { release(); }
+
+void Shader::release()
 {
-    if (m_id) glDeleteProgram(m_id);
+    if (!m_id) return;
+    GLStateCache::get().programDeleted(m_id);
+    glDeleteProgram(m_id);
+    m_id = 0;
 }
 
-Shader::Shader(GLuint programID) : m_id(programID) {}
+Shader::Shader(GLuint programID) : m_id(programID) { reflect(); }
+
+Shader Shader::buildShaderProgram(const char *vertPath, const char *fragPath) { return std::move(buildPrograms({{vertPath, fragPath, {}}})[0]); }
 
-Shader Shader::buildShaderProgram(const char *vertPath, const char *fragPath)
+std::vector<Shader> Shader::buildPrograms(const std::vector<Variant> &variants)
 {
-    // Load sources
-    std::string vertSrc = loadFile(vertPath);
-    std::string fragSrc = loadFile(fragPath);
+    PROFILE_SCOPE("Build shaders");
+    auto start = std::chrono::steady_clock::now();
+    ShaderCache &cache = ShaderCache::get();
+
+    // Load sources, the files can throw before any GL object exists
+    std::vector<std::string> vertSources, fragSources;
+    for (const auto &variant : variants)
+    {
+        vertSources.push_back(injectDefines(loadFile(variant.m_vertPath.c_str()), variant.m_defines));
+        fragSources.push_back(injectDefines(loadFile(variant.m_fragPath.c_str()), variant.m_defines));
+    }
 
-    // Compile
-    GLuint vertShader = compileShader(GL_VERTEX_SHADER, vertSrc.c_str());
-    GLuint fragShader = compileShader(GL_FRAGMENT_SHADER, fragSrc.c_str());
+    struct Pending
+    {
+        size_t m_variant;
+        uint64_t m_key;
+        GLuint m_program, m_vertShader, m_fragShader;
+    };
+    std::vector<Shader> programs(variants.size());
+    std::vector<Pending> pending;
+    size_t done = 0;
+    try
+    {
+        // Cached binaries, misses start compiling and linking right away
+        for (size_t i = 0; i < variants.size(); i++)
+        {
+            uint64_t key = cache.key(vertSources[i], fragSources[i]);
+            GLuint program = glCreateProgram();
+            if (cache.load(key, program))
+            {
+                programs[i] = Shader(program);
+                continue;
+            }
+            GLuint vertShader = compileShader(GL_VERTEX_SHADER, vertSources[i].c_str());
+            GLuint fragShader = compileShader(GL_FRAGMENT_SHADER, fragSources[i].c_str());
+            pending.push_back({i, key, program, vertShader, fragShader});
+            linkProgram(program, vertShader, fragShader, cache.isEnabled());
+        }
 
-    // Link
-    GLuint prog = linkProgram(vertShader, fragShader);
-    return Shader(prog);
+        // Wait, in order; by now the driver has had all of them at once
+        for (; done < pending.size(); done++)
+        {
+            const Pending &build = pending[done];
+            checkProgram(build.m_program, build.m_vertShader, build.m_fragShader);
+            cache.store(build.m_key, build.m_program);
+            programs[build.m_variant] = Shader(build.m_program);
+        }
+    }
+    catch (...)
+    {
+        for (size_t i = done; i < pending.size(); i++)
+        {
+            const Pending &build = pending[i];
+            glDeleteShader(build.m_vertShader);
+            glDeleteShader(build.m_fragShader);
+            glDeleteProgram(build.m_program);
+        }
+        throw;
+    }
+
+    cache.countBuild((int)variants.size(), (int)pending.size(), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return programs;
 }
 
-void Shader::use() const { glUseProgram(m_id); }
+void Shader::use() const { GLStateCache::get().useProgram(m_id); }
 
 GLuint Shader::id() const { return m_id; }
 
-void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
+Shader::UniformHandle Shader::uniform(const char *name) const
 {
-    GLint loc = glGetUniformLocation(m_id, name.c_str());
-    glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(mat));
+    const Entry *entry = findEntry(name, false);
+    return entry ? entry->m_value : kInvalidUniform;
 }
 
-void Shader::setFloat(const std::string &name, float value) const
+GLint Shader::uniformBlock(const char *name) const
 {
-    GLint loc = glGetUniformLocation(m_id, name.c_str());
-    glUniform1f(loc, value);
+    const Entry *entry = findEntry(name, true);
+    return entry ? entry->m_value : -1;
 }
 
-void Shader::setVec2(const std::string &name, const glm::vec2 &vec) const
-{
-    GLint loc = glGetUniformLocation(m_id, name.c_str());
-    glUniform2f(loc, vec.x, vec.y);
-}
+void Shader::setMat4(UniformHandle handle, const glm::mat4 &mat) const { GLStateCache::get().uniform(handle, mat); }
 
-void Shader::setInt(const std::string &name, int value) const
-{
-    GLint loc = glGetUniformLocation(m_id, name.c_str());
-    glUniform1i(loc, value);
-}
+void Shader::setFloat(UniformHandle handle, float value) const { GLStateCache::get().uniform(handle, value); }
+
+void Shader::setVec2(UniformHandle handle, const glm::vec2 &vec) const { GLStateCache::get().uniform(handle, vec); }
+
+void Shader::setInt(UniformHandle handle, int value) const { GLStateCache::get().uniform(handle, value); }
 
 // Private helpers
 GLuint Shader::compileShader(GLenum type, const char *src)
@@ -78,19 +140,6 @@ GLuint Shader::compileShader(GLenum type, const char *src)
     GLuint shader = glCreateShader(type);
     glShaderSource(shader, 1, &src, nullptr);
     glCompileShader(shader);
-
-    GLint success = 0;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        GLint len = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &len);
-        std::string log(len, ' ');
-        glGetShaderInfoLog(shader, len, nullptr, &log[0]);
-        std::string typeName = (type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT");
-        glDeleteShader(shader);
-        throw std::runtime_error("Shader compilation failed (" + typeName + "):\n" + log);
-    }
     return shader;
 }
 
@@ -103,30 +152,134 @@ std::string Shader::loadFile(const char *path)
     return ss.str();
 }
 
-GLuint Shader::linkProgram(GLuint vertShader, GLuint fragShader)
+std::string Shader::injectDefines(const std::string &source, const std::vector<std::string> &defines)
+{
+    if (defines.empty()) return source;
+    // after the #version line, which has to come first
+    size_t version = source.find("#version");
+    size_t insertAt = version == std::string::npos ? 0 : source.find('\n', version);
+    insertAt = insertAt == std::string::npos ? source.size() : insertAt + (version == std::string::npos ? 0 : 1);
+
+    std::string injected = source.substr(0, insertAt);
+    for (const auto &define : defines)
+        injected += "#define " + define + "\n";
+    // errors keep pointing at lines of the file
+    int line = 1 + (int)std::count(source.begin(), source.begin() + insertAt, '\n');
+    injected += "#line " + std::to_string(line) + "\n";
+    return injected + source.substr(insertAt);
+}
+
+void Shader::linkProgram(GLuint program, GLuint vertShader, GLuint fragShader, bool retrievable)
 {
-    GLuint program = glCreateProgram();
     glAttachShader(program, vertShader);
     glAttachShader(program, fragShader);
+    if (retrievable) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(program);
+}
 
-    GLint success = 0;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success)
+void Shader::checkProgram(GLuint program, GLuint vertShader, GLuint fragShader)
+{
+    auto infoLog = [](GLuint object, bool isShader)
     {
         GLint len = 0;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
-        std::string log(len, ' ');
-        glGetProgramInfoLog(program, len, nullptr, &log[0]);
-        glDeleteProgram(program);
-        throw std::runtime_error("Program linking failed:\n" + log);
+        if (isShader) glGetShaderiv(object, GL_INFO_LOG_LENGTH, &len);
+        else glGetProgramiv(object, GL_INFO_LOG_LENGTH, &len);
+        std::string log(std::max(len, 1), ' ');
+        if (isShader) glGetShaderInfoLog(object, len, nullptr, &log[0]);
+        else glGetProgramInfoLog(object, len, nullptr, &log[0]);
+        return log;
+    };
+
+    // compile errors are only looked at now, asking earlier would wait for each compile
+    for (GLuint shader : {vertShader, fragShader})
+    {
+        GLint success = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) throw std::runtime_error(std::string("Shader compilation failed (") + (shader == vertShader ? "VERTEX" : "FRAGMENT") + "):\n" + infoLog(shader, true));
     }
 
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) throw std::runtime_error("Program linking failed:\n" + infoLog(program, false));
+
     // Cleanup shaders
     glDetachShader(program, vertShader);
     glDetachShader(program, fragShader);
     glDeleteShader(vertShader);
     glDeleteShader(fragShader);
+}
+
+void Shader::reflect()
+{
+    m_table.clear();
+    if (!m_id) return;
+
+    GLint uniformCount = 0, blockCount = 0, maxNameLen = 0, maxBlockNameLen = 0;
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLen);
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLen);
+
+    // keep the load factor at or below 1/2
+    size_t size = 8;
+    while (size < (size_t)(uniformCount + blockCount) * 2)
+        size *= 2;
+    m_table.assign(size, Entry());
+
+    std::string name(std::max(maxNameLen, maxBlockNameLen) + 1, '\0');
+    for (GLint i = 0; i < uniformCount; i++)
+    {
+        GLsizei len = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        glGetActiveUniform(m_id, (GLuint)i, (GLsizei)name.size(), &len, &arraySize, &type, &name[0]);
+        GLint location = glGetUniformLocation(m_id, name.c_str());
+        if (location < 0) continue; // lives in a uniform block
+
+        std::string key(name.c_str(), len);
+        if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0) key.resize(key.size() - 3);
+        insertEntry({hashName(key.c_str()), location, false, key});
+    }
 
-    return program;
+    for (GLint i = 0; i < blockCount; i++)
+    {
+        GLsizei len = 0;
+        glGetActiveUniformBlockName(m_id, (GLuint)i, (GLsizei)name.size(), &len, &name[0]);
+        std::string key(name.c_str(), len);
+        insertEntry({hashName(key.c_str()), i, true, key});
+
+        for (const auto &shared : UniformBlock::kShared)
+            if (key == shared.m_name) glUniformBlockBinding(m_id, (GLuint)i, shared.m_binding);
+    }
+}
+
+uint32_t Shader::hashName(const char *name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (; *name; name++)
+        hash = (hash ^ (uint8_t)*name) * 16777619u;
+    return hash ? hash : 1; // 0 marks an empty slot
+}
+
+void Shader::insertEntry(Entry entry)
+{
+    size_t mask = m_table.size() - 1;
+    size_t slot = entry.m_hash & mask;
+    while (m_table[slot].m_hash)
+        slot = (slot + 1) & mask;
+    m_table[slot] = std::move(entry);
+}
+
+const Shader::Entry *Shader::findEntry(const char *name, bool isBlock) const
+{
+    if (m_table.empty()) return nullptr;
+    uint32_t hash = hashName(name);
+    size_t mask = m_table.size() - 1;
+    for (size_t slot = hash & mask; m_table[slot].m_hash; slot = (slot + 1) & mask)
+    {
+        const Entry &entry = m_table[slot];
+        if (entry.m_hash == hash && entry.m_isBlock == isBlock && entry.m_name == name) return &entry;
+    }
+    return nullptr;
 }
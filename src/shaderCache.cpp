@@ -0,0 +1,150 @@
+// shaderCache.cpp
+#include "shaderCache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+// FNV-1a, 64-bit
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t hashString(const char *text, uint64_t hash)
+{
+    // the terminator too, so "ab" + "c" differs from "a" + "bc"
+    return hashBytes(text ? text : "", text ? std::strlen(text) + 1 : 1, hash);
+}
+} // namespace
+
+ShaderCache &ShaderCache::get()
+{
+    static ShaderCache cache;
+    return cache;
+}
+
+void ShaderCache::init(const std::string &directory)
+{
+    m_directory = directory;
+    m_stats = Stats();
+
+    uint64_t hash = 14695981039346656037ull;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION})
+        hash = hashString(reinterpret_cast<const char *>(glGetString(name)), hash);
+    m_driverHash = hash;
+
+    GLint formats = 0;
+    if (GLEW_ARB_get_program_binary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    std::error_code error;
+    m_enabled = formats > 0 && !directory.empty() && (std::filesystem::create_directories(directory, error), !error);
+
+    // as many driver threads as it likes; links then run while we do other work
+    m_parallel = GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+    if (GLEW_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+    else if (GLEW_ARB_parallel_shader_compile) glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+}
+
+uint64_t ShaderCache::key(const std::string &vertSource, const std::string &fragSource) const
+{
+    uint64_t hash = hashBytes(vertSource.data(), vertSource.size(), m_driverHash);
+    hash = hashBytes("|", 1, hash);
+    return hashBytes(fragSource.data(), fragSource.size(), hash);
+}
+
+std::string ShaderCache::pathOf(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return m_directory + name;
+}
+
+bool ShaderCache::load(uint64_t key, GLuint program)
+{
+    if (!m_enabled) return false;
+    std::string path = pathOf(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    BinaryHeader header;
+    std::vector<char> binary;
+    bool valid = (bool)file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    valid = valid && std::memcmp(header.m_magic, kMagic, sizeof(kMagic)) == 0 && header.m_version == kVersion && header.m_key == key;
+    // the rest of the file has to be exactly the binary, before anything is sized from the header
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(path, error);
+    valid = valid && !error && fileSize - sizeof(header) == header.m_length;
+    if (valid)
+    {
+        binary.resize(header.m_length);
+        valid = (bool)file.read(binary.data(), (std::streamsize)binary.size());
+    }
+
+    GLint linked = 0;
+    if (valid)
+    {
+        glProgramBinary(program, (GLenum)header.m_format, binary.data(), (GLsizei)binary.size());
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    }
+    if (!linked)
+    {
+        // truncated, or the driver changed in a way its strings don't show
+        m_stats.m_rejected++;
+        file.close();
+        std::filesystem::remove(path, error);
+        return false;
+    }
+    m_stats.m_hits++;
+    return true;
+}
+
+void ShaderCache::store(uint64_t key, GLuint program)
+{
+    if (!m_enabled) return;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    BinaryHeader header;
+    std::memcpy(header.m_magic, kMagic, sizeof(kMagic));
+    header.m_version = kVersion;
+    header.m_key = key;
+    std::vector<char> binary((size_t)length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+    header.m_format = format;
+    header.m_length = (uint32_t)length;
+
+    // written aside and renamed, a crash never leaves half a binary under the real name
+    std::string path = pathOf(key), temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), (std::streamsize)binary.size());
+        if (!file)
+        {
+            std::cerr << "Failed to write shader binary " << temporary << "\n";
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (!error) m_stats.m_written++;
+}
+
+void ShaderCache::countBuild(int programs, int compiled, double ms)
+{
+    m_stats.m_programs += programs;
+    m_stats.m_compiled += compiled;
+    m_stats.m_buildMs += ms;
+}
@@ -0,0 +1,179 @@
+// skidMarks.cpp
+#include "skidMarks.h"
+#include "glStateCache.h"
+#include "profiler.h"
+#include "renderQueue.h"
+#include "sceneManager.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+// grey level of the rubber, the same as in skidFragment.glsl; every texel keeps it and only the alpha varies
+constexpr float kRubber = 0.06f;
+} // namespace
+
+SkidMarks::~SkidMarks() { cleanup(); }
+
+void SkidMarks::init(ResourceManager &resources, SceneManager &scene)
+{
+    m_resources = &resources;
+    m_scene = &scene;
+    m_shader = resources.loadShader("resources/shaders/skidVertex.glsl", "resources/shaders/skidFragment.glsl");
+    if (const Shader *shader = resources.get(m_shader))
+    {
+        m_areaMin = shader->uniform("uAreaMin");
+        m_areaScale = shader->uniform("uAreaScale");
+    }
+
+    // no mips, they would have to be rebuilt after every flush
+    m_texture = resources.createTexture(kResolution, kResolution);
+    Texture &texture = *resources.get(m_texture);
+    texture.Bind();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    m_stats.m_bytes = (size_t)kResolution * kResolution * 4;
+
+    glGenFramebuffers(1, &m_fbo);
+    GLint previous = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.GetID(), 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previous);
+    if (status != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error("Skid mark framebuffer incomplete");
+
+    GLStateCache &glState = GLStateCache::get();
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vbo);
+    glState.bindVertexArray(m_vao);
+    glState.bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, kMaxSegments * sizeof(Segment), nullptr, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Segment), (void *)offsetof(Segment, m_ends));
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Segment), (void *)offsetof(Segment, m_shape));
+    glVertexAttribDivisor(1, 1);
+
+    m_pending.reserve(kMaxSegments);
+}
+
+void SkidMarks::cleanup()
+{
+    if (m_scene && m_entity) m_scene->destroy(m_entity);
+    m_entity = Entity();
+    if (m_resources)
+    {
+        m_resources->release(m_mesh);
+        m_resources->release(m_texture);
+    }
+    m_mesh = MeshHandle();
+    m_texture = TextureHandle();
+    GLStateCache &glState = GLStateCache::get();
+    if (m_vbo)
+    {
+        glState.bufferDeleted(m_vbo);
+        glDeleteBuffers(1, &m_vbo);
+    }
+    if (m_vao)
+    {
+        glState.vertexArrayDeleted(m_vao);
+        glDeleteVertexArrays(1, &m_vao);
+    }
+    if (m_fbo) glDeleteFramebuffers(1, &m_fbo);
+    m_vbo = m_vao = m_fbo = 0;
+    if (m_resources && m_shader) m_resources->release(m_shader);
+    m_shader = ShaderHandle();
+    m_resources = nullptr;
+    m_scene = nullptr;
+    m_pending.clear();
+}
+
+SkidMarks::Target SkidMarks::bindTarget() const
+{
+    // the window or the headless FBO, whichever the frame is going to
+    Target target;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &target.m_framebuffer);
+    glGetIntegerv(GL_VIEWPORT, target.m_viewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, kResolution, kResolution);
+    return target;
+}
+
+void SkidMarks::Target::restore() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)m_framebuffer);
+    glViewport(m_viewport[0], m_viewport[1], m_viewport[2], m_viewport[3]);
+}
+
+void SkidMarks::setArea(const glm::vec2 &worldMin, const glm::vec2 &worldMax)
+{
+    if (!m_texture) return;
+    m_worldMin = worldMin;
+    m_worldMax = worldMax;
+    m_pending.clear();
+    m_stats.m_dropped = 0;
+
+    Target target = bindTarget();
+    glClearColor(kRubber, kRubber, kRubber, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    target.restore();
+
+    if (m_entity) m_scene->destroy(m_entity);
+    m_resources->release(m_mesh);
+    // texel rows run bottom to top like world y, no flip
+    glm::vec2 half = (worldMax - worldMin) * 0.5f;
+    std::vector<Vertex> verts = {
+        {{-half.x, -half.y}, {0.0f, 0.0f}}, //
+        {{half.x, -half.y}, {1.0f, 0.0f}},  //
+        {{half.x, half.y}, {1.0f, 1.0f}},   //
+        {{-half.x, half.y}, {0.0f, 1.0f}},  //
+    };
+    std::vector<unsigned> indices = {
+        0, 1, 2, //
+        0, 2, 3, //
+    };
+    m_mesh = m_resources->createMesh(verts, indices, m_texture);
+    Transform2D transform;
+    transform.m_position = worldMin + half;
+    m_entity = m_scene->createSprite(*m_resources->get(m_mesh), transform, RenderQueue::Decals);
+}
+
+void SkidMarks::add(const glm::vec2 &from, const glm::vec2 &to, float halfWidth, float strength)
+{
+    // the buffer never grows, a frame with more marks than this loses the rest
+    if (m_pending.size() >= kMaxSegments)
+    {
+        m_stats.m_dropped++;
+        return;
+    }
+    m_pending.push_back({glm::vec4(from, to), glm::vec2(halfWidth, std::clamp(strength, 0.0f, 1.0f))});
+}
+
+void SkidMarks::flush()
+{
+    m_stats.m_segments = m_pending.size();
+    if (m_pending.empty() || !m_texture) return;
+    Shader *shader = m_resources->get(m_shader);
+    if (!shader) return;
+    PROFILE_GPU_SCOPE("Skid marks");
+
+    GLStateCache &glState = GLStateCache::get();
+    glState.bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, kMaxSegments * sizeof(Segment), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, m_pending.size() * sizeof(Segment), m_pending.data());
+
+    Target target = bindTarget();
+    // premultiplied over a texture that is rubber-coloured everywhere: the colour stays
+    // put and the alpha accumulates, so the sprite can blend it like any other texture
+    glState.setBlend(true, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    shader->use();
+    shader->setVec2(m_areaMin, m_worldMin);
+    shader->setVec2(m_areaScale, 2.0f / (m_worldMax - m_worldMin));
+    glState.bindVertexArray(m_vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)m_pending.size());
+    target.restore();
+
+    m_pending.clear();
+}
@@ -1,12 +1,18 @@
 // texture.cpp
-#include "Texture.h"
+#include "texture.h"
+#include "glStateCache.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include <algorithm>
 #include <stdexcept>
 
 Texture::Texture(const std::string &path, bool flipVertically)
 {
-    stbi_set_flip_vertically_on_load(flipVertically);
+    // pre-decoded with precomputed mips, no stb involved
+    if (LoadCooked(path + Cooked::kExtension, flipVertically)) return;
+
+    // per thread: the global flag is ignored once a thread has set its own
+    stbi_set_flip_vertically_on_load_thread(flipVertically ? 1 : 0);
 
     unsigned char *data = stbi_load(path.c_str(), &m_width, &m_height, &m_channels, 0);
     if (!data) throw std::runtime_error("Failed to load texture: " + path);
@@ -14,7 +20,7 @@ Texture::Texture(const std::string &path, bool flipVertically)
     GLenum format = (m_channels == 4) ? GL_RGBA : GL_RGB;
 
     glGenTextures(1, &m_id);
-    glBindTexture(GL_TEXTURE_2D, m_id);
+    GLStateCache::get().bindTexture(m_id);
 
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
@@ -27,18 +33,120 @@ Texture::Texture(const std::string &path, bool flipVertically)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
     stbi_image_free(data);
-    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+Texture::Texture(int width, int height, GLint wrap) : m_width(width), m_height(height), m_channels(4)
+{
+    glGenTextures(1, &m_id);
+    GLStateCache::get().bindTexture(m_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    // atlas pages clamp so sub-rects don't sample their neighbours
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 }
 
 Texture::~Texture()
 {
-    if (m_id) glDeleteTextures(1, &m_id);
+    if (!m_id) return;
+    GLStateCache::get().textureDeleted(m_id);
+    glDeleteTextures(1, &m_id);
 }
 
 void Texture::Bind(GLuint unit) const
 {
-    glActiveTexture(GL_TEXTURE0 + unit);
-    glBindTexture(GL_TEXTURE_2D, m_id);
+    GLStateCache::get().bindTexture(m_id, unit);
+}
+
+void Texture::Unbind() { GLStateCache::get().bindTexture(0); }
+
+void Texture::Allocate(int width, int height, int levels, Cooked::Format format)
+{
+    GLenum internalFormat = CookedFormat(format);
+    m_width = width;
+    m_height = height;
+    m_channels = 4;
+    GLStateCache::get().bindTexture(m_id);
+    for (int level = 0; level < levels; level++)
+    {
+        int w = std::max(1, width >> level), h = std::max(1, height >> level);
+        if (Cooked::isCompressed(format))
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, w, h, 0, (GLsizei)Cooked::levelSize(format, w, h), nullptr);
+        else
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    // stay complete with just these levels, until GenerateMipmaps()
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+void Texture::Upload(int x, int y, int width, int height, const unsigned char *rgba, int level)
+{
+    GLStateCache::get().bindTexture(m_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+}
+
+void Texture::UploadCompressed(int x, int y, int width, int height, Cooked::Format format, GLsizei size, const void *data, int level)
+{
+    GLStateCache::get().bindTexture(m_id);
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, CookedFormat(format), size, data);
+}
+
+void Texture::GenerateMipmaps()
+{
+    GLStateCache::get().bindTexture(m_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+    glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+GLenum Texture::CookedFormat(Cooked::Format format)
+{
+    switch (format)
+    {
+    case Cooked::Format::RGBA8:
+        return GL_RGBA8;
+    case Cooked::Format::BC1:
+        return GLEW_EXT_texture_compression_s3tc ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : 0;
+    case Cooked::Format::BC3:
+        return GLEW_EXT_texture_compression_s3tc ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+    }
+    return 0;
 }
 
-void Texture::Unbind() { glBindTexture(GL_TEXTURE_2D, 0); }
+bool Texture::LoadCooked(const std::string &path, bool flipVertically)
+{
+    CookedTextureFile file;
+    if (!file.open(path)) return false;
+
+    const Cooked::Header &header = file.header();
+    GLenum internalFormat = CookedFormat(header.m_format);
+    if (!internalFormat || ((header.m_flags & Cooked::FlippedVertically) != 0) != flipVertically) return false;
+
+    m_width = (int)header.m_width;
+    m_height = (int)header.m_height;
+    m_channels = 4;
+
+    glGenTextures(1, &m_id);
+    GLStateCache::get().bindTexture(m_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // every level goes straight from the mapping to the driver
+    for (uint32_t level = 0; level < header.m_mipCount; level++)
+    {
+        const Cooked::Mip &mip = file.mip(level);
+        if (header.m_format == Cooked::Format::RGBA8)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, mip.m_width, mip.m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, file.mipData(level));
+        else
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, mip.m_width, mip.m_height, 0, (GLsizei)mip.m_size, file.mipData(level));
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.m_mipCount - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    return true;
+}
@@ -0,0 +1,168 @@
+// textureAtlas.cpp
+#include "textureAtlas.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <stdexcept>
+
+SkylinePacker::SkylinePacker(int width, int height) : m_width(width), m_height(height) { m_skyline.push_back({0, 0, width}); }
+
+int SkylinePacker::fit(size_t index, int w, int h) const
+{
+    int x = m_skyline[index].m_x;
+    if (x + w > m_width) return -1;
+
+    // the rect rests on the highest node it spans
+    int y = m_skyline[index].m_y;
+    int remaining = w;
+    while (remaining > 0)
+    {
+        y = std::max(y, m_skyline[index].m_y);
+        if (y + h > m_height) return -1;
+        remaining -= m_skyline[index].m_width;
+        index++;
+    }
+    return y;
+}
+
+void SkylinePacker::addLevel(size_t index, int x, int y, int w, int h)
+{
+    m_skyline.insert(m_skyline.begin() + index, {x, y + h, w});
+
+    // trim the nodes now covered by the new one
+    for (size_t i = index + 1; i < m_skyline.size();)
+    {
+        const Node &prev = m_skyline[i - 1];
+        Node &node = m_skyline[i];
+        if (node.m_x >= prev.m_x + prev.m_width) break;
+
+        int shrink = prev.m_x + prev.m_width - node.m_x;
+        node.m_x += shrink;
+        node.m_width -= shrink;
+        if (node.m_width > 0) break;
+        m_skyline.erase(m_skyline.begin() + i);
+    }
+
+    // merge neighbours at the same height
+    for (size_t i = 0; i + 1 < m_skyline.size();)
+    {
+        if (m_skyline[i].m_y == m_skyline[i + 1].m_y)
+        {
+            m_skyline[i].m_width += m_skyline[i + 1].m_width;
+            m_skyline.erase(m_skyline.begin() + i + 1);
+        }
+        else
+            i++;
+    }
+}
+
+bool SkylinePacker::pack(int w, int h, int &outX, int &outY)
+{
+    int bestTop = m_height + 1, bestWidth = m_width + 1;
+    size_t bestIndex = m_skyline.size();
+    for (size_t i = 0; i < m_skyline.size(); i++)
+    {
+        int y = fit(i, w, h);
+        if (y < 0) continue;
+        // lowest top edge first, then the narrowest node to keep gaps small
+        if (y + h < bestTop || (y + h == bestTop && m_skyline[i].m_width < bestWidth))
+        {
+            bestTop = y + h;
+            bestWidth = m_skyline[i].m_width;
+            bestIndex = i;
+            outX = m_skyline[i].m_x;
+            outY = y;
+        }
+    }
+    if (bestIndex == m_skyline.size()) return false;
+
+    addLevel(bestIndex, outX, outY, w, h);
+    m_usedArea += (long long)w * h;
+    return true;
+}
+
+float SkylinePacker::occupancy() const { return (float)m_usedArea / ((float)m_width * m_height); }
+
+TextureAtlas::TextureAtlas(int pageSize, int padding) : m_pageSize(pageSize), m_padding(padding) {}
+
+AtlasRegion TextureAtlas::add(const std::string &path, bool flipVertically)
+{
+    // per thread: the global flag is ignored once a thread has set its own
+    stbi_set_flip_vertically_on_load_thread(flipVertically ? 1 : 0);
+
+    int width = 0, height = 0, channels = 0;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!data) throw std::runtime_error("Failed to load texture: " + path);
+
+    AtlasRegion region;
+    try
+    {
+        region = add(data, width, height);
+    }
+    catch (...)
+    {
+        stbi_image_free(data);
+        throw;
+    }
+    stbi_image_free(data);
+    return region;
+}
+
+AtlasRegion TextureAtlas::add(const unsigned char *rgba, int width, int height)
+{
+    const int pad = m_padding;
+    const int paddedW = width + 2 * pad;
+    const int paddedH = height + 2 * pad;
+    if (paddedW > m_pageSize || paddedH > m_pageSize) throw std::runtime_error("Image too large for atlas page");
+
+    int x = 0, y = 0;
+    Page *page = nullptr;
+    for (auto &candidate : m_pages)
+    {
+        if (candidate.m_packer.pack(paddedW, paddedH, x, y))
+        {
+            page = &candidate;
+            break;
+        }
+    }
+    if (!page)
+    {
+        m_pages.push_back({std::make_unique<Texture>(m_pageSize, m_pageSize), SkylinePacker(m_pageSize, m_pageSize), false});
+        page = &m_pages.back();
+        page->m_packer.pack(paddedW, paddedH, x, y);
+    }
+
+    // extend the edge texels into the gutter so filtering and mips don't bleed
+    m_scratch.resize((size_t)paddedW * paddedH * 4);
+    for (int py = 0; py < paddedH; py++)
+    {
+        int sy = std::clamp(py - pad, 0, height - 1);
+        for (int px = 0; px < paddedW; px++)
+        {
+            int sx = std::clamp(px - pad, 0, width - 1);
+            const unsigned char *src = rgba + ((size_t)sy * width + sx) * 4;
+            unsigned char *dst = &m_scratch[((size_t)py * paddedW + px) * 4];
+            std::copy(src, src + 4, dst);
+        }
+    }
+    page->m_texture->Upload(x, y, paddedW, paddedH, m_scratch.data());
+    page->m_dirty = true;
+
+    AtlasRegion region;
+    region.m_page = page->m_texture.get();
+    region.m_width = width;
+    region.m_height = height;
+    region.m_uvRect = glm::vec4((float)(x + pad) / m_pageSize, (float)(y + pad) / m_pageSize, (float)width / m_pageSize, (float)height / m_pageSize);
+    return region;
+}
+
+void TextureAtlas::flush()
+{
+    for (auto &page : m_pages)
+    {
+        if (!page.m_dirty) continue;
+        page.m_texture->GenerateMipmaps();
+        page.m_dirty = false;
+    }
+}
+
+void TextureAtlas::cleanup() { m_pages.clear(); }
@@ -0,0 +1,268 @@
+// textureStreamer.cpp
+#include "textureStreamer.h"
+#include "glStateCache.h"
+#include "profiler.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+constexpr size_t kRingSize = 3;
+}
+
+TextureStreamer::~TextureStreamer() { cleanup(); }
+
+void TextureStreamer::init(int workerCount, size_t uploadBudget)
+{
+    m_uploadBudget = uploadBudget;
+    if (workerCount <= 0) workerCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+
+    m_quit = false;
+    for (int i = 0; i < workerCount; i++)
+        m_workers.emplace_back(&TextureStreamer::workerLoop, this);
+
+    // each PBO holds one frame's budget, three frames in flight before we'd wait
+    m_slotSize = std::max<size_t>(uploadBudget, 64 * 1024);
+    m_ring.resize(kRingSize);
+    for (auto &slot : m_ring)
+    {
+        glGenBuffers(1, &slot.m_pbo);
+        GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.m_pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, m_slotSize, nullptr, GL_STREAM_DRAW);
+        slot.m_size = m_slotSize;
+    }
+    GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+        m_jobs.clear();
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers)
+        worker.join();
+    m_workers.clear();
+
+    for (auto &image : m_decoded)
+        release(image);
+    for (auto &image : m_uploading)
+        release(image);
+    m_decoded.clear();
+    m_uploading.clear();
+    m_requested = 0;
+
+    for (auto &slot : m_ring)
+    {
+        if (slot.m_fence) glDeleteSync(slot.m_fence);
+        if (!slot.m_pbo) continue;
+        GLStateCache::get().bufferDeleted(slot.m_pbo);
+        glDeleteBuffers(1, &slot.m_pbo);
+    }
+    m_ring.clear();
+}
+
+std::shared_ptr<Texture> TextureStreamer::request(const std::string &path, bool flipVertically, GLint wrap, ReadyCallback onReady)
+{
+    auto texture = std::make_shared<Texture>(1, 1, wrap);
+    const unsigned char white[4] = {255, 255, 255, 255};
+    texture->Upload(0, 0, 1, 1, white);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back({path, flipVertically, texture, std::move(onReady)});
+    }
+    m_wake.notify_one();
+    m_requested++;
+    return texture;
+}
+
+void TextureStreamer::workerLoop()
+{
+    Profiler::setThreadName("texture decode");
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_quit || !m_jobs.empty(); });
+            if (m_quit) return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        PROFILE_SCOPE("Decode");
+        Decoded image;
+        image.m_target = job.m_target;
+        image.m_onReady = std::move(job.m_onReady);
+        image.m_path = job.m_path;
+        // nobody wants it anymore, skip the decode
+        if (!job.m_target.expired() && !loadCooked(image, job.m_flip))
+        {
+            int width = 0, height = 0, channels = 0;
+            stbi_set_flip_vertically_on_load_thread(job.m_flip);
+            image.m_pixels = stbi_load(job.m_path.c_str(), &width, &height, &channels, 4);
+            if (image.m_pixels) image.m_levels.push_back({image.m_pixels, width, height});
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_quit)
+        {
+            release(image);
+            return;
+        }
+        m_decoded.push_back(std::move(image));
+    }
+}
+
+bool TextureStreamer::loadCooked(Decoded &image, bool flip)
+{
+    auto file = std::make_unique<CookedTextureFile>();
+    if (!file->open(image.m_path + Cooked::kExtension)) return false;
+
+    const Cooked::Header &header = file->header();
+    if (!Texture::CookedFormat(header.m_format) || ((header.m_flags & Cooked::FlippedVertically) != 0) != flip) return false;
+
+    image.m_format = header.m_format;
+    for (uint32_t level = 0; level < header.m_mipCount; level++)
+        image.m_levels.push_back({file->mipData(level), (int)file->mip(level).m_width, (int)file->mip(level).m_height});
+    image.m_cooked = std::move(file);
+    return true;
+}
+
+void TextureStreamer::release(Decoded &image)
+{
+    if (image.m_pixels) stbi_image_free(image.m_pixels);
+    image.m_pixels = nullptr;
+    image.m_cooked.reset();
+    image.m_levels.clear();
+}
+
+bool TextureStreamer::uploadRows(Decoded &image, size_t budget, size_t &uploaded)
+{
+    Slot &slot = m_ring[m_nextSlot];
+    if (slot.m_fence)
+    {
+        // never block the frame on the GPU, try again next frame
+        if (glClientWaitSync(slot.m_fence, 0, 0) == GL_TIMEOUT_EXPIRED) return false;
+        glDeleteSync(slot.m_fence);
+        slot.m_fence = nullptr;
+    }
+
+    // whole pixel rows, or whole 4x4 block rows for compressed levels
+    const Level &level = image.m_levels[image.m_level];
+    const size_t pitch = Cooked::rowPitch(image.m_format, (uint32_t)level.m_width);
+    const int unitRows = (int)Cooked::rowsPerUnit(image.m_format);
+    const size_t unitsLeft = (size_t)((level.m_height - image.m_nextRow + unitRows - 1) / unitRows);
+    const size_t units = std::clamp<size_t>(std::min(budget, m_slotSize) / pitch, 1, unitsLeft);
+    const size_t bytes = units * pitch;
+    const int rows = std::min((int)units * unitRows, level.m_height - image.m_nextRow);
+
+    // plain texture uploads read client memory, so the PBO is unbound again afterwards
+    GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.m_pbo);
+    if (bytes > slot.m_size)
+    {
+        // a single row wider than the slots, grow this one now and the others when their turn comes
+        m_slotSize = std::max(m_slotSize, bytes);
+        slot.m_size = m_slotSize;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, slot.m_size, nullptr, GL_STREAM_DRAW);
+    }
+    void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!dst)
+    {
+        // nothing went to the texture, the same rows are tried again next frame
+        GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+    std::memcpy(dst, level.m_data + (size_t)(image.m_nextRow / unitRows) * pitch, bytes);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    if (auto texture = image.m_target.lock())
+    {
+        if (Cooked::isCompressed(image.m_format))
+            texture->UploadCompressed(0, image.m_nextRow, level.m_width, rows, image.m_format, (GLsizei)bytes, nullptr, (int)image.m_level);
+        else
+            texture->Upload(0, image.m_nextRow, level.m_width, rows, nullptr, (int)image.m_level);
+    }
+    GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    slot.m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_nextSlot = (m_nextSlot + 1) % m_ring.size();
+
+    image.m_nextRow += rows;
+    if (image.m_nextRow >= level.m_height)
+    {
+        image.m_level++;
+        image.m_nextRow = 0;
+    }
+    uploaded += bytes;
+    return true;
+}
+
+void TextureStreamer::update()
+{
+    PROFILE_SCOPE("Streamer upload");
+    auto start = std::chrono::steady_clock::now();
+    m_stats.m_frameBytes = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (!m_decoded.empty())
+        {
+            m_uploading.push_back(std::move(m_decoded.front()));
+            m_decoded.pop_front();
+        }
+    }
+
+    size_t uploaded = 0;
+    while (!m_uploading.empty() && uploaded < m_uploadBudget)
+    {
+        Decoded &image = m_uploading.front();
+        auto texture = image.m_target.lock();
+        if (image.m_levels.empty() || !texture)
+        {
+            // out of the queue before reporting, 'image' is gone after pop_front()
+            ReadyCallback onReady = std::move(image.m_onReady);
+            std::string path = std::move(image.m_path);
+            release(image);
+            m_uploading.pop_front();
+            m_requested--;
+            if (texture)
+            {
+                std::cerr << "Failed to stream texture: " << path << "\n";
+                if (onReady) onReady(false);
+            }
+            continue;
+        }
+
+        // first band: swap the placeholder storage for the real size
+        if (!image.m_allocated)
+        {
+            texture->Allocate(image.m_levels[0].m_width, image.m_levels[0].m_height, (int)image.m_levels.size(), image.m_format);
+            image.m_allocated = true;
+        }
+        if (!uploadRows(image, m_uploadBudget - uploaded, uploaded)) break;
+
+        if (image.m_level == image.m_levels.size())
+        {
+            // cooked files carry their own mip chain
+            if (!image.m_cooked) texture->GenerateMipmaps();
+            // out of the queue first, the callback may request more
+            ReadyCallback onReady = std::move(image.m_onReady);
+            release(image);
+            m_uploading.pop_front();
+            m_requested--;
+            m_stats.m_completed++;
+            if (onReady) onReady(true);
+        }
+    }
+
+    m_stats.m_pending = m_requested;
+    m_stats.m_frameBytes = uploaded;
+    m_stats.m_frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_stats.m_maxFrameMs = std::max(m_stats.m_maxFrameMs, m_stats.m_frameMs);
+}
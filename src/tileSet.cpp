@@ -0,0 +1,81 @@
+// tileSet.cpp
+#include "tileSet.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+std::string Tiles::directory(const std::string &imagePath) { return imagePath + kExtension; }
+
+std::string Tiles::tilePath(const std::string &imagePath, uint32_t column, uint32_t row) { return directory(imagePath) + "/" + std::to_string(column) + "_" + std::to_string(row) + ".png"; }
+
+std::string Tiles::overviewPath(const std::string &imagePath) { return directory(imagePath) + "/overview.png"; }
+
+bool Tiles::stampSource(const std::string &imagePath, uint64_t &size, int64_t &time)
+{
+    std::error_code error;
+    size = std::filesystem::file_size(imagePath, error);
+    if (error) return false;
+    time = (int64_t)std::filesystem::last_write_time(imagePath, error).time_since_epoch().count();
+    return !error;
+}
+
+bool Tiles::readManifest(const std::string &imagePath, bool flipped, Manifest &out)
+{
+    std::ifstream file(directory(imagePath) + "/manifest", std::ios::binary);
+    if (!file || !file.read(reinterpret_cast<char *>(&out), sizeof(out))) return false;
+    if (std::memcmp(out.m_magic, kMagic, sizeof(kMagic)) != 0 || out.m_version != kVersion) return false;
+    if (out.m_flipped != (flipped ? 1u : 0u) || !out.m_tileSize || !out.m_columns || !out.m_rows) return false;
+
+    uint64_t size = 0;
+    int64_t time = 0;
+    if (!stampSource(imagePath, size, time)) return false;
+    return out.m_sourceSize == size && out.m_sourceTime == time;
+}
+
+bool Tiles::writeManifest(const std::string &imagePath, const Manifest &manifest)
+{
+    std::ofstream file(directory(imagePath) + "/manifest", std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&manifest), sizeof(manifest));
+    return (bool)file;
+}
+
+void Tiles::extract(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t tileSize, uint32_t column, uint32_t row, std::vector<uint8_t> &out, uint32_t &outWidth, uint32_t &outHeight)
+{
+    uint32_t x0 = column * tileSize, y0 = row * tileSize;
+    outWidth = std::min(tileSize, width - x0);
+    outHeight = std::min(tileSize, height - y0);
+    out.resize((size_t)outWidth * outHeight * 4);
+    for (uint32_t y = 0; y < outHeight; y++)
+        std::memcpy(&out[(size_t)y * outWidth * 4], rgba + ((size_t)(y0 + y) * width + x0) * 4, (size_t)outWidth * 4);
+}
+
+void Tiles::shrink(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t tileSize, std::vector<uint8_t> &out, uint32_t &outWidth, uint32_t &outHeight)
+{
+    out.assign(rgba, rgba + (size_t)width * height * 4);
+    outWidth = width;
+    outHeight = height;
+    std::vector<uint8_t> half;
+    while (outWidth > tileSize || outHeight > tileSize)
+    {
+        // 2x2 box filter, odd edges reuse the last texel
+        uint32_t w = std::max(1u, outWidth / 2), h = std::max(1u, outHeight / 2);
+        half.resize((size_t)w * h * 4);
+        for (uint32_t y = 0; y < h; y++)
+        {
+            uint32_t sy0 = std::min(y * 2, outHeight - 1), sy1 = std::min(y * 2 + 1, outHeight - 1);
+            for (uint32_t x = 0; x < w; x++)
+            {
+                uint32_t sx0 = std::min(x * 2, outWidth - 1), sx1 = std::min(x * 2 + 1, outWidth - 1);
+                for (int c = 0; c < 4; c++)
+                {
+                    int sum = out[((size_t)sy0 * outWidth + sx0) * 4 + c] + out[((size_t)sy0 * outWidth + sx1) * 4 + c] + out[((size_t)sy1 * outWidth + sx0) * 4 + c] + out[((size_t)sy1 * outWidth + sx1) * 4 + c];
+                    half[((size_t)y * w + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+                }
+            }
+        }
+        out.swap(half);
+        outWidth = w;
+        outHeight = h;
+    }
+}
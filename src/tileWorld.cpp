@@ -0,0 +1,301 @@
+// tileWorld.cpp
+#include "tileWorld.h"
+#include "components.h"
+#include "jobSystem.h"
+#include "pngWriter.h"
+#include "profiler.h"
+#include "renderQueue.h"
+#include "sceneManager.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+void TileWorld::init(SceneManager &scene, ResourceManager &resources)
+{
+    m_scene = &scene;
+    m_resources = &resources;
+}
+
+void TileWorld::load(const std::string &imagePath, const glm::vec2 &worldMin, const glm::vec2 &worldMax, bool flipVertically, JobSystem *jobs)
+{
+    unload();
+    m_path = imagePath;
+    m_flip = flipVertically;
+    m_singleImage = false;
+
+    if (!Tiles::readManifest(imagePath, flipVertically, m_manifest))
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (!split(imagePath, flipVertically, jobs))
+        {
+            // the whole image as one tile, still streamed but nothing to prefetch
+            int width = 0, height = 0, channels = 0;
+            if (!stbi_info(imagePath.c_str(), &width, &height, &channels))
+            {
+                std::cerr << "Failed to load track image: " << imagePath << "\n";
+                return;
+            }
+            std::cerr << "Failed to split " << imagePath << " into tiles, streaming it whole\n";
+            m_singleImage = true;
+            m_manifest = {};
+            m_manifest.m_width = (uint32_t)width;
+            m_manifest.m_height = (uint32_t)height;
+            m_manifest.m_tileSize = (uint32_t)std::max(width, height);
+            m_manifest.m_columns = m_manifest.m_rows = 1;
+        }
+        m_stats.m_splitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!m_singleImage) std::cout << "Split " << imagePath << " into " << m_manifest.m_columns * m_manifest.m_rows << " tiles in " << m_stats.m_splitMs << " ms\n";
+    }
+
+    m_worldMin = worldMin;
+    m_texelSize = (worldMax - worldMin) / glm::vec2((float)m_manifest.m_width, (float)m_manifest.m_height);
+    m_tiles.resize((size_t)m_manifest.m_columns * m_manifest.m_rows);
+    const uint32_t size = m_manifest.m_tileSize;
+    for (uint32_t row = 0; row < m_manifest.m_rows; row++)
+        for (uint32_t column = 0; column < m_manifest.m_columns; column++)
+        {
+            Tile &tile = m_tiles[(size_t)row * m_manifest.m_columns + column];
+            // edge tiles stop at the image border
+            glm::vec2 texelMin((float)(column * size), (float)(row * size));
+            glm::vec2 texelMax((float)std::min(m_manifest.m_width, (column + 1) * size), (float)std::min(m_manifest.m_height, (row + 1) * size));
+            tile.m_min = worldMin + texelMin * m_texelSize;
+            tile.m_max = worldMin + texelMax * m_texelSize;
+        }
+    m_stats.m_tiles = (int)m_tiles.size();
+
+    m_overview.m_min = worldMin;
+    m_overview.m_max = worldMax;
+    // tiles hang under one node at the image corner, moving it moves the whole track
+    Transform2D origin;
+    origin.m_position = worldMin;
+    m_root = m_scene->createNode(origin);
+    if (!m_singleImage) request(kOverview);
+}
+
+bool TileWorld::split(const std::string &imagePath, bool flipVertically, JobSystem *jobs)
+{
+    PROFILE_SCOPE("Tile split");
+    Tiles::Manifest manifest = {};
+    if (!Tiles::stampSource(imagePath, manifest.m_sourceSize, manifest.m_sourceTime)) return false;
+
+    stbi_set_flip_vertically_on_load_thread(flipVertically ? 1 : 0);
+    int width = 0, height = 0, channels = 0;
+    unsigned char *rgba = stbi_load(imagePath.c_str(), &width, &height, &channels, 4);
+    stbi_set_flip_vertically_on_load_thread(0);
+    if (!rgba) return false;
+
+    // leftovers of an older split, cooked ones included, would be picked over the new tiles
+    std::error_code error;
+    std::filesystem::remove_all(Tiles::directory(imagePath), error);
+    std::filesystem::create_directories(Tiles::directory(imagePath), error);
+
+    std::memcpy(manifest.m_magic, Tiles::kMagic, sizeof(Tiles::kMagic));
+    manifest.m_version = Tiles::kVersion;
+    manifest.m_width = (uint32_t)width;
+    manifest.m_height = (uint32_t)height;
+    manifest.m_tileSize = Tiles::kDefaultTileSize;
+    manifest.m_columns = (manifest.m_width + manifest.m_tileSize - 1) / manifest.m_tileSize;
+    manifest.m_rows = (manifest.m_height + manifest.m_tileSize - 1) / manifest.m_tileSize;
+    manifest.m_flipped = flipVertically ? 1 : 0;
+
+    // uncompressed PNGs: quick to write and to decode, asset_cooker makes cooked ones
+    std::atomic<bool> written{!error};
+    auto writeTiles = [&](size_t begin, size_t end)
+    {
+        std::vector<uint8_t> pixels;
+        uint32_t tileWidth, tileHeight;
+        for (size_t i = begin; i < end && written; i++)
+        {
+            uint32_t column = (uint32_t)(i % manifest.m_columns), row = (uint32_t)(i / manifest.m_columns);
+            Tiles::extract(rgba, manifest.m_width, manifest.m_height, manifest.m_tileSize, column, row, pixels, tileWidth, tileHeight);
+            // rows are in load order, written so that loading them the same way gives them back
+            if (!Png::write(Tiles::tilePath(imagePath, column, row), (int)tileWidth, (int)tileHeight, pixels.data(), flipVertically)) written = false;
+        }
+    };
+    size_t count = (size_t)manifest.m_columns * manifest.m_rows;
+    if (jobs) jobs->parallelFor(0, count, 1, writeTiles);
+    else writeTiles(0, count);
+
+    if (written)
+    {
+        std::vector<uint8_t> pixels;
+        uint32_t overviewWidth, overviewHeight;
+        Tiles::shrink(rgba, manifest.m_width, manifest.m_height, manifest.m_tileSize, pixels, overviewWidth, overviewHeight);
+        written = Png::write(Tiles::overviewPath(imagePath), (int)overviewWidth, (int)overviewHeight, pixels.data(), flipVertically);
+    }
+    stbi_image_free(rgba);
+
+    // the manifest goes last, a split cut short is redone next time
+    if (!written || !Tiles::writeManifest(imagePath, manifest)) return false;
+    m_manifest = manifest;
+    return true;
+}
+
+void TileWorld::unload()
+{
+    for (uint32_t index = 0; index < m_tiles.size(); index++)
+        if (m_tiles[index].m_state != State::Unloaded) evict(index);
+    if (m_overview.m_state != State::Unloaded) evict(kOverview);
+    m_overview = Tile();
+    if (m_root) m_scene->destroy(m_root);
+    m_root = Entity();
+    m_tiles.clear();
+    m_loaded.clear();
+    m_path.clear();
+    m_updated = false;
+    m_stats = Stats();
+}
+
+void TileWorld::update(const Camera &camera, float frameTime)
+{
+    PROFILE_SCOPE("Tiles");
+    glm::vec2 viewMin, viewMax;
+    camera.getVisibleBounds(viewMin, viewMax);
+    glm::vec2 center = (viewMin + viewMax) * 0.5f;
+    // smoothed, one uneven frame shouldn't swing the prefetch around
+    if (m_updated && frameTime > 0.0f) m_velocity = glm::mix(m_velocity, (center - m_lastCenter) / frameTime, std::min(1.0f, frameTime * 4.0f));
+    m_lastCenter = center;
+    m_updated = true;
+    m_frame++;
+    if (m_tiles.empty()) return;
+
+    const glm::vec2 tileSize = m_texelSize * (float)m_manifest.m_tileSize;
+    const float maxLookahead = kMaxLookaheadTiles * std::max(tileSize.x, tileSize.y);
+    glm::vec2 lookahead = m_velocity * kLookaheadSeconds;
+    float distance = glm::length(lookahead);
+    if (distance > maxLookahead) lookahead *= maxLookahead / distance;
+    m_stats.m_lookahead = std::min(distance, maxLookahead);
+
+    // the view and half a tile around it, stretched towards where the camera is heading
+    glm::vec2 wantMin = (viewMin - tileSize * 0.5f + glm::min(lookahead, glm::vec2(0.0f)) - m_worldMin) / tileSize;
+    glm::vec2 wantMax = (viewMax + tileSize * 0.5f + glm::max(lookahead, glm::vec2(0.0f)) - m_worldMin) / tileSize;
+    // zoomed far out only the tiles nearest the middle fit in the cache, the overview covers the rest
+    glm::vec2 middle = (center - m_worldMin) / tileSize;
+    float reach = std::ceil(std::sqrt((float)m_cacheSize) * 0.5f);
+    wantMin = glm::max(wantMin, middle - reach);
+    wantMax = glm::min(wantMax, middle + reach);
+    const int columns = (int)m_manifest.m_columns, rows = (int)m_manifest.m_rows;
+    int column0 = std::max(0, (int)std::floor(std::max(wantMin.x, -1.0f))), column1 = std::min(columns - 1, (int)std::floor(std::min(wantMax.x, (float)columns)));
+    int row0 = std::max(0, (int)std::floor(std::max(wantMin.y, -1.0f))), row1 = std::min(rows - 1, (int)std::floor(std::min(wantMax.y, (float)rows)));
+
+    m_wanted.clear();
+    for (int row = row0; row <= row1; row++)
+        for (int column = column0; column <= column1; column++)
+            m_wanted.push_back((uint32_t)(row * columns + column));
+    // nearest first: what is on screen now before what may be soon
+    auto nearer = [&](uint32_t a, uint32_t b)
+    {
+        glm::vec2 da = (m_tiles[a].m_min + m_tiles[a].m_max) * 0.5f - center, db = (m_tiles[b].m_min + m_tiles[b].m_max) * 0.5f - center;
+        return glm::dot(da, da) < glm::dot(db, db);
+    };
+    std::sort(m_wanted.begin(), m_wanted.end(), nearer);
+    if (m_wanted.size() > (size_t)m_cacheSize) m_wanted.resize(m_cacheSize);
+
+    int requests = 0;
+    m_stats.m_waiting = 0;
+    for (uint32_t index : m_wanted)
+    {
+        Tile &wanted = m_tiles[index];
+        wanted.m_wantedFrame = m_frame;
+        if (wanted.m_state != State::Unloaded) continue;
+        if (requests++ < kMaxRequestsPerFrame) request(index);
+        else m_stats.m_waiting++;
+    }
+
+    // over the limit: drop what was wanted longest ago, never what is wanted now
+    while ((int)m_loaded.size() > m_cacheSize)
+    {
+        auto oldest = std::min_element(m_loaded.begin(), m_loaded.end(), [this](uint32_t a, uint32_t b) { return m_tiles[a].m_wantedFrame < m_tiles[b].m_wantedFrame; });
+        if (m_tiles[*oldest].m_wantedFrame == m_frame) break;
+        evict(*oldest);
+    }
+}
+
+void TileWorld::request(uint32_t index)
+{
+    Tile &wanted = tile(index);
+    std::string path = m_singleImage ? m_path : index == kOverview ? Tiles::overviewPath(m_path) : Tiles::tilePath(m_path, index % m_manifest.m_columns, index / m_manifest.m_columns);
+    wanted.m_state = State::Loading;
+    wanted.m_request = ++m_requestCount;
+    // clamped, repeating would bleed the opposite edge into the seams
+    wanted.m_texture = m_resources->loadTexture(path, m_flip, GL_CLAMP_TO_EDGE);
+    if (index != kOverview) m_loaded.push_back(index);
+    m_stats.m_loading++;
+    m_stats.m_requests++;
+    // last, a tile still cached in the manager arrives right here
+    m_resources->whenReady(wanted.m_texture, [this, index, request = wanted.m_request](bool loaded) { ready(index, request, loaded); });
+}
+
+void TileWorld::ready(uint32_t index, uint32_t request, bool loaded)
+{
+    // evicted since, maybe wanted again already
+    if (index != kOverview && index >= m_tiles.size()) return;
+    Tile &arrived = tile(index);
+    if (arrived.m_state != State::Loading || arrived.m_request != request) return;
+    m_stats.m_loading--;
+    if (!loaded)
+    {
+        // not retried until the track is loaded again
+        arrived.m_state = State::Failed;
+        m_resources->release(arrived.m_texture);
+        arrived.m_texture = TextureHandle();
+        m_loaded.erase(std::remove(m_loaded.begin(), m_loaded.end(), index), m_loaded.end());
+        return;
+    }
+
+    // centred on the tile, its transform places it
+    glm::vec2 half = (arrived.m_max - arrived.m_min) * 0.5f;
+    std::vector<Vertex> verts = {
+        {{-half.x, -half.y}, {0.0f, 0.0f}}, //
+        {{half.x, -half.y}, {1.0f, 0.0f}},  //
+        {{half.x, half.y}, {1.0f, 1.0f}},   //
+        {{-half.x, half.y}, {0.0f, 1.0f}},  //
+    };
+    std::vector<unsigned> indices = {
+        0, 1, 2, //
+        0, 2, 3, //
+    };
+    arrived.m_mesh = m_resources->createMesh(verts, indices, arrived.m_texture);
+    // created in place, then moved under the root with the same world position
+    Transform2D transform;
+    transform.m_position = arrived.m_min + half;
+    arrived.m_entity = m_scene->createSprite(*m_resources->get(arrived.m_mesh), transform, index == kOverview ? RenderQueue::Background : RenderQueue::Ground);
+    transform.m_position -= m_worldMin;
+    m_scene->setParent(arrived.m_entity, m_root);
+    m_scene->setTransform(arrived.m_entity, transform);
+    arrived.m_state = State::Resident;
+    const Texture &texture = *m_resources->get(arrived.m_texture);
+    arrived.m_bytes = (size_t)texture.GetWidth() * texture.GetHeight() * 4 * 4 / 3;
+    m_stats.m_residentBytes += arrived.m_bytes;
+    if (index != kOverview) m_stats.m_resident++;
+}
+
+void TileWorld::evict(uint32_t index)
+{
+    Tile &old = tile(index);
+    if (old.m_entity) m_scene->destroy(old.m_entity);
+    old.m_entity = Entity();
+    // the manager keeps both cached while the budget allows, wanted again they come straight back
+    m_resources->release(old.m_mesh);
+    m_resources->release(old.m_texture);
+    old.m_mesh = MeshHandle();
+    old.m_texture = TextureHandle();
+    if (old.m_state == State::Loading) m_stats.m_loading--;
+    if (old.m_state == State::Resident)
+    {
+        m_stats.m_residentBytes -= old.m_bytes;
+        if (index != kOverview)
+        {
+            m_stats.m_resident--;
+            m_stats.m_evictions++;
+        }
+    }
+    old.m_bytes = 0;
+    old.m_state = State::Unloaded;
+    m_loaded.erase(std::remove(m_loaded.begin(), m_loaded.end(), index), m_loaded.end());
+}
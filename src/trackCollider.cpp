@@ -0,0 +1,273 @@
+// trackCollider.cpp
+#include "trackCollider.h"
+#include "jobSystem.h"
+#include "profiler.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+constexpr char kMagic[4] = {'T', 'S', 'D', 'F'};
+constexpr uint32_t kVersion = 2; // 2: only tarmac and kerbs are drivable
+constexpr float kInf = 1e20f;
+
+struct CacheHeader
+{
+    char m_magic[4];
+    uint32_t m_version;
+    uint32_t m_width;
+    uint32_t m_height;
+    uint64_t m_sourceSize; // the cache is stale once the image changes
+    int64_t m_sourceTime;
+};
+
+// Felzenszwalb & Huttenlocher: squared distance to the lower envelope of
+// parabolas rooted at every sample; f is 0 on features, kInf elsewhere
+void distance1D(const float *f, float *d, int *v, float *z, int n)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -kInf;
+    z[1] = kInf;
+    for (int q = 1; q < n; q++)
+    {
+        // z[0] is -inf, so k never drops below 0
+        float s = ((f[q] + (float)q * q) - (f[v[k]] + (float)v[k] * v[k])) / (2.0f * (q - v[k]));
+        while (s <= z[k])
+        {
+            k--;
+            s = ((f[q] + (float)q * q) - (f[v[k]] + (float)v[k] * v[k])) / (2.0f * (q - v[k]));
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = kInf;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++)
+    {
+        while (z[k + 1] < (float)q)
+            k++;
+        float dq = (float)(q - v[k]);
+        d[q] = dq * dq + f[v[k]];
+    }
+}
+
+// Squared Euclidean distance from every texel to the nearest one where mask == feature
+std::vector<float> distanceTransform(const std::vector<uint8_t> &mask, uint8_t feature, int width, int height, JobSystem *jobs)
+{
+    std::vector<float> field(mask.size());
+    for (size_t i = 0; i < mask.size(); i++)
+        field[i] = mask[i] == feature ? 0.0f : kInf;
+
+    auto forEach = [jobs](size_t count, const std::function<void(size_t, size_t)> &fn)
+    {
+        if (jobs) jobs->parallelFor(0, count, 32, fn);
+        else fn(0, count);
+    };
+
+    // columns, then rows; each line is independent
+    forEach((size_t)width,
+            [&](size_t begin, size_t end)
+            {
+                std::vector<float> f(height), d(height), z(height + 1);
+                std::vector<int> v(height);
+                for (size_t x = begin; x < end; x++)
+                {
+                    for (int y = 0; y < height; y++)
+                        f[y] = field[(size_t)y * width + x];
+                    distance1D(f.data(), d.data(), v.data(), z.data(), height);
+                    for (int y = 0; y < height; y++)
+                        field[(size_t)y * width + x] = d[y];
+                }
+            });
+    forEach((size_t)height,
+            [&](size_t begin, size_t end)
+            {
+                std::vector<float> f(width), z(width + 1);
+                std::vector<int> v(width);
+                for (size_t y = begin; y < end; y++)
+                {
+                    float *row = &field[y * width];
+                    std::copy(row, row + width, f.begin());
+                    distance1D(f.data(), row, v.data(), z.data(), width);
+                }
+            });
+    return field;
+}
+} // namespace
+
+TrackCollider::TrackCollider() : m_width(0), m_height(0), m_worldMin(0.0f), m_texelSize(1.0f), m_loadMs(0.0), m_cached(false) {}
+
+void TrackCollider::load(const std::string &imagePath, const glm::vec2 &worldMin, const glm::vec2 &worldMax, bool flipVertically, JobSystem *jobs)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::error_code error;
+    uint64_t sourceSize = std::filesystem::file_size(imagePath, error);
+    if (error) throw std::runtime_error("Failed to open track image: " + imagePath);
+    int64_t sourceTime = (int64_t)std::filesystem::last_write_time(imagePath, error).time_since_epoch().count();
+    // header only, a cache of any other size is not this image's
+    int sourceWidth, sourceHeight, sourceChannels;
+    if (!stbi_info(imagePath.c_str(), &sourceWidth, &sourceHeight, &sourceChannels)) throw std::runtime_error("Failed to read track image: " + imagePath);
+
+    // flip is part of the key so both orientations can't be confused
+    std::string cachePath = imagePath + (flipVertically ? "" : ".noflip") + kExtension;
+    m_cached = readCache(cachePath, sourceSize, sourceTime, sourceWidth, sourceHeight);
+    if (!m_cached)
+    {
+        build(imagePath, flipVertically, jobs);
+        writeCache(cachePath, sourceSize, sourceTime);
+    }
+
+    m_worldMin = worldMin;
+    m_texelSize = (worldMax - worldMin) / glm::vec2((float)m_width, (float)m_height);
+    m_loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Track SDF " << (m_cached ? "loaded" : "built") << " in " << m_loadMs << " ms\n";
+}
+
+void TrackCollider::build(const std::string &imagePath, bool flipVertically, JobSystem *jobs)
+{
+    PROFILE_SCOPE("Track SDF build");
+    stbi_set_flip_vertically_on_load_thread(flipVertically ? 1 : 0);
+    int width, height, channels;
+    unsigned char *data = stbi_load(imagePath.c_str(), &width, &height, &channels, 3);
+    stbi_set_flip_vertically_on_load_thread(0);
+    if (!data) throw std::runtime_error("Failed to load track image: " + imagePath);
+
+    // the image is painted, so classify a 5x5 average rather than single texels
+    const int radius = 2;
+    std::vector<uint8_t> drivable((size_t)width * height);
+    m_friction.assign((size_t)width * height, 0);
+    auto classify = [&](size_t begin, size_t end)
+    {
+        for (int y = (int)begin; y < (int)end; y++)
+            for (int x = 0; x < width; x++)
+            {
+                int sum[3] = {0, 0, 0}, count = 0;
+                for (int sy = std::max(0, y - radius); sy <= std::min(height - 1, y + radius); sy++)
+                    for (int sx = std::max(0, x - radius); sx <= std::min(width - 1, x + radius); sx++, count++)
+                        for (int c = 0; c < 3; c++)
+                            sum[c] += data[((size_t)sy * width + sx) * 3 + c];
+                int r = sum[0] / count, g = sum[1] / count, b = sum[2] / count;
+
+                // tarmac is a dark grey, kerbs red and white (or cream), lines white too;
+                // grass, dirt, water, buildings and anything else is a wall
+                int hi = std::max({r, g, b}), lo = std::min({r, g, b});
+                bool tarmac = hi - lo <= 20 && lo >= 28 && hi <= 95;
+                bool kerb = (r > g + 40 && r > b + 40) || (hi - lo <= 60 && lo >= 120);
+                // the outermost texels too, so nothing drives off the image
+                bool border = x == 0 || y == 0 || x == width - 1 || y == height - 1;
+                size_t i = (size_t)y * width + x;
+                drivable[i] = (tarmac || kerb) && !border ? 1 : 0;
+                m_friction[i] = tarmac ? 255 : (kerb ? 180 : 80);
+            }
+    };
+    if (jobs) jobs->parallelFor(0, (size_t)height, 32, classify);
+    else classify(0, (size_t)height);
+    stbi_image_free(data);
+
+    std::vector<float> toTrack = distanceTransform(drivable, 1, width, height, jobs);
+    std::vector<float> toGrass = distanceTransform(drivable, 0, width, height, jobs);
+
+    // the edge sits half a texel between a drivable texel and its neighbour
+    m_width = width;
+    m_height = height;
+    m_distance.resize((size_t)width * height);
+    for (size_t i = 0; i < m_distance.size(); i++)
+        m_distance[i] = drivable[i] ? 0.5f - std::sqrt(toGrass[i]) : std::sqrt(toTrack[i]) - 0.5f;
+}
+
+bool TrackCollider::readCache(const std::string &cachePath, uint64_t sourceSize, int64_t sourceTime, int sourceWidth, int sourceHeight)
+{
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file) return false;
+
+    CacheHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) return false;
+    if (std::memcmp(header.m_magic, kMagic, sizeof(kMagic)) != 0 || header.m_version != kVersion) return false;
+    if (header.m_sourceSize != sourceSize || header.m_sourceTime != sourceTime) return false;
+    // checked before anything is sized from the header
+    if (header.m_width != (uint32_t)sourceWidth || header.m_height != (uint32_t)sourceHeight) return false;
+
+    size_t count = (size_t)header.m_width * header.m_height;
+    std::vector<float> distance(count);
+    std::vector<uint8_t> friction(count);
+    if (!file.read(reinterpret_cast<char *>(distance.data()), count * sizeof(float))) return false;
+    if (!file.read(reinterpret_cast<char *>(friction.data()), count)) return false;
+
+    m_width = (int)header.m_width;
+    m_height = (int)header.m_height;
+    m_distance.swap(distance);
+    m_friction.swap(friction);
+    return true;
+}
+
+void TrackCollider::writeCache(const std::string &cachePath, uint64_t sourceSize, int64_t sourceTime) const
+{
+    CacheHeader header;
+    std::memcpy(header.m_magic, kMagic, sizeof(kMagic));
+    header.m_version = kVersion;
+    header.m_width = (uint32_t)m_width;
+    header.m_height = (uint32_t)m_height;
+    header.m_sourceSize = sourceSize;
+    header.m_sourceTime = sourceTime;
+
+    // a missing cache only costs a rebuild next time
+    std::ofstream file(cachePath, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(m_distance.data()), m_distance.size() * sizeof(float));
+    file.write(reinterpret_cast<const char *>(m_friction.data()), m_friction.size());
+    if (!file) std::cerr << "Failed to write track SDF cache: " << cachePath << "\n";
+}
+
+TrackCollider::Sample TrackCollider::sample(const glm::vec2 &position) const
+{
+    Sample result = {0.0f, glm::vec2(0.0f), 1.0f};
+    if (!isLoaded()) return result;
+
+    // texel centres sit at half-texel offsets
+    glm::vec2 texel = (position - m_worldMin) / m_texelSize - glm::vec2(0.5f);
+    glm::vec2 clamped(std::min(std::max(texel.x, 0.0f), (float)(m_width - 1)), std::min(std::max(texel.y, 0.0f), (float)(m_height - 1)));
+
+    int x0 = std::min((int)clamped.x, m_width - 2), y0 = std::min((int)clamped.y, m_height - 2);
+    float fx = clamped.x - x0, fy = clamped.y - y0;
+    size_t i00 = (size_t)y0 * m_width + x0, i10 = i00 + 1, i01 = i00 + m_width, i11 = i01 + 1;
+
+    float d00 = m_distance[i00], d10 = m_distance[i10], d01 = m_distance[i01], d11 = m_distance[i11];
+    float bottom = d00 + (d10 - d00) * fx, top = d01 + (d11 - d01) * fx;
+    float distance = bottom + (top - bottom) * fy;
+
+    // analytic gradient of the bilinear patch
+    glm::vec2 gradient((d10 - d00) * (1.0f - fy) + (d11 - d01) * fy, top - bottom);
+    float f00 = m_friction[i00], f10 = m_friction[i10], f01 = m_friction[i01], f11 = m_friction[i11];
+    float fBottom = f00 + (f10 - f00) * fx, fTop = f01 + (f11 - f01) * fx;
+    result.m_friction = (fBottom + (fTop - fBottom) * fy) / 255.0f;
+
+    // texels are not necessarily square
+    float texelWorld = std::min(m_texelSize.x, m_texelSize.y);
+    result.m_distance = distance * texelWorld;
+    gradient /= m_texelSize;
+
+    // past the border: keep pushing back towards the image
+    glm::vec2 outside = (texel - clamped) * m_texelSize;
+    float outsideLength = glm::length(outside);
+    if (outsideLength > 0.0f)
+    {
+        result.m_distance += outsideLength;
+        gradient = outside / outsideLength;
+    }
+
+    float length = glm::length(gradient);
+    result.m_normal = length > 0.0f ? gradient / length : glm::vec2(0.0f);
+    return result;
+}
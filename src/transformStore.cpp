@@ -0,0 +1,329 @@
+// transformStore.cpp
+#include "transformStore.h"
+#include "jobSystem.h"
+#include "profiler.h"
+#include "vehicleSystem.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TRANSFORM_X86 1
+#include <emmintrin.h>
+#endif
+
+using namespace VehicleMath;
+
+namespace
+{
+const Affine2D kIdentity;
+
+// batches of four per job
+constexpr size_t kBatchGrain = 64;
+} // namespace
+
+uint32_t TransformStore::create(Entity owner, const Transform2D &local, uint32_t parent)
+{
+    uint32_t node;
+    if (!m_free.empty())
+    {
+        node = m_free.back();
+        m_free.pop_back();
+    }
+    else
+    {
+        node = (uint32_t)m_alive.size();
+        for (auto *field : {&m_posX, &m_posY, &m_rotation, &m_scaleX, &m_scaleY})
+            field->push_back(0.0f);
+        for (auto *field : {&m_parent, &m_firstChild, &m_nextSibling, &m_prevSibling, &m_depth})
+            field->push_back(kNone);
+        m_owner.emplace_back();
+        m_alive.push_back(0);
+        m_world.emplace_back();
+        m_dirty.push_back(0);
+        m_dirtyList.push_back(0);
+    }
+
+    m_alive[node] = 1;
+    m_owner[node] = owner;
+    m_parent[node] = m_firstChild[node] = m_nextSibling[node] = m_prevSibling[node] = kNone;
+    m_depth[node] = 0;
+    m_posX[node] = local.m_position.x;
+    m_posY[node] = local.m_position.y;
+    m_rotation[node] = local.m_rotation;
+    m_scaleX[node] = local.m_scale.x;
+    m_scaleY[node] = local.m_scale.y;
+    if (parent != kNone) setParent(node, parent);
+    // under a dirty parent it is recomputed with the parent's subtree anyway
+    computeBatch(&node, 1);
+    return node;
+}
+
+void TransformStore::destroy(uint32_t node)
+{
+    if (node >= m_alive.size() || !m_alive[node]) return;
+    while (m_firstChild[node] != kNone)
+        setParent(m_firstChild[node], kNone);
+    unlink(node);
+    // a pending dirty entry stays, update() skips it or, once reused, computes the new node
+    m_alive[node] = 0;
+    m_owner[node] = Entity();
+    m_free.push_back(node);
+}
+
+void TransformStore::clear()
+{
+    for (auto *field : {&m_posX, &m_posY, &m_rotation, &m_scaleX, &m_scaleY})
+        field->clear();
+    for (auto *field : {&m_parent, &m_firstChild, &m_nextSibling, &m_prevSibling, &m_depth, &m_dirtyList, &m_free, &m_updated})
+        field->clear();
+    m_owner.clear();
+    m_alive.clear();
+    m_world.clear();
+    m_dirty.clear();
+    m_dirtyCount = 0;
+    m_levels = 0;
+}
+
+void TransformStore::unlink(uint32_t node)
+{
+    uint32_t parent = m_parent[node];
+    if (parent == kNone) return;
+    if (m_prevSibling[node] != kNone) m_nextSibling[m_prevSibling[node]] = m_nextSibling[node];
+    else m_firstChild[parent] = m_nextSibling[node];
+    if (m_nextSibling[node] != kNone) m_prevSibling[m_nextSibling[node]] = m_prevSibling[node];
+    m_parent[node] = m_nextSibling[node] = m_prevSibling[node] = kNone;
+}
+
+void TransformStore::setParent(uint32_t node, uint32_t parent)
+{
+    if (m_parent[node] == parent) return;
+    for (uint32_t ancestor = parent; ancestor != kNone; ancestor = m_parent[ancestor])
+        if (ancestor == node) return;
+
+    unlink(node);
+    if (parent != kNone)
+    {
+        m_parent[node] = parent;
+        m_nextSibling[node] = m_firstChild[parent];
+        if (m_firstChild[parent] != kNone) m_prevSibling[m_firstChild[parent]] = node;
+        m_firstChild[parent] = node;
+    }
+    setDepth(node, parent == kNone ? 0 : m_depth[parent] + 1);
+    markDirty(node);
+}
+
+void TransformStore::setDepth(uint32_t node, uint32_t depth)
+{
+    m_depth[node] = depth;
+    m_stack.push_back(node);
+    while (!m_stack.empty())
+    {
+        uint32_t top = m_stack.back();
+        m_stack.pop_back();
+        for (uint32_t child = m_firstChild[top]; child != kNone; child = m_nextSibling[child])
+        {
+            m_depth[child] = m_depth[top] + 1;
+            m_stack.push_back(child);
+        }
+    }
+}
+
+void TransformStore::markDirty(uint32_t node)
+{
+    if (m_dirty[node]) return;
+    m_dirty[node] = 1;
+    m_dirtyList[m_dirtyCount.fetch_add(1, std::memory_order_relaxed)] = node;
+}
+
+void TransformStore::setLocal(uint32_t node, const Transform2D &local)
+{
+    if (m_scaleX[node] == local.m_scale.x && m_scaleY[node] == local.m_scale.y)
+    {
+        setLocal(node, local.m_position, local.m_rotation);
+        return;
+    }
+    m_scaleX[node] = local.m_scale.x;
+    m_scaleY[node] = local.m_scale.y;
+    m_posX[node] = local.m_position.x;
+    m_posY[node] = local.m_position.y;
+    m_rotation[node] = local.m_rotation;
+    markDirty(node);
+}
+
+void TransformStore::setLocal(uint32_t node, const glm::vec2 &position, float rotation)
+{
+    // cars parked in the same spot stay clean
+    if (m_posX[node] == position.x && m_posY[node] == position.y && m_rotation[node] == rotation) return;
+    m_posX[node] = position.x;
+    m_posY[node] = position.y;
+    m_rotation[node] = rotation;
+    markDirty(node);
+}
+
+Transform2D TransformStore::getLocal(uint32_t node) const
+{
+    Transform2D local;
+    local.m_position = glm::vec2(m_posX[node], m_posY[node]);
+    local.m_rotation = m_rotation[node];
+    local.m_scale = glm::vec2(m_scaleX[node], m_scaleY[node]);
+    return local;
+}
+
+void TransformStore::update(JobSystem *jobs)
+{
+    PROFILE_SCOPE("Transforms");
+    m_updated.clear();
+    m_levels = 0;
+    uint32_t roots = m_dirtyCount.load(std::memory_order_relaxed);
+    if (roots == 0) return;
+
+    // everything below a dirty node is dirty too; a child that already is covers its own subtree
+    uint32_t maxDepth = 0;
+    for (uint32_t i = 0; i < roots; i++)
+    {
+        uint32_t root = m_dirtyList[i];
+        if (!m_alive[root]) continue;
+        m_stack.push_back(root);
+        while (!m_stack.empty())
+        {
+            uint32_t node = m_stack.back();
+            m_stack.pop_back();
+            maxDepth = std::max(maxDepth, m_depth[node]);
+            for (uint32_t child = m_firstChild[node]; child != kNone; child = m_nextSibling[child])
+            {
+                if (m_dirty[child]) continue;
+                markDirty(child);
+                m_stack.push_back(child);
+            }
+        }
+    }
+
+    // parents first: bucket by depth
+    uint32_t total = m_dirtyCount.load(std::memory_order_relaxed);
+    m_levelStart.assign(maxDepth + 2, 0);
+    for (uint32_t i = 0; i < total; i++)
+    {
+        uint32_t node = m_dirtyList[i];
+        if (m_alive[node]) m_levelStart[m_depth[node] + 1]++;
+    }
+    for (size_t level = 1; level < m_levelStart.size(); level++)
+        m_levelStart[level] += m_levelStart[level - 1];
+    m_updated.resize(m_levelStart.back());
+    // the scratch stack holds each level's write cursor
+    m_stack.assign(m_levelStart.begin(), m_levelStart.end() - 1);
+    for (uint32_t i = 0; i < total; i++)
+    {
+        uint32_t node = m_dirtyList[i];
+        m_dirty[node] = 0;
+        if (m_alive[node]) m_updated[m_stack[m_depth[node]]++] = node;
+    }
+    m_stack.clear();
+    m_dirtyCount.store(0, std::memory_order_relaxed);
+
+    for (size_t level = 0; level + 1 < m_levelStart.size(); level++)
+    {
+        const uint32_t *nodes = m_updated.data() + m_levelStart[level];
+        size_t count = m_levelStart[level + 1] - m_levelStart[level];
+        if (!count) continue;
+        m_levels++;
+        size_t batches = (count + 3) / 4;
+        auto run = [&](size_t begin, size_t end)
+        {
+            for (size_t batch = begin; batch < end; batch++)
+                computeBatch(nodes + batch * 4, std::min<size_t>(4, count - batch * 4));
+        };
+        if (!jobs || batches <= kBatchGrain) run(0, batches);
+        else jobs->parallelFor(0, batches, kBatchGrain, run);
+    }
+}
+
+TransformStore::Stats TransformStore::getStats() const
+{
+    Stats stats;
+    stats.m_nodes = m_alive.size() - m_free.size();
+    stats.m_updated = m_updated.size();
+    stats.m_levels = m_levels;
+    return stats;
+}
+
+#ifdef TRANSFORM_X86
+void TransformStore::computeBatch(const uint32_t *nodes, size_t count)
+{
+    // short batches repeat their last node, it is written the same twice
+    uint32_t lane[4];
+    for (size_t i = 0; i < 4; i++)
+        lane[i] = nodes[std::min(i, count - 1)];
+    auto gather = [&](const std::vector<float> &field) { return _mm_setr_ps(field[lane[0]], field[lane[1]], field[lane[2]], field[lane[3]]); };
+    auto select = [](__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+
+    // sincos, same reduction and polynomials as the vehicle kernels
+    __m128 x = _mm_mul_ps(gather(m_rotation), _mm_set1_ps(kDegToRad));
+    __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(kTwoOverPi)));
+    __m128 q = _mm_cvtepi32_ps(quadrant);
+    __m128 r = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(kPio2Hi))), _mm_mul_ps(q, _mm_set1_ps(kPio2Mid))), _mm_mul_ps(q, _mm_set1_ps(kPio2Lo)));
+    __m128 r2 = _mm_mul_ps(r, r);
+    __m128 ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(kSin2), r2), _mm_set1_ps(kSin1)), r2), _mm_set1_ps(kSin0)), r2), r), r);
+    __m128 pc = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(kCos2), r2), _mm_set1_ps(kCos1)), r2), _mm_set1_ps(kCos0)), r2), r2), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_set1_ps(1.0f));
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128 sine = _mm_xor_ps(select(swap, pc, ps), _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30)));
+    __m128 cosine = _mm_xor_ps(select(swap, ps, pc), _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30)));
+
+    // local: rotate after scale, x axis (c sx, s sx), y axis (-s sy, c sy)
+    __m128 scaleX = gather(m_scaleX), scaleY = gather(m_scaleY);
+    __m128 xx = _mm_mul_ps(cosine, scaleX), xy = _mm_mul_ps(sine, scaleX);
+    __m128 yx = _mm_xor_ps(_mm_mul_ps(sine, scaleY), _mm_set1_ps(-0.0f)), yy = _mm_mul_ps(cosine, scaleY);
+    __m128 tx = gather(m_posX), ty = gather(m_posY);
+
+    // world = parent * local; roots take the identity so every lane does the same work
+    alignas(16) float parent[6][4];
+    for (int i = 0; i < 4; i++)
+    {
+        uint32_t p = m_parent[lane[i]];
+        const Affine2D &world = p == kNone ? kIdentity : m_world[p];
+        parent[0][i] = world.m_linear.x;
+        parent[1][i] = world.m_linear.y;
+        parent[2][i] = world.m_linear.z;
+        parent[3][i] = world.m_linear.w;
+        parent[4][i] = world.m_translation.x;
+        parent[5][i] = world.m_translation.y;
+    }
+    __m128 pxx = _mm_load_ps(parent[0]), pxy = _mm_load_ps(parent[1]), pyx = _mm_load_ps(parent[2]), pyy = _mm_load_ps(parent[3]);
+    __m128 wxx = _mm_add_ps(_mm_mul_ps(pxx, xx), _mm_mul_ps(pyx, xy));
+    __m128 wxy = _mm_add_ps(_mm_mul_ps(pxy, xx), _mm_mul_ps(pyy, xy));
+    __m128 wyx = _mm_add_ps(_mm_mul_ps(pxx, yx), _mm_mul_ps(pyx, yy));
+    __m128 wyy = _mm_add_ps(_mm_mul_ps(pxy, yx), _mm_mul_ps(pyy, yy));
+    alignas(16) float translation[2][4];
+    _mm_store_ps(translation[0], _mm_add_ps(_mm_add_ps(_mm_mul_ps(pxx, tx), _mm_mul_ps(pyx, ty)), _mm_load_ps(parent[4])));
+    _mm_store_ps(translation[1], _mm_add_ps(_mm_add_ps(_mm_mul_ps(pxy, tx), _mm_mul_ps(pyy, ty)), _mm_load_ps(parent[5])));
+
+    // one lane per node, which is the order the instance wants
+    _MM_TRANSPOSE4_PS(wxx, wxy, wyx, wyy);
+    __m128 linear[4] = {wxx, wxy, wyx, wyy};
+    for (size_t i = 0; i < count; i++)
+    {
+        Affine2D &world = m_world[lane[i]];
+        _mm_storeu_ps(&world.m_linear.x, linear[i]);
+        world.m_translation = glm::vec2(translation[0][i], translation[1][i]);
+    }
+}
+#else
+void TransformStore::computeBatch(const uint32_t *nodes, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t node = nodes[i];
+        float rad = m_rotation[node] * kDegToRad;
+        float c = std::cos(rad), s = std::sin(rad);
+        glm::vec2 xAxis(c * m_scaleX[node], s * m_scaleX[node]), yAxis(-s * m_scaleY[node], c * m_scaleY[node]);
+        glm::vec2 t(m_posX[node], m_posY[node]);
+
+        uint32_t p = m_parent[node];
+        const Affine2D &parent = p == kNone ? kIdentity : m_world[p];
+        glm::vec2 px(parent.m_linear.x, parent.m_linear.y), py(parent.m_linear.z, parent.m_linear.w);
+        glm::vec2 wx = px * xAxis.x + py * xAxis.y, wy = px * yAxis.x + py * yAxis.y;
+        Affine2D &world = m_world[node];
+        world.m_linear = glm::vec4(wx, wy);
+        world.m_translation = px * t.x + py * t.y + parent.m_translation;
+    }
+}
+#endif
@@ -0,0 +1,29 @@
+// uniformBuffer.cpp
+#include "uniformBuffer.h"
+#include "glStateCache.h"
+
+UniformBuffer::~UniformBuffer() { cleanup(); }
+
+void UniformBuffer::init(GLuint binding, size_t size)
+{
+    m_binding = binding;
+    m_size = size;
+    glGenBuffers(1, &m_id);
+    GLStateCache::get().bindBuffer(GL_UNIFORM_BUFFER, m_id);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    GLStateCache::get().bindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_id);
+}
+
+void UniformBuffer::update(const void *data, size_t size, size_t offset) const
+{
+    // a camera that didn't move uploads nothing
+    GLStateCache::get().bufferSubData(GL_UNIFORM_BUFFER, m_id, offset, size, data);
+}
+
+void UniformBuffer::cleanup()
+{
+    if (!m_id) return;
+    GLStateCache::get().bufferDeleted(m_id);
+    glDeleteBuffers(1, &m_id);
+    m_id = 0;
+}
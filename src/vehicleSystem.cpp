@@ -0,0 +1,354 @@
+// vehicleSystem.cpp
+#include "vehicleSystem.h"
+#include "carCollider.h"
+#include "jobSystem.h"
+#include "profiler.h"
+#include "trackCollider.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VEHICLE_X86 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+using namespace VehicleMath;
+
+namespace
+{
+size_t padded(size_t count) { return (count + VehicleSystem::kLanes - 1) / VehicleSystem::kLanes * VehicleSystem::kLanes; }
+
+uint32_t nextRandom(uint32_t &state)
+{
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+float randomRange(uint32_t &state, float lo, float hi) { return lo + (hi - lo) * (float)(nextRandom(state) & 0xffffff) / 16777216.0f; }
+} // namespace
+
+VehicleSystem::VehicleSystem() : m_count(0), m_path(bestPath()), m_track(nullptr), m_cars(nullptr)
+{
+    m_constData.accelerationRate = 1000.0f;
+    m_constData.angularDrag = 2.0f;
+    m_constData.linearDrag = 1.5f;
+    m_constData.maxSpeed = 1000.0f;
+    m_constData.maxTurnRate = 100.0f;
+    m_constData.turnRate = 250.0f;
+    m_constData.cameraSmoothing = 10.0f;
+}
+
+void VehicleSystem::resize(size_t count)
+{
+    m_count = count;
+    size_t size = padded(count);
+    for (FloatArray *array : {&m_posX, &m_posY, &m_velX, &m_velY, &m_rotation, &m_angularVelocity, &m_steer, &m_throttle})
+        array->resize(size, 0.0f);
+    // padding lanes are simulated too, keep them at rest
+    for (size_t i = count; i < size; i++)
+    {
+        m_posX[i] = m_posY[i] = m_velX[i] = m_velY[i] = 0.0f;
+        m_rotation[i] = m_angularVelocity[i] = m_steer[i] = m_throttle[i] = 0.0f;
+    }
+}
+
+size_t VehicleSystem::add(const PlayerData &state)
+{
+    size_t slot = m_count;
+    resize(m_count + 1);
+    m_posX[slot] = state.m_position.x;
+    m_posY[slot] = state.m_position.y;
+    m_velX[slot] = state.m_velocity.x;
+    m_velY[slot] = state.m_velocity.y;
+    m_rotation[slot] = state.m_rotation;
+    m_angularVelocity[slot] = state.m_angularVelocity;
+    m_steer[slot] = state.m_steer;
+    m_throttle[slot] = state.m_throttle;
+    return slot;
+}
+
+void VehicleSystem::spawnAI(size_t count, float halfExtent, uint32_t seed)
+{
+    size_t first = std::min<size_t>(m_count, 1); // never touch the player
+    resize(first + count);
+    uint32_t rng = seed ? seed : 1;
+    for (size_t i = first; i < m_count; i++)
+    {
+        m_posX[i] = randomRange(rng, -halfExtent, halfExtent);
+        m_posY[i] = randomRange(rng, -halfExtent, halfExtent);
+        m_velX[i] = m_velY[i] = 0.0f;
+        m_rotation[i] = randomRange(rng, -180.0f, 180.0f);
+        m_angularVelocity[i] = 0.0f;
+        // steady inputs: every AI car drives its own circle
+        m_steer[i] = randomRange(rng, -0.3f, 0.3f);
+        m_throttle[i] = randomRange(rng, 0.3f, 1.0f);
+    }
+}
+
+void VehicleSystem::setControls(size_t slot, float steer, float throttle)
+{
+    m_steer[slot] = steer;
+    m_throttle[slot] = throttle;
+}
+
+void VehicleSystem::read(size_t slot, PlayerData &out) const
+{
+    out.m_position = glm::vec2(m_posX[slot], m_posY[slot]);
+    out.m_velocity = glm::vec2(m_velX[slot], m_velY[slot]);
+    out.m_rotation = m_rotation[slot];
+    out.m_angularVelocity = m_angularVelocity[slot];
+    out.m_steer = m_steer[slot];
+    out.m_throttle = m_throttle[slot];
+}
+
+void VehicleSystem::update(float deltaTime, JobSystem *jobs)
+{
+    PROFILE_SCOPE("Vehicles");
+    size_t end = padded(m_count);
+    // integrating, cars never read each other, so ranges are independent
+    if (!jobs || end <= kJobGrain) updateRange(0, end, deltaTime);
+    else jobs->parallelFor(0, end, kJobGrain, [this, deltaTime](size_t begin, size_t rangeEnd) { updateRange(begin, rangeEnd, deltaTime); });
+    if (m_cars) m_cars->solve(*this, deltaTime, jobs);
+    // walls last, a car pushed by another one still ends the tick on the track
+    if (!m_track) return;
+    if (!jobs || m_count <= kJobGrain) collideTrack(0, m_count, deltaTime);
+    else jobs->parallelFor(0, m_count, kJobGrain, [this, deltaTime](size_t begin, size_t rangeEnd) { collideTrack(begin, rangeEnd, deltaTime); });
+}
+
+void VehicleSystem::updateRange(size_t begin, size_t end, float dt)
+{
+    PROFILE_SCOPE("Vehicle range");
+    switch (m_path)
+    {
+    case Path::AVX2:
+        updateAVX2(begin, end, dt);
+        break;
+    case Path::SSE:
+        updateSSE(begin, end, dt);
+        break;
+    default:
+        updateScalar(begin, std::min(end, m_count), dt);
+        break;
+    }
+}
+
+void VehicleSystem::collideTrack(size_t begin, size_t end, float dt)
+{
+    // scalar on every path, one field lookup per car
+    for (size_t i = begin; i < end; i++)
+    {
+        TrackCollider::Sample sample = m_track->sample(glm::vec2(m_posX[i], m_posY[i]));
+        float vx = m_velX[i], vy = m_velY[i];
+
+        float drag = 1.0f + (1.0f - sample.m_friction) * kSurfaceDrag * dt;
+        vx /= drag;
+        vy /= drag;
+
+        // push the body back inside and drop (most of) the velocity into the wall
+        float penetration = sample.m_distance + kCarRadius;
+        if (penetration > 0.0f)
+        {
+            m_posX[i] -= sample.m_normal.x * penetration;
+            m_posY[i] -= sample.m_normal.y * penetration;
+            float intoWall = vx * sample.m_normal.x + vy * sample.m_normal.y;
+            if (intoWall > 0.0f)
+            {
+                vx -= sample.m_normal.x * intoWall * (1.0f + kWallRestitution);
+                vy -= sample.m_normal.y * intoWall * (1.0f + kWallRestitution);
+            }
+        }
+        m_velX[i] = vx;
+        m_velY[i] = vy;
+    }
+}
+
+void VehicleSystem::updateScalar(size_t begin, size_t end, float dt)
+{
+    const PlayerConstData &k = m_constData;
+    const float angularDamping = 1.0f + k.angularDrag * dt;
+    const float linearDamping = 1.0f + k.linearDrag * dt;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        float steer = m_steer[i], throttle = m_throttle[i];
+
+        float av = m_angularVelocity[i] + steer * k.turnRate * dt;
+        av = std::min(std::max(av, -k.maxTurnRate), k.maxTurnRate);
+        av = std::fabs(av) > kRestAngular ? av / angularDamping : (steer == 0.0f ? 0.0f : av);
+        m_angularVelocity[i] = av;
+
+        float rot = m_rotation[i] + av * dt;
+        rot = rot > 360.0f ? rot - 360.0f : rot;
+        rot = rot < -360.0f ? rot + 360.0f : rot;
+        m_rotation[i] = rot;
+
+        float fwdY, fwdX;
+        fastSinCos(rot * kDegToRad, fwdY, fwdX);
+        float accel = throttle * k.accelerationRate * dt;
+        float ax = fwdX * accel, ay = fwdY * accel;
+        float vx = m_velX[i] + ax, vy = m_velY[i] + ay;
+
+        float speed = std::sqrt(vx * vx + vy * vy);
+        // past max speed this tick's push is taken back
+        if (speed > k.maxSpeed)
+        {
+            vx = vx - ax;
+            vy = vy - ay;
+        }
+        bool moving = speed > kRestSpeed, coasting = throttle == 0.0f;
+        vx = moving ? vx / linearDamping : (coasting ? 0.0f : vx);
+        vy = moving ? vy / linearDamping : (coasting ? 0.0f : vy);
+        m_velX[i] = vx;
+        m_velY[i] = vy;
+
+        m_posX[i] = m_posX[i] + vx * dt;
+        m_posY[i] = m_posY[i] + vy * dt;
+    }
+}
+
+#ifdef VEHICLE_X86
+void VehicleSystem::updateSSE(size_t begin, size_t end, float dt)
+{
+    const PlayerConstData &k = m_constData;
+    const __m128 vDt = _mm_set1_ps(dt);
+    const __m128 turnRate = _mm_set1_ps(k.turnRate);
+    const __m128 maxTurn = _mm_set1_ps(k.maxTurnRate);
+    const __m128 minTurn = _mm_set1_ps(-k.maxTurnRate);
+    const __m128 angularDamping = _mm_set1_ps(1.0f + k.angularDrag * dt);
+    const __m128 linearDamping = _mm_set1_ps(1.0f + k.linearDrag * dt);
+    const __m128 accelRate = _mm_set1_ps(k.accelerationRate);
+    const __m128 maxSpeed = _mm_set1_ps(k.maxSpeed);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 full = _mm_set1_ps(360.0f), negFull = _mm_set1_ps(-360.0f);
+    const __m128 restAngular = _mm_set1_ps(kRestAngular), restSpeed = _mm_set1_ps(kRestSpeed);
+
+    auto select = [](__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+
+    for (size_t i = begin; i < end; i += 4)
+    {
+        __m128 steer = _mm_load_ps(&m_steer[i]);
+        __m128 throttle = _mm_load_ps(&m_throttle[i]);
+
+        __m128 av = _mm_add_ps(_mm_load_ps(&m_angularVelocity[i]), _mm_mul_ps(_mm_mul_ps(steer, turnRate), vDt));
+        av = _mm_min_ps(_mm_max_ps(av, minTurn), maxTurn);
+        __m128 turning = _mm_cmpgt_ps(_mm_andnot_ps(signMask, av), restAngular);
+        __m128 released = _mm_cmpeq_ps(steer, zero);
+        av = select(turning, _mm_div_ps(av, angularDamping), _mm_andnot_ps(released, av));
+        _mm_store_ps(&m_angularVelocity[i], av);
+
+        __m128 rot = _mm_add_ps(_mm_load_ps(&m_rotation[i]), _mm_mul_ps(av, vDt));
+        rot = select(_mm_cmpgt_ps(rot, full), _mm_sub_ps(rot, full), rot);
+        rot = select(_mm_cmplt_ps(rot, negFull), _mm_add_ps(rot, full), rot);
+        _mm_store_ps(&m_rotation[i], rot);
+
+        // sincos, see fastSinCos
+        __m128 x = _mm_mul_ps(rot, _mm_set1_ps(kDegToRad));
+        __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(kTwoOverPi)));
+        __m128 q = _mm_cvtepi32_ps(quadrant);
+        __m128 r = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(kPio2Hi))), _mm_mul_ps(q, _mm_set1_ps(kPio2Mid))), _mm_mul_ps(q, _mm_set1_ps(kPio2Lo)));
+        __m128 r2 = _mm_mul_ps(r, r);
+        __m128 ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(kSin2), r2), _mm_set1_ps(kSin1)), r2), _mm_set1_ps(kSin0)), r2), r), r);
+        __m128 pc = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(kCos2), r2), _mm_set1_ps(kCos1)), r2), _mm_set1_ps(kCos0)), r2), r2), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_set1_ps(1.0f));
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+        __m128 fwdY = select(swap, pc, ps);
+        __m128 fwdX = select(swap, ps, pc);
+        __m128 negSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+        __m128 negCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+        fwdY = _mm_xor_ps(fwdY, negSin);
+        fwdX = _mm_xor_ps(fwdX, negCos);
+
+        __m128 accel = _mm_mul_ps(_mm_mul_ps(throttle, accelRate), vDt);
+        __m128 ax = _mm_mul_ps(fwdX, accel), ay = _mm_mul_ps(fwdY, accel);
+        __m128 vx = _mm_add_ps(_mm_load_ps(&m_velX[i]), ax);
+        __m128 vy = _mm_add_ps(_mm_load_ps(&m_velY[i]), ay);
+
+        __m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)));
+        __m128 tooFast = _mm_cmpgt_ps(speed, maxSpeed);
+        vx = select(tooFast, _mm_sub_ps(vx, ax), vx);
+        vy = select(tooFast, _mm_sub_ps(vy, ay), vy);
+        __m128 moving = _mm_cmpgt_ps(speed, restSpeed);
+        __m128 coasting = _mm_cmpeq_ps(throttle, zero);
+        vx = select(moving, _mm_div_ps(vx, linearDamping), _mm_andnot_ps(coasting, vx));
+        vy = select(moving, _mm_div_ps(vy, linearDamping), _mm_andnot_ps(coasting, vy));
+        _mm_store_ps(&m_velX[i], vx);
+        _mm_store_ps(&m_velY[i], vy);
+
+        _mm_store_ps(&m_posX[i], _mm_add_ps(_mm_load_ps(&m_posX[i]), _mm_mul_ps(vx, vDt)));
+        _mm_store_ps(&m_posY[i], _mm_add_ps(_mm_load_ps(&m_posY[i]), _mm_mul_ps(vy, vDt)));
+    }
+}
+#else
+void VehicleSystem::updateSSE(size_t begin, size_t end, float dt) { updateScalar(begin, std::min(end, m_count), dt); }
+#endif
+
+bool VehicleSystem::supported(Path path)
+{
+    switch (path)
+    {
+    case Path::Scalar:
+        return true;
+#ifdef VEHICLE_X86
+    case Path::SSE:
+        return true; // SSE2 is baseline on x86-64
+    case Path::AVX2:
+#if defined(_MSC_VER)
+    {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuidex(info, 1, 0);
+        bool osxsave = (info[2] & (1 << 27)) != 0, avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+#endif
+    default:
+        return false;
+    }
+}
+
+VehicleSystem::Path VehicleSystem::bestPath()
+{
+    if (supported(Path::AVX2)) return Path::AVX2;
+    if (supported(Path::SSE)) return Path::SSE;
+    return Path::Scalar;
+}
+
+const char *VehicleSystem::pathName(Path path)
+{
+    switch (path)
+    {
+    case Path::SSE:
+        return "SSE";
+    case Path::AVX2:
+        return "AVX2";
+    default:
+        return "Scalar";
+    }
+}
+
+double VehicleSystem::benchmark(Path path, size_t count, int ticks, JobSystem *jobs)
+{
+    VehicleSystem system;
+    system.setPath(path);
+    system.spawnAI(count, 2500.0f);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < ticks; t++)
+        system.update(1.0f / 120.0f, jobs);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return ms > 0.0 ? (double)system.count() * ticks / ms : 0.0;
+}
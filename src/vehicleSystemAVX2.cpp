@@ -0,0 +1,84 @@
+// vehicleSystemAVX2.cpp
+// Built with AVX2 enabled (see CMakeLists.txt) and only entered after a runtime check.
+// Mirrors VehicleSystem::updateSSE at 8 lanes; keep only intrinsics in here so no
+// AVX-encoded copy of a shared inline function can leak into the other files.
+#include "vehicleSystem.h"
+
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)) && (defined(__AVX2__) || defined(_MSC_VER))
+#include <immintrin.h>
+
+using namespace VehicleMath;
+
+void VehicleSystem::updateAVX2(size_t begin, size_t end, float dt)
+{
+    const PlayerConstData &k = m_constData;
+    const __m256 vDt = _mm256_set1_ps(dt);
+    const __m256 turnRate = _mm256_set1_ps(k.turnRate);
+    const __m256 maxTurn = _mm256_set1_ps(k.maxTurnRate);
+    const __m256 minTurn = _mm256_set1_ps(-k.maxTurnRate);
+    const __m256 angularDamping = _mm256_set1_ps(1.0f + k.angularDrag * dt);
+    const __m256 linearDamping = _mm256_set1_ps(1.0f + k.linearDrag * dt);
+    const __m256 accelRate = _mm256_set1_ps(k.accelerationRate);
+    const __m256 maxSpeed = _mm256_set1_ps(k.maxSpeed);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 full = _mm256_set1_ps(360.0f), negFull = _mm256_set1_ps(-360.0f);
+    const __m256 restAngular = _mm256_set1_ps(kRestAngular), restSpeed = _mm256_set1_ps(kRestSpeed);
+
+    for (size_t i = begin; i < end; i += 8)
+    {
+        __m256 steer = _mm256_load_ps(&m_steer[i]);
+        __m256 throttle = _mm256_load_ps(&m_throttle[i]);
+
+        __m256 av = _mm256_add_ps(_mm256_load_ps(&m_angularVelocity[i]), _mm256_mul_ps(_mm256_mul_ps(steer, turnRate), vDt));
+        av = _mm256_min_ps(_mm256_max_ps(av, minTurn), maxTurn);
+        __m256 turning = _mm256_cmp_ps(_mm256_andnot_ps(signMask, av), restAngular, _CMP_GT_OQ);
+        __m256 released = _mm256_cmp_ps(steer, zero, _CMP_EQ_OQ);
+        av = _mm256_blendv_ps(_mm256_andnot_ps(released, av), _mm256_div_ps(av, angularDamping), turning);
+        _mm256_store_ps(&m_angularVelocity[i], av);
+
+        __m256 rot = _mm256_add_ps(_mm256_load_ps(&m_rotation[i]), _mm256_mul_ps(av, vDt));
+        rot = _mm256_blendv_ps(rot, _mm256_sub_ps(rot, full), _mm256_cmp_ps(rot, full, _CMP_GT_OQ));
+        rot = _mm256_blendv_ps(rot, _mm256_add_ps(rot, full), _mm256_cmp_ps(rot, negFull, _CMP_LT_OQ));
+        _mm256_store_ps(&m_rotation[i], rot);
+
+        // no FMA on purpose: results must match the scalar and SSE paths bit for bit
+        __m256 x = _mm256_mul_ps(rot, _mm256_set1_ps(kDegToRad));
+        __m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(kTwoOverPi)));
+        __m256 q = _mm256_cvtepi32_ps(quadrant);
+        __m256 r = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(x, _mm256_mul_ps(q, _mm256_set1_ps(kPio2Hi))), _mm256_mul_ps(q, _mm256_set1_ps(kPio2Mid))), _mm256_mul_ps(q, _mm256_set1_ps(kPio2Lo)));
+        __m256 r2 = _mm256_mul_ps(r, r);
+        __m256 ps = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(kSin2), r2), _mm256_set1_ps(kSin1)), r2), _mm256_set1_ps(kSin0)), r2), r), r);
+        __m256 pc = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(kCos2), r2), _mm256_set1_ps(kCos1)), r2), _mm256_set1_ps(kCos0)), r2), r2), _mm256_mul_ps(_mm256_set1_ps(0.5f), r2)), _mm256_set1_ps(1.0f));
+        __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+        __m256 fwdY = _mm256_blendv_ps(ps, pc, swap);
+        __m256 fwdX = _mm256_blendv_ps(pc, ps, swap);
+        __m256 negSin = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30));
+        __m256 negCos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+        fwdY = _mm256_xor_ps(fwdY, negSin);
+        fwdX = _mm256_xor_ps(fwdX, negCos);
+
+        __m256 accel = _mm256_mul_ps(_mm256_mul_ps(throttle, accelRate), vDt);
+        __m256 ax = _mm256_mul_ps(fwdX, accel), ay = _mm256_mul_ps(fwdY, accel);
+        __m256 vx = _mm256_add_ps(_mm256_load_ps(&m_velX[i]), ax);
+        __m256 vy = _mm256_add_ps(_mm256_load_ps(&m_velY[i]), ay);
+
+        __m256 speed = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)));
+        __m256 tooFast = _mm256_cmp_ps(speed, maxSpeed, _CMP_GT_OQ);
+        vx = _mm256_blendv_ps(vx, _mm256_sub_ps(vx, ax), tooFast);
+        vy = _mm256_blendv_ps(vy, _mm256_sub_ps(vy, ay), tooFast);
+        __m256 moving = _mm256_cmp_ps(speed, restSpeed, _CMP_GT_OQ);
+        __m256 coasting = _mm256_cmp_ps(throttle, zero, _CMP_EQ_OQ);
+        vx = _mm256_blendv_ps(_mm256_andnot_ps(coasting, vx), _mm256_div_ps(vx, linearDamping), moving);
+        vy = _mm256_blendv_ps(_mm256_andnot_ps(coasting, vy), _mm256_div_ps(vy, linearDamping), moving);
+        _mm256_store_ps(&m_velX[i], vx);
+        _mm256_store_ps(&m_velY[i], vy);
+
+        _mm256_store_ps(&m_posX[i], _mm256_add_ps(_mm256_load_ps(&m_posX[i]), _mm256_mul_ps(vx, vDt)));
+        _mm256_store_ps(&m_posY[i], _mm256_add_ps(_mm256_load_ps(&m_posY[i]), _mm256_mul_ps(vy, vDt)));
+    }
+}
+#else
+// never selected: supported(Path::AVX2) is false on this target
+void VehicleSystem::updateAVX2(size_t begin, size_t end, float dt) { updateSSE(begin, end, dt); }
+#endif
@@ -0,0 +1,482 @@
+// assetCooker.cpp
+// Converts textures into the cooked container read by Texture / TextureStreamer.
+//   asset_cooker [--bc1|--bc3|--bc] [--no-flip] [--out-dir DIR] images...
+//   asset_cooker --tile N [--bc1|--bc3|--bc] [--no-flip] [--out-dir DIR] images...
+//   asset_cooker --bench [--iterations N] [--out-dir DIR] images...
+#include "cookedTexture.h"
+#include "tileSet.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Image
+{
+    int m_width = 0, m_height = 0;
+    std::vector<unsigned char> m_rgba;
+};
+
+struct Options
+{
+    bool m_bench = false;
+    bool m_flip = true;
+    bool m_autoBc = false;
+    Cooked::Format m_format = Cooked::Format::RGBA8;
+    int m_iterations = 5;
+    int m_tileSize = 0; // 0 cooks whole images
+    std::string m_outDir;
+    std::vector<std::string> m_inputs;
+};
+
+bool loadImage(const std::string &path, bool flip, Image &out)
+{
+    stbi_set_flip_vertically_on_load(flip);
+    int channels = 0;
+    unsigned char *data = stbi_load(path.c_str(), &out.m_width, &out.m_height, &channels, 4);
+    if (!data) return false;
+    out.m_rgba.assign(data, data + (size_t)out.m_width * out.m_height * 4);
+    stbi_image_free(data);
+    return true;
+}
+
+// 2x2 box filter, odd edges reuse the last texel
+Image downsample(const Image &src)
+{
+    Image dst;
+    dst.m_width = std::max(1, src.m_width / 2);
+    dst.m_height = std::max(1, src.m_height / 2);
+    dst.m_rgba.resize((size_t)dst.m_width * dst.m_height * 4);
+    for (int y = 0; y < dst.m_height; y++)
+    {
+        int y0 = std::min(y * 2, src.m_height - 1), y1 = std::min(y * 2 + 1, src.m_height - 1);
+        for (int x = 0; x < dst.m_width; x++)
+        {
+            int x0 = std::min(x * 2, src.m_width - 1), x1 = std::min(x * 2 + 1, src.m_width - 1);
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = src.m_rgba[((size_t)y0 * src.m_width + x0) * 4 + c] + src.m_rgba[((size_t)y0 * src.m_width + x1) * 4 + c] + src.m_rgba[((size_t)y1 * src.m_width + x0) * 4 + c] + src.m_rgba[((size_t)y1 * src.m_width + x1) * 4 + c];
+                dst.m_rgba[((size_t)y * dst.m_width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+uint16_t to565(const int rgb[3]) { return (uint16_t)(((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3)); }
+
+void from565(uint16_t c, int rgb[3])
+{
+    rgb[0] = ((c >> 11) & 31) * 255 / 31;
+    rgb[1] = ((c >> 5) & 63) * 255 / 63;
+    rgb[2] = (c & 31) * 255 / 31;
+}
+
+// Bounding-box range fit. 'punchThrough' uses the 3-colour + transparent mode (BC1 alpha).
+void encodeColorBlock(const unsigned char block[16][4], bool punchThrough, unsigned char out[8])
+{
+    int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+    bool transparent = false;
+    for (int i = 0; i < 16; i++)
+    {
+        if (punchThrough && block[i][3] < 128)
+        {
+            transparent = true;
+            continue;
+        }
+        for (int c = 0; c < 3; c++)
+        {
+            lo[c] = std::min(lo[c], (int)block[i][c]);
+            hi[c] = std::max(hi[c], (int)block[i][c]);
+        }
+    }
+    if (lo[0] > hi[0])
+    {
+        // fully transparent block
+        std::fill(lo, lo + 3, 0);
+        std::fill(hi, hi + 3, 0);
+    }
+
+    // inset the box a little, the endpoints are rarely hit exactly
+    for (int c = 0; c < 3; c++)
+    {
+        int inset = (hi[c] - lo[c]) / 16;
+        lo[c] += inset;
+        hi[c] -= inset;
+    }
+    uint16_t c0 = to565(hi), c1 = to565(lo);
+    // 4-colour mode needs c0 > c1, 3-colour mode needs c0 <= c1
+    if (transparent ? c0 > c1 : c0 < c1) std::swap(c0, c1);
+
+    int palette[4][3];
+    from565(c0, palette[0]);
+    from565(c1, palette[1]);
+    int colors = 4;
+    for (int c = 0; c < 3; c++)
+    {
+        if (transparent || c0 == c1)
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+            colors = 3;
+        }
+        else
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+    }
+
+    uint32_t indices = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int best = 0, bestDist = 1 << 30;
+        if (transparent && block[i][3] < 128)
+            best = 3;
+        else
+        {
+            for (int p = 0; p < colors; p++)
+            {
+                int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+                int dist = dr * dr + dg * dg + db * db;
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    best = p;
+                }
+            }
+        }
+        indices |= (uint32_t)best << (i * 2);
+    }
+
+    out[0] = (unsigned char)(c0 & 0xff);
+    out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xff);
+    out[3] = (unsigned char)(c1 >> 8);
+    std::memcpy(out + 4, &indices, 4); // little endian, as the format expects
+}
+
+void encodeAlphaBlock(const unsigned char block[16][4], unsigned char out[8])
+{
+    int lo = 255, hi = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        lo = std::min(lo, (int)block[i][3]);
+        hi = std::max(hi, (int)block[i][3]);
+    }
+
+    // a0 > a1 selects the 8-value ramp
+    int palette[8] = {hi, lo};
+    for (int p = 1; p < 7; p++)
+        palette[p + 1] = ((7 - p) * hi + p * lo) / 7;
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int best = 0, bestDist = 1 << 30;
+        for (int p = 0; p < 8 && hi != lo; p++)
+        {
+            int dist = std::abs(block[i][3] - palette[p]);
+            if (dist < bestDist)
+            {
+                bestDist = dist;
+                best = p;
+            }
+        }
+        indices |= (uint64_t)best << (i * 3);
+    }
+
+    out[0] = (unsigned char)hi;
+    out[1] = (unsigned char)lo;
+    for (int b = 0; b < 6; b++)
+        out[2 + b] = (unsigned char)(indices >> (b * 8));
+}
+
+std::vector<unsigned char> encode(const Image &image, Cooked::Format format)
+{
+    if (format == Cooked::Format::RGBA8) return image.m_rgba;
+
+    std::vector<unsigned char> out(Cooked::levelSize(format, image.m_width, image.m_height));
+    unsigned char *dst = out.data();
+    for (int by = 0; by < image.m_height; by += 4)
+    {
+        for (int bx = 0; bx < image.m_width; bx += 4)
+        {
+            // partial blocks at the edges repeat the last row/column
+            unsigned char block[16][4];
+            for (int i = 0; i < 16; i++)
+            {
+                int x = std::min(bx + i % 4, image.m_width - 1), y = std::min(by + i / 4, image.m_height - 1);
+                std::memcpy(block[i], &image.m_rgba[((size_t)y * image.m_width + x) * 4], 4);
+            }
+            if (format == Cooked::Format::BC3)
+            {
+                encodeAlphaBlock(block, dst);
+                encodeColorBlock(block, false, dst + 8);
+                dst += 16;
+            }
+            else
+            {
+                encodeColorBlock(block, true, dst);
+                dst += 8;
+            }
+        }
+    }
+    return out;
+}
+
+bool hasAlpha(const Image &image)
+{
+    for (size_t i = 3; i < image.m_rgba.size(); i += 4)
+        if (image.m_rgba[i] != 255) return true;
+    return false;
+}
+
+std::string cookedPath(const std::string &input, const std::string &outDir)
+{
+    if (outDir.empty()) return input + Cooked::kExtension;
+    size_t slash = input.find_last_of("/\\");
+    return outDir + "/" + (slash == std::string::npos ? input : input.substr(slash + 1)) + Cooked::kExtension;
+}
+
+bool writeCooked(const Image &image, const std::string &outPath, const Options &options, const std::string &label)
+{
+    Cooked::Format format = options.m_format;
+    if (options.m_autoBc) format = hasAlpha(image) ? Cooked::Format::BC3 : Cooked::Format::BC1;
+
+    // full chain down to 1x1
+    std::vector<Image> mips{image};
+    while (mips.back().m_width > 1 || mips.back().m_height > 1)
+        mips.push_back(downsample(mips.back()));
+    if (mips.size() > Cooked::kMaxMips) mips.resize(Cooked::kMaxMips);
+
+    Cooked::Header header{};
+    std::memcpy(header.m_magic, Cooked::kMagic, 4);
+    header.m_version = Cooked::kVersion;
+    header.m_format = format;
+    header.m_flags = options.m_flip ? (uint32_t)Cooked::FlippedVertically : 0u;
+    header.m_width = (uint32_t)image.m_width;
+    header.m_height = (uint32_t)image.m_height;
+    header.m_mipCount = (uint32_t)mips.size();
+
+    std::vector<Cooked::Mip> table(mips.size());
+    std::vector<std::vector<unsigned char>> payloads;
+    uint64_t offset = sizeof(header) + table.size() * sizeof(Cooked::Mip);
+    for (size_t i = 0; i < mips.size(); i++)
+    {
+        offset = (offset + 15) & ~uint64_t(15);
+        payloads.push_back(encode(mips[i], format));
+        table[i] = {(uint32_t)mips[i].m_width, (uint32_t)mips[i].m_height, offset, payloads.back().size()};
+        offset += payloads.back().size();
+    }
+
+    std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        std::cerr << "Failed to open " << outPath << "\n";
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(Cooked::Mip));
+    for (size_t i = 0; i < payloads.size(); i++)
+    {
+        static const char zeros[16] = {};
+        out.write(zeros, table[i].m_offset - (uint64_t)out.tellp());
+        out.write(reinterpret_cast<const char *>(payloads[i].data()), payloads[i].size());
+    }
+
+    const char *formatNames[] = {"RGBA8", "BC1", "BC3"};
+    std::cout << label << " -> " << outPath << " (" << image.m_width << "x" << image.m_height << ", " << mips.size() << " mips, " << formatNames[(int)format] << ", " << offset / 1024 << " KB)\n";
+    return (bool)out;
+}
+
+bool cook(const std::string &input, const Options &options)
+{
+    Image image;
+    if (!loadImage(input, options.m_flip, image))
+    {
+        std::cerr << "Failed to load " << input << "\n";
+        return false;
+    }
+    return writeCooked(image, cookedPath(input, options.m_outDir), options, input);
+}
+
+// Cooked tiles plus the manifest TileWorld checks, next to where the image
+// ends up. Tile rows follow the load order, like the runtime split.
+bool cookTiles(const std::string &input, const Options &options)
+{
+    Image image;
+    if (!loadImage(input, options.m_flip, image))
+    {
+        std::cerr << "Failed to load " << input << "\n";
+        return false;
+    }
+
+    // the .ctex suffix comes off to name the image the tiles belong to
+    std::string target = cookedPath(input, options.m_outDir);
+    target.resize(target.size() - std::strlen(Cooked::kExtension));
+    // the game checks the copy it loads, the source only stands in when there is none yet
+    Tiles::Manifest manifest = {};
+    if (!Tiles::stampSource(target, manifest.m_sourceSize, manifest.m_sourceTime) && !Tiles::stampSource(input, manifest.m_sourceSize, manifest.m_sourceTime))
+    {
+        std::cerr << "Failed to stat " << input << "\n";
+        return false;
+    }
+
+    std::memcpy(manifest.m_magic, Tiles::kMagic, sizeof(Tiles::kMagic));
+    manifest.m_version = Tiles::kVersion;
+    manifest.m_width = (uint32_t)image.m_width;
+    manifest.m_height = (uint32_t)image.m_height;
+    manifest.m_tileSize = (uint32_t)options.m_tileSize;
+    manifest.m_columns = (manifest.m_width + manifest.m_tileSize - 1) / manifest.m_tileSize;
+    manifest.m_rows = (manifest.m_height + manifest.m_tileSize - 1) / manifest.m_tileSize;
+    manifest.m_flipped = options.m_flip ? 1 : 0;
+
+    std::error_code error;
+    std::filesystem::remove_all(Tiles::directory(target), error);
+    std::filesystem::create_directories(Tiles::directory(target), error);
+    if (error)
+    {
+        std::cerr << "Failed to create " << Tiles::directory(target) << "\n";
+        return false;
+    }
+
+    Image tile;
+    uint32_t width, height;
+    std::vector<uint8_t> pixels;
+    for (uint32_t row = 0; row < manifest.m_rows; row++)
+        for (uint32_t column = 0; column < manifest.m_columns; column++)
+        {
+            Tiles::extract(image.m_rgba.data(), manifest.m_width, manifest.m_height, manifest.m_tileSize, column, row, pixels, width, height);
+            tile.m_width = (int)width;
+            tile.m_height = (int)height;
+            tile.m_rgba.assign(pixels.begin(), pixels.end());
+            std::string label = input + " tile " + std::to_string(column) + "_" + std::to_string(row);
+            if (!writeCooked(tile, Tiles::tilePath(target, column, row) + Cooked::kExtension, options, label)) return false;
+        }
+
+    Tiles::shrink(image.m_rgba.data(), manifest.m_width, manifest.m_height, manifest.m_tileSize, pixels, width, height);
+    tile.m_width = (int)width;
+    tile.m_height = (int)height;
+    tile.m_rgba.assign(pixels.begin(), pixels.end());
+    if (!writeCooked(tile, Tiles::overviewPath(target) + Cooked::kExtension, options, input + " overview")) return false;
+    // last, so an interrupted run leaves tiles the game redoes
+    return Tiles::writeManifest(target, manifest);
+}
+
+volatile unsigned s_sink = 0; // keeps the staging copies alive
+
+// Cold = first load in this process, warm = mean of the rest. The OS page
+// cache is not flushed, so drop it beforehand for a true cold start.
+// Both sides end with their pixels copied into a staging buffer, which is
+// what the streamer does with a PBO: the decoded image's one level, or every
+// mip of the cooked file. Mips the decoded path still has to generate on the
+// GPU are not counted.
+void bench(const Options &options)
+{
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+
+    std::cout << "texture                      decode cold/warm (ms)   cooked cold/warm (ms)\n";
+    std::vector<unsigned char> staging;
+    for (const auto &input : options.m_inputs)
+    {
+        double decode[2] = {0.0, 0.0}, cooked[2] = {0.0, 0.0};
+        bool haveCooked = true;
+        for (int it = 0; it < options.m_iterations; it++)
+        {
+            int slot = it == 0 ? 0 : 1;
+
+            auto t0 = Clock::now();
+            Image image;
+            loadImage(input, options.m_flip, image);
+            staging.resize(image.m_rgba.size());
+            if (!staging.empty()) std::memcpy(staging.data(), image.m_rgba.data(), staging.size());
+            auto t1 = Clock::now();
+            decode[slot] += ms(t0, t1);
+            unsigned sum = staging.empty() ? 0 : staging.back();
+
+            CookedTextureFile file;
+            haveCooked = file.open(cookedPath(input, options.m_outDir));
+            if (haveCooked)
+            {
+                for (uint32_t level = 0; level < file.header().m_mipCount; level++)
+                {
+                    const Cooked::Mip &mip = file.mip(level);
+                    staging.resize((size_t)mip.m_size);
+                    std::memcpy(staging.data(), file.mipData(level), staging.size());
+                    sum += staging.empty() ? 0 : staging.back();
+                }
+            }
+            auto t2 = Clock::now();
+            cooked[slot] += ms(t1, t2);
+            s_sink = sum;
+        }
+        if (options.m_iterations > 1)
+        {
+            decode[1] /= options.m_iterations - 1;
+            cooked[1] /= options.m_iterations - 1;
+        }
+
+        std::printf("%-28s %10.3f / %-10.3f", input.c_str(), decode[0], decode[1]);
+        if (haveCooked)
+            std::printf(" %10.3f / %-10.3f\n", cooked[0], cooked[1]);
+        else
+            std::printf("   (not cooked)\n");
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--bench")
+            options.m_bench = true;
+        else if (arg == "--bc1")
+            options.m_format = Cooked::Format::BC1;
+        else if (arg == "--bc3")
+            options.m_format = Cooked::Format::BC3;
+        else if (arg == "--bc")
+            options.m_autoBc = true;
+        else if (arg == "--no-flip")
+            options.m_flip = false;
+        else if (arg == "--out-dir" && i + 1 < argc)
+            options.m_outDir = argv[++i];
+        else if (arg == "--tile" && i + 1 < argc)
+            options.m_tileSize = std::max(4, std::atoi(argv[++i]));
+        else if (arg == "--iterations" && i + 1 < argc)
+            options.m_iterations = std::max(1, std::atoi(argv[++i]));
+        else
+            options.m_inputs.push_back(arg);
+    }
+    if (options.m_inputs.empty())
+    {
+        std::cerr << "usage: asset_cooker [--bc1|--bc3|--bc] [--no-flip] [--out-dir DIR] images...\n"
+                     "       asset_cooker --tile N [--bc1|--bc3|--bc] [--no-flip] [--out-dir DIR] images...\n"
+                     "       asset_cooker --bench [--iterations N] [--out-dir DIR] images...\n";
+        return 1;
+    }
+
+    if (options.m_bench)
+    {
+        bench(options);
+        return 0;
+    }
+
+    bool ok = true;
+    for (const auto &input : options.m_inputs)
+        ok = (options.m_tileSize > 0 ? cookTiles(input, options) : cook(input, options)) && ok;
+    return ok ? 0 : 1;
+}